@@ -678,6 +678,8 @@ typedef struct OutputStream {
     // simple filtergraph feeding this stream, if any
     FilterGraph  *fg_simple;
     OutputFilter *filter;
+    // filter is the output of a simple filtergraph owned by another stream
+    int           filter_shared;
 
     char *attachment_filename;
 
@@ -778,6 +780,7 @@ extern AVIOContext *progress_avio;
 extern float max_error_rate;
 
 extern char *filter_nbthreads;
+extern char *filter_thread_type;
 extern int filter_complex_nbthreads;
 extern int filter_buffered_frames;
 extern int vstats_version;
@@ -785,6 +788,7 @@ extern int print_graphs;
 extern char *print_graphs_file;
 extern char *print_graphs_format;
 extern int auto_conversion_filters;
+extern int share_filtergraphs;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -819,6 +823,17 @@ int fg_create_simple(FilterGraph **pfg,
                      char **graph_desc,
                      Scheduler *sch, unsigned sched_idx_enc,
                      const OutputFilterOptions *opts);
+/**
+ * Feed an encoder from the output of an existing simple filtergraph, when
+ * the filtergraph description and all the encoder input requirements match
+ * the ones it was created with.
+ *
+ * @retval 1 the encoder was connected to the filtergraph output
+ * @retval 0 the filtergraph cannot be shared with this encoder
+ * @retval "<0" error code
+ */
+int fg_simple_share(FilterGraph *fg, const char *graph_desc,
+                    unsigned sched_idx_enc, const OutputFilterOptions *opts);
 int fg_finalise_bindings(void);
 
 /**
@@ -58,6 +58,9 @@ typedef struct FilterGraphPriv {
 
     int              nb_threads;
 
+    // view specifier of the input stream, for simple filtergraphs
+    ViewSpecifier    vs;
+
     // frame for temporarily holding output from the filtergraph
     AVFrame         *frame;
     // frame for sending output to the encoder
@@ -1287,6 +1290,9 @@ int fg_create_simple(FilterGraph **pfg,
     if (ret < 0)
         return ret;
 
+    if (opts->vs)
+        fgp->vs = *opts->vs;
+
     ret = ofilter_bind_enc(fg->outputs[0], sched_idx_enc, opts);
     if (ret < 0)
         return ret;
@@ -1297,6 +1303,103 @@ int fg_create_simple(FilterGraph **pfg,
     return 0;
 }
 
+static int dict_equal(const AVDictionary *a, const AVDictionary *b)
+{
+    const AVDictionaryEntry *e = NULL;
+
+    if (av_dict_count(a) != av_dict_count(b))
+        return 0;
+
+    while ((e = av_dict_iterate(a, e))) {
+        const AVDictionaryEntry *e_b = av_dict_get(b, e->key, NULL, 0);
+        if (!e_b || strcmp(e->value, e_b->value))
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Check that binding an encoder with the given options would configure the
+ * output exactly like the existing binding, i.e. it would produce the same
+ * frames. Constraint lists are compared by pointer, so they only match when
+ * they come from the same encoder. */
+static int ofilter_opts_match(const OutputFilterPriv *ofp,
+                              const OutputFilterOptions *opts)
+{
+    const int framerate_clip = opts->enc && opts->enc->id == AV_CODEC_ID_MPEG4 ?
+                               65535 : 0;
+
+    if (ofp->ofilter.type != AVMEDIA_TYPE_VIDEO ||
+        ofp->flags                 != opts->flags                  ||
+        ofp->ts_offset             != opts->ts_offset              ||
+        ofp->trim_start_us         != opts->trim_start_us          ||
+        ofp->trim_duration_us      != opts->trim_duration_us       ||
+        ofp->enc_timebase.num      != opts->output_tb.num          ||
+        ofp->enc_timebase.den      != opts->output_tb.den          ||
+        !dict_equal(ofp->sws_opts,    opts->sws_opts))
+        return 0;
+
+    if (ofp->width  != opts->width ||
+        ofp->height != opts->height)
+        return 0;
+
+    if (opts->format != AV_PIX_FMT_NONE ?
+        ofp->format != opts->format :
+        (ofp->format != -1 || ofp->pix_fmts != opts->pix_fmts))
+        return 0;
+    if (opts->color_space != AVCOL_SPC_UNSPECIFIED ?
+        ofp->color_space != opts->color_space :
+        (ofp->color_space  != AVCOL_SPC_UNSPECIFIED ||
+         ofp->color_spaces != opts->color_spaces))
+        return 0;
+    if (opts->color_range != AVCOL_RANGE_UNSPECIFIED ?
+        ofp->color_range != opts->color_range :
+        (ofp->color_range  != AVCOL_RANGE_UNSPECIFIED ||
+         ofp->color_ranges != opts->color_ranges))
+        return 0;
+    if (opts->alpha_mode != AVALPHA_MODE_UNSPECIFIED ?
+        ofp->alpha_mode != opts->alpha_mode :
+        (ofp->alpha_mode  != AVALPHA_MODE_UNSPECIFIED ||
+         ofp->alpha_modes != opts->alpha_modes))
+        return 0;
+
+    /* unset rationals are 0/0, which av_cmp_q() never reports as equal */
+    return ofp->fps.vsync_method        == opts->vsync_method        &&
+           ofp->fps.framerate.num       == opts->frame_rate.num      &&
+           ofp->fps.framerate.den       == opts->frame_rate.den      &&
+           ofp->fps.framerate_max.num   == opts->max_frame_rate.num  &&
+           ofp->fps.framerate_max.den   == opts->max_frame_rate.den  &&
+           ofp->fps.framerate_supported == opts->frame_rates         &&
+           ofp->fps.framerate_clip      == framerate_clip;
+}
+
+int fg_simple_share(FilterGraph *fg, const char *graph_desc,
+                    unsigned sched_idx_enc, const OutputFilterOptions *opts)
+{
+    FilterGraphPriv  *fgp = fgp_from_fg(fg);
+    OutputFilterPriv *ofp;
+    int ret;
+
+    if (!fgp->is_simple || strcmp(fg->graph_desc, graph_desc) ||
+        (opts->vs ? memcmp(opts->vs, &fgp->vs, sizeof(fgp->vs)) :
+                    fgp->vs.type != VIEW_SPECIFIER_TYPE_NONE)  ||
+        (opts->nb_threads >= 0 ? opts->nb_threads : -1) != fgp->nb_threads)
+        return 0;
+
+    ofp = ofp_from_ofilter(fg->outputs[0]);
+    if (!ofp->ofilter.bound || !ofilter_opts_match(ofp, opts))
+        return 0;
+
+    ret = sch_connect(fgp->sch, SCH_FILTER_OUT(fgp->sch_idx, 0),
+                                SCH_ENC(sched_idx_enc));
+    if (ret < 0)
+        return ret;
+
+    av_log(fg, AV_LOG_VERBOSE, "Output %s shares the filtergraph\n", opts->name);
+
+    return 1;
+}
+
 static int fg_complex_bind_input(FilterGraph *fg, InputFilter *ifilter, int commit)
 {
     InputFilterPriv *ifp = ifp_from_ifilter(ifilter);
@@ -2075,6 +2178,12 @@ static int configure_filtergraph(FilterGraph *fg, FilterGraphThread *fgt)
     if (!fgt->graph)
         return AVERROR(ENOMEM);
 
+    if (filter_thread_type) {
+        ret = av_opt_set(fgt->graph, "thread_type", filter_thread_type, 0);
+        if (ret < 0)
+            goto fail;
+    }
+
     if (simple) {
         OutputFilterPriv *ofp = ofp_from_ofilter(fg->outputs[0]);
 
@@ -726,6 +726,9 @@ static void mux_final_stats(Muxer *mux)
                    ost->enc->frames_encoded);
             if (type == AVMEDIA_TYPE_AUDIO)
                 av_log(of, AV_LOG_VERBOSE, " (%"PRIu64" samples)", ost->enc->samples_encoded);
+            if (ost->filter_shared)
+                av_log(of, AV_LOG_VERBOSE, " (%"PRIu64" filtered frames shared)",
+                       sch_enc_frames_shared(mux->sch, ms->sch_idx_enc));
             av_log(of, AV_LOG_VERBOSE, "; ");
         }
 
@@ -899,6 +899,31 @@ static int new_stream_subtitle(Muxer *mux, const OptionsContext *o,
     return 0;
 }
 
+/* Look for an existing simple filtergraph processing the same input stream
+ * that can feed this stream's encoder. */
+static int ost_share_filtergraph(OutputStream *ost, const char *filters,
+                                 unsigned sched_idx_enc,
+                                 const OutputFilterOptions *opts)
+{
+    for (OutputStream *o = ost_iter(NULL); o; o = ost_iter(o)) {
+        int ret;
+
+        if (o == ost || !o->fg_simple || o->ist != ost->ist)
+            continue;
+
+        ret = fg_simple_share(o->fg_simple, filters, sched_idx_enc, opts);
+        if (ret < 0)
+            return ret;
+        if (ret > 0) {
+            ost->filter        = o->fg_simple->outputs[0];
+            ost->filter_shared = 1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 static int
 ost_bind_filter(const Muxer *mux, MuxStream *ms, OutputFilter *ofilter,
                 const OptionsContext *o,
@@ -1008,14 +1033,22 @@ ost_bind_filter(const Muxer *mux, MuxStream *ms, OutputFilter *ofilter,
         ost->filter = ofilter;
         ret = ofilter_bind_enc(ofilter, ms->sch_idx_enc, &opts);
     } else {
-        ret = fg_create_simple(&ost->fg_simple, ost->ist, &filters,
-                               mux->sch, ms->sch_idx_enc, &opts);
-        if (ret >= 0)
-            ost->filter = ost->fg_simple->outputs[0];
-
+        ret = share_filtergraphs ?
+              ost_share_filtergraph(ost, filters, ms->sch_idx_enc, &opts) : 0;
+        if (ret > 0) {
+            av_freep(&filters);
+            ret = 0;
+        } else if (ret == 0) {
+            ret = fg_create_simple(&ost->fg_simple, ost->ist, &filters,
+                                   mux->sch, ms->sch_idx_enc, &opts);
+            if (ret >= 0)
+                ost->filter = ost->fg_simple->outputs[0];
+        }
     }
-    if (ret < 0)
+    if (ret < 0) {
+        av_freep(&filters);
         return ret;
+    }
 
     *src = SCH_ENC(ms->sch_idx_enc);
 
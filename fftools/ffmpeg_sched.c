@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <inttypes.h>
 #include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -69,6 +70,10 @@ typedef struct SchTask {
 
     pthread_t           thread;
     int                 thread_running;
+
+    // this task currently holds one of Scheduler.max_active slots;
+    // only accessed from the task's own thread
+    int                 active;
 } SchTask;
 
 typedef struct SchDecOutput {
@@ -145,6 +150,10 @@ typedef struct SchEnc {
 
     // temporary storage used by sch_enc_send()
     AVPacket           *send_pkt;
+
+    // number of frames received from a filtergraph output shared with
+    // another encoder that also received them, i.e. filtering runs saved
+    atomic_uint_least64_t frames_shared;
 } SchEnc;
 
 typedef struct SchDemuxStream {
@@ -239,7 +248,11 @@ typedef struct SchFilterIn {
 } SchFilterIn;
 
 typedef struct SchFilterOut {
-    SchedulerNode       dst;
+    // Normally there is a single destination; several encoders may share one
+    // output when their input requirements are identical.
+    SchedulerNode      *dst;
+    uint8_t            *dst_finished;
+    unsigned         nb_dst;
 } SchFilterOut;
 
 typedef struct SchFilterGraph {
@@ -259,6 +272,9 @@ typedef struct SchFilterGraph {
     ThreadQueue        *queue;
     SchWaiter           waiter;
 
+    // temporary storage used by sch_filter_send()
+    AVFrame            *send_frame;
+
     // protected by schedule_lock
     unsigned            best_input;
     int                 task_exited;
@@ -287,6 +303,19 @@ struct Scheduler {
     pthread_mutex_t     finish_lock;
     pthread_cond_t      finish_cond;
 
+    /* Maximum number of tasks allowed to run outside of the scheduler at the
+     * same time, 0 for no limit. Tasks release their slot while blocked in
+     * any of the scheduler send/receive calls, so back-pressure is still
+     * provided by the thread queues. Starting a muxer may block until the
+     * muxer task drains its pre-muxing queue, so that must never happen
+     * while holding a slot: encoders, which open subtitle encoders (and thus
+     * mark muxer streams as ready) from their own thread, only take a slot
+     * once they first receive a frame. */
+    unsigned            max_active;
+    unsigned         nb_active;
+    uint64_t            nb_active_waits;
+    pthread_mutex_t     active_lock;
+    pthread_cond_t      active_cond;
 
     SchDec             *dec;
     unsigned         nb_dec;
@@ -399,6 +428,51 @@ static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_si
     return 0;
 }
 
+/**
+ * Acquire a slot for running the task, waiting until one becomes available
+ * when the limit set with sch_set_max_active() has been reached.
+ */
+static void task_activate(SchTask *task)
+{
+    Scheduler *sch = task->parent;
+
+    if (!sch || !sch->max_active || task->active)
+        return;
+
+    pthread_mutex_lock(&sch->active_lock);
+
+    if (sch->nb_active >= sch->max_active)
+        sch->nb_active_waits++;
+
+    // allow exceeding the limit when terminating, so that all tasks can exit
+    while (sch->nb_active >= sch->max_active && !atomic_load(&sch->terminate))
+        pthread_cond_wait(&sch->active_cond, &sch->active_lock);
+
+    sch->nb_active++;
+
+    pthread_mutex_unlock(&sch->active_lock);
+
+    task->active = 1;
+}
+
+static void task_deactivate(SchTask *task)
+{
+    Scheduler *sch = task->parent;
+
+    if (!task->active)
+        return;
+
+    pthread_mutex_lock(&sch->active_lock);
+
+    av_assert0(sch->nb_active > 0);
+    sch->nb_active--;
+    pthread_cond_signal(&sch->active_cond);
+
+    pthread_mutex_unlock(&sch->active_lock);
+
+    task->active = 0;
+}
+
 static void *task_wrapper(void *arg);
 
 static int task_start(SchTask *task)
@@ -468,9 +542,15 @@ void sch_remove_filtergraph(Scheduler *sch, int idx)
 
     av_freep(&fg->inputs);
     fg->nb_inputs = 0;
+    for (unsigned i = 0; i < fg->nb_outputs; i++) {
+        av_freep(&fg->outputs[i].dst);
+        av_freep(&fg->outputs[i].dst_finished);
+    }
     av_freep(&fg->outputs);
     fg->nb_outputs = 0;
 
+    av_frame_free(&fg->send_frame);
+
     fg->task_exited = 1;
 }
 
@@ -569,8 +649,14 @@ void sch_free(Scheduler **psch)
         tq_free(&fg->queue);
 
         av_freep(&fg->inputs);
+        for (unsigned j = 0; j < fg->nb_outputs; j++) {
+            av_freep(&fg->outputs[j].dst);
+            av_freep(&fg->outputs[j].dst_finished);
+        }
         av_freep(&fg->outputs);
 
+        av_frame_free(&fg->send_frame);
+
         waiter_uninit(&fg->waiter);
     }
     av_freep(&sch->filters);
@@ -584,6 +670,9 @@ void sch_free(Scheduler **psch)
     pthread_mutex_destroy(&sch->finish_lock);
     pthread_cond_destroy(&sch->finish_cond);
 
+    pthread_mutex_destroy(&sch->active_lock);
+    pthread_cond_destroy(&sch->active_cond);
+
     av_freep(psch);
 }
 
@@ -620,6 +709,14 @@ Scheduler *sch_alloc(void)
     if (ret)
         goto fail;
 
+    ret = pthread_mutex_init(&sch->active_lock, NULL);
+    if (ret)
+        goto fail;
+
+    ret = pthread_cond_init(&sch->active_cond, NULL);
+    if (ret)
+        goto fail;
+
     return sch;
 fail:
     sch_free(&sch);
@@ -633,6 +730,15 @@ int sch_sdp_filename(Scheduler *sch, const char *sdp_filename)
     return sch->sdp_filename ? 0 : AVERROR(ENOMEM);
 }
 
+int sch_set_max_active(Scheduler *sch, unsigned max_active)
+{
+    if (sch->state != SCH_STATE_UNINIT)
+        return AVERROR(EINVAL);
+
+    sch->max_active = max_active;
+    return 0;
+}
+
 static const AVClass sch_mux_class = {
     .class_name                = "SchMux",
     .version                   = LIBAVUTIL_VERSION_INT,
@@ -823,6 +929,8 @@ int sch_add_enc(Scheduler *sch, SchThreadFunc func, void *ctx,
     if (!enc->send_pkt)
         return AVERROR(ENOMEM);
 
+    atomic_init(&enc->frames_shared, 0);
+
     ret = queue_alloc(&enc->queue, 1, 0, QUEUE_FRAMES);
     if (ret < 0)
         return ret;
@@ -867,6 +975,10 @@ int sch_add_filtergraph(Scheduler *sch, unsigned nb_inputs, unsigned nb_outputs,
         fg->nb_outputs = nb_outputs;
     }
 
+    fg->send_frame = av_frame_alloc();
+    if (!fg->send_frame)
+        return AVERROR(ENOMEM);
+
     ret = waiter_init(&fg->waiter);
     if (ret < 0)
         return ret;
@@ -1032,8 +1144,16 @@ int sch_connect(Scheduler *sch, SchedulerNode src, SchedulerNode dst)
                    src.idx_stream < sch->filters[src.idx].nb_outputs);
         fo = &sch->filters[src.idx].outputs[src.idx_stream];
 
-        av_assert0(!fo->dst.type);
-        fo->dst = dst;
+        // only encoders may share a filtergraph output
+        av_assert0(!fo->nb_dst ||
+                   (dst.type == SCH_NODE_TYPE_ENC &&
+                    fo->dst[0].type == SCH_NODE_TYPE_ENC));
+
+        ret = GROW_ARRAY(fo->dst, fo->nb_dst);
+        if (ret < 0)
+            return ret;
+
+        fo->dst[fo->nb_dst - 1] = dst;
 
         // filtered frames go to encoding or another filtergraph
         switch (dst.type) {
@@ -1680,11 +1800,15 @@ static int start_prepare(Scheduler *sch)
         for (unsigned j = 0; j < fg->nb_outputs; j++) {
             SchFilterOut *fo = &fg->outputs[j];
 
-            if (!fo->dst.type) {
+            if (!fo->nb_dst) {
                 av_log(fg, AV_LOG_ERROR,
                        "Filtergraph %u output %u not connected to a sink\n", i, j);
                 return AVERROR(EINVAL);
             }
+
+            fo->dst_finished = av_calloc(fo->nb_dst, sizeof(*fo->dst_finished));
+            if (!fo->dst_finished)
+                return AVERROR(ENOMEM);
         }
     }
 
@@ -2134,8 +2258,8 @@ static int demux_flush(Scheduler *sch, SchDemux *d, AVPacket *pkt)
     return 0;
 }
 
-int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
-                   unsigned flags)
+static int demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
+                      unsigned flags)
 {
     SchDemux *d;
     int terminate;
@@ -2156,6 +2280,22 @@ int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
     return demux_send_for_stream(sch, d, &d->streams[pkt->stream_index], pkt, flags);
 }
 
+int sch_demux_send(Scheduler *sch, unsigned demux_idx, AVPacket *pkt,
+                   unsigned flags)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(demux_idx < sch->nb_demux);
+    task = &sch->demux[demux_idx].task;
+
+    task_deactivate(task);
+    ret = demux_send(sch, demux_idx, pkt, flags);
+    task_activate(task);
+
+    return ret;
+}
+
 static int demux_done(Scheduler *sch, unsigned demux_idx)
 {
     SchDemux *d = &sch->demux[demux_idx];
@@ -2178,7 +2318,7 @@ static int demux_done(Scheduler *sch, unsigned demux_idx)
     return ret;
 }
 
-int sch_mux_receive(Scheduler *sch, unsigned mux_idx, AVPacket *pkt)
+static int mux_receive(Scheduler *sch, unsigned mux_idx, AVPacket *pkt)
 {
     SchMux *mux;
     int ret, stream_idx;
@@ -2191,6 +2331,21 @@ int sch_mux_receive(Scheduler *sch, unsigned mux_idx, AVPacket *pkt)
     return ret;
 }
 
+int sch_mux_receive(Scheduler *sch, unsigned mux_idx, AVPacket *pkt)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(mux_idx < sch->nb_mux);
+    task = &sch->mux[mux_idx].task;
+
+    task_deactivate(task);
+    ret = mux_receive(sch, mux_idx, pkt);
+    task_activate(task);
+
+    return ret;
+}
+
 void sch_mux_receive_finish(Scheduler *sch, unsigned mux_idx, unsigned stream_idx)
 {
     SchMux *mux;
@@ -2209,8 +2364,8 @@ void sch_mux_receive_finish(Scheduler *sch, unsigned mux_idx, unsigned stream_id
     pthread_mutex_unlock(&sch->schedule_lock);
 }
 
-int sch_mux_sub_heartbeat(Scheduler *sch, unsigned mux_idx, unsigned stream_idx,
-                          const AVPacket *pkt)
+static int mux_sub_heartbeat(Scheduler *sch, unsigned mux_idx, unsigned stream_idx,
+                             const AVPacket *pkt)
 {
     SchMux       *mux;
     SchMuxStream *ms;
@@ -2235,6 +2390,22 @@ int sch_mux_sub_heartbeat(Scheduler *sch, unsigned mux_idx, unsigned stream_idx,
     return 0;
 }
 
+int sch_mux_sub_heartbeat(Scheduler *sch, unsigned mux_idx, unsigned stream_idx,
+                          const AVPacket *pkt)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(mux_idx < sch->nb_mux);
+    task = &sch->mux[mux_idx].task;
+
+    task_deactivate(task);
+    ret = mux_sub_heartbeat(sch, mux_idx, stream_idx, pkt);
+    task_activate(task);
+
+    return ret;
+}
+
 static int mux_done(Scheduler *sch, unsigned mux_idx)
 {
     SchMux *mux = &sch->mux[mux_idx];
@@ -2262,7 +2433,7 @@ static int mux_done(Scheduler *sch, unsigned mux_idx)
     return 0;
 }
 
-int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
+static int dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
 {
     SchDec *dec;
     int ret, dummy;
@@ -2291,6 +2462,21 @@ int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
     return ret;
 }
 
+int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(dec_idx < sch->nb_dec);
+    task = &sch->dec[dec_idx].task;
+
+    task_deactivate(task);
+    ret = dec_receive(sch, dec_idx, pkt);
+    task_activate(task);
+
+    return ret;
+}
+
 static int send_to_filter(Scheduler *sch, SchFilterGraph *fg,
                           unsigned in_idx, AVFrame *frame)
 {
@@ -2344,8 +2530,8 @@ finish:
     return AVERROR_EOF;
 }
 
-int sch_dec_send(Scheduler *sch, unsigned dec_idx,
-                 unsigned out_idx, AVFrame *frame)
+static int dec_send(Scheduler *sch, unsigned dec_idx,
+                    unsigned out_idx, AVFrame *frame)
 {
     SchDec *dec;
     SchDecOutput *o;
@@ -2388,6 +2574,22 @@ int sch_dec_send(Scheduler *sch, unsigned dec_idx,
     return (nb_done == o->nb_dst) ? AVERROR_EOF : 0;
 }
 
+int sch_dec_send(Scheduler *sch, unsigned dec_idx,
+                 unsigned out_idx, AVFrame *frame)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(dec_idx < sch->nb_dec);
+    task = &sch->dec[dec_idx].task;
+
+    task_deactivate(task);
+    ret = dec_send(sch, dec_idx, out_idx, frame);
+    task_activate(task);
+
+    return ret;
+}
+
 static int dec_done(Scheduler *sch, unsigned dec_idx)
 {
     SchDec *dec = &sch->dec[dec_idx];
@@ -2413,7 +2615,7 @@ static int dec_done(Scheduler *sch, unsigned dec_idx)
     return ret;
 }
 
-int sch_enc_receive(Scheduler *sch, unsigned enc_idx, AVFrame *frame)
+static int enc_receive(Scheduler *sch, unsigned enc_idx, AVFrame *frame)
 {
     SchEnc *enc;
     int ret, dummy;
@@ -2427,6 +2629,21 @@ int sch_enc_receive(Scheduler *sch, unsigned enc_idx, AVFrame *frame)
     return ret;
 }
 
+int sch_enc_receive(Scheduler *sch, unsigned enc_idx, AVFrame *frame)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(enc_idx < sch->nb_enc);
+    task = &sch->enc[enc_idx].task;
+
+    task_deactivate(task);
+    ret = enc_receive(sch, enc_idx, frame);
+    task_activate(task);
+
+    return ret;
+}
+
 static int enc_send_to_dst(Scheduler *sch, const SchedulerNode dst,
                            uint8_t *dst_finished, AVPacket *pkt)
 {
@@ -2457,7 +2674,7 @@ finish:
     return AVERROR_EOF;
 }
 
-int sch_enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
+static int enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
 {
     SchEnc *enc;
     int ret;
@@ -2490,6 +2707,27 @@ int sch_enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
     return 0;
 }
 
+int sch_enc_send(Scheduler *sch, unsigned enc_idx, AVPacket *pkt)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(enc_idx < sch->nb_enc);
+    task = &sch->enc[enc_idx].task;
+
+    task_deactivate(task);
+    ret = enc_send(sch, enc_idx, pkt);
+    task_activate(task);
+
+    return ret;
+}
+
+uint64_t sch_enc_frames_shared(Scheduler *sch, unsigned enc_idx)
+{
+    av_assert0(enc_idx < sch->nb_enc);
+    return atomic_load(&sch->enc[enc_idx].frames_shared);
+}
+
 static int enc_done(Scheduler *sch, unsigned enc_idx)
 {
     SchEnc *enc = &sch->enc[enc_idx];
@@ -2506,8 +2744,8 @@ static int enc_done(Scheduler *sch, unsigned enc_idx)
     return ret;
 }
 
-int sch_filter_receive(Scheduler *sch, unsigned fg_idx,
-                       unsigned *in_idx, AVFrame *frame)
+static int filter_receive(Scheduler *sch, unsigned fg_idx,
+                          unsigned *in_idx, AVFrame *frame)
 {
     SchFilterGraph *fg;
 
@@ -2550,6 +2788,22 @@ int sch_filter_receive(Scheduler *sch, unsigned fg_idx,
     }
 }
 
+int sch_filter_receive(Scheduler *sch, unsigned fg_idx,
+                       unsigned *in_idx, AVFrame *frame)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(fg_idx < sch->nb_filters);
+    task = &sch->filters[fg_idx].task;
+
+    task_deactivate(task);
+    ret = filter_receive(sch, fg_idx, in_idx, frame);
+    task_activate(task);
+
+    return ret;
+}
+
 void sch_filter_receive_finish(Scheduler *sch, unsigned fg_idx, unsigned in_idx)
 {
     SchFilterGraph *fg;
@@ -2577,17 +2831,13 @@ void sch_filter_receive_finish(Scheduler *sch, unsigned fg_idx, unsigned in_idx)
     pthread_mutex_unlock(&sch->schedule_lock);
 }
 
-int sch_filter_send(Scheduler *sch, unsigned fg_idx, unsigned out_idx, AVFrame *frame)
+static int filter_send_to_dst(Scheduler *sch, const SchedulerNode dst,
+                              uint8_t *dst_finished, AVFrame *frame)
 {
-    SchFilterGraph *fg;
-    SchedulerNode  dst;
     int ret;
 
-    av_assert0(fg_idx < sch->nb_filters);
-    fg = &sch->filters[fg_idx];
-
-    av_assert0(out_idx < fg->nb_outputs);
-    dst = fg->outputs[out_idx].dst;
+    if (*dst_finished)
+        return AVERROR_EOF;
 
     if (dst.type == SCH_NODE_TYPE_ENC) {
         ret = send_to_enc(sch, &sch->enc[dst.idx], frame);
@@ -2598,6 +2848,78 @@ int sch_filter_send(Scheduler *sch, unsigned fg_idx, unsigned out_idx, AVFrame *
         if (ret == AVERROR_EOF)
             send_to_filter(sch, &sch->filters[dst.idx], dst.idx_stream, NULL);
     }
+
+    if (ret == AVERROR_EOF || !frame)
+        *dst_finished = 1;
+
+    return ret;
+}
+
+static int filter_send(Scheduler *sch, unsigned fg_idx, unsigned out_idx, AVFrame *frame)
+{
+    SchFilterGraph *fg;
+    SchFilterOut   *fo;
+    int ret, has_data;
+    unsigned nb_done = 0, nb_sent = 0;
+
+    av_assert0(fg_idx < sch->nb_filters);
+    fg = &sch->filters[fg_idx];
+
+    av_assert0(out_idx < fg->nb_outputs);
+    fo = &fg->outputs[out_idx];
+
+    // single destination, hand over the frame directly
+    if (fo->nb_dst == 1)
+        return filter_send_to_dst(sch, fo->dst[0], &fo->dst_finished[0], frame);
+
+    // empty frames only carrying encoder parameters are not filtered
+    has_data = frame && frame->buf[0];
+
+    for (unsigned i = 0; i < fo->nb_dst; i++) {
+        AVFrame *to_send = frame;
+
+        // all destinations share the same data, so just make a new reference
+        // for all but the last one, which consumes the original frame
+        if (frame && i < fo->nb_dst - 1) {
+            to_send = fg->send_frame;
+
+            ret = av_frame_ref(to_send, frame);
+            if (ret < 0)
+                return ret;
+        }
+
+        ret = filter_send_to_dst(sch, fo->dst[i], &fo->dst_finished[i], to_send);
+
+        // A destination taking the frame moves its data away, possibly while
+        // also returning EOF, e.g. when it reaches its frame limit. Only the
+        // destinations after the first one taking it avoided filtering it.
+        if (has_data && !to_send->buf[0] && nb_sent++)
+            atomic_fetch_add(&sch->enc[fo->dst[i].idx].frames_shared, 1);
+
+        if (to_send)
+            av_frame_unref(to_send);
+        if (ret == AVERROR_EOF) {
+            nb_done++;
+            continue;
+        } else if (ret < 0)
+            return ret;
+    }
+
+    return (nb_done == fo->nb_dst) ? AVERROR_EOF : 0;
+}
+
+int sch_filter_send(Scheduler *sch, unsigned fg_idx, unsigned out_idx, AVFrame *frame)
+{
+    SchTask *task;
+    int ret;
+
+    av_assert0(fg_idx < sch->nb_filters);
+    task = &sch->filters[fg_idx].task;
+
+    task_deactivate(task);
+    ret = filter_send(sch, fg_idx, out_idx, frame);
+    task_activate(task);
+
     return ret;
 }
 
@@ -2610,13 +2932,17 @@ static int filter_done(Scheduler *sch, unsigned fg_idx)
         tq_receive_finish(fg->queue, i);
 
     for (unsigned i = 0; i < fg->nb_outputs; i++) {
-        SchedulerNode dst = fg->outputs[i].dst;
-        int err = (dst.type == SCH_NODE_TYPE_ENC)                                   ?
-                  send_to_enc   (sch, &sch->enc[dst.idx],                     NULL) :
-                  send_to_filter(sch, &sch->filters[dst.idx], dst.idx_stream, NULL);
+        SchFilterOut *fo = &fg->outputs[i];
 
-        if (err < 0 && err != AVERROR_EOF)
-            ret = err_merge(ret, err);
+        for (unsigned j = 0; j < fo->nb_dst; j++) {
+            SchedulerNode dst = fo->dst[j];
+            int err = (dst.type == SCH_NODE_TYPE_ENC)                                   ?
+                      send_to_enc   (sch, &sch->enc[dst.idx],                     NULL) :
+                      send_to_filter(sch, &sch->filters[dst.idx], dst.idx_stream, NULL);
+
+            if (err < 0 && err != AVERROR_EOF)
+                ret = err_merge(ret, err);
+        }
     }
 
     pthread_mutex_lock(&sch->schedule_lock);
@@ -2671,7 +2997,10 @@ static void *task_wrapper(void *arg)
     int ret;
     int err = 0;
 
+    if (task->node.type != SCH_NODE_TYPE_ENC)
+        task_activate(task);
     ret = task->func(task->func_arg);
+    task_deactivate(task);
     if (ret < 0)
         av_log(task->func_arg, AV_LOG_ERROR,
                "Task finished with error code: %d (%s)\n", ret, av_err2str(ret));
@@ -2724,6 +3053,10 @@ int sch_stop(Scheduler *sch, int64_t *finish_ts)
 
     atomic_store(&sch->terminate, 1);
 
+    pthread_mutex_lock(&sch->active_lock);
+    pthread_cond_broadcast(&sch->active_cond);
+    pthread_mutex_unlock(&sch->active_lock);
+
     for (unsigned type = 0; type < 2; type++)
         for (unsigned i = 0; i < (type ? sch->nb_demux : sch->nb_filters); i++) {
             SchWaiter *w = type ? &sch->demux[i].waiter : &sch->filters[i].waiter;
@@ -2770,6 +3103,10 @@ int sch_stop(Scheduler *sch, int64_t *finish_ts)
     if (finish_ts)
         *finish_ts = trailing_dts(sch, 1);
 
+    if (sch->max_active)
+        av_log(sch, AV_LOG_VERBOSE, "Tasks waited %"PRIu64" times for one of "
+               "%u active slots\n", sch->nb_active_waits, sch->max_active);
+
     sch->state = SCH_STATE_STOPPED;
 
     return ret;
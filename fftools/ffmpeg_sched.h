@@ -74,9 +74,11 @@
  * - encoding and muxing output from filtergraph(s) that have no inputs;
  * - creating a file that contains nothing but attachments and/or metadata.
  *
- * N.B. 2: a filtergraph output could, in principle, feed multiple encoders, but
- * this is unnecessary because the (a)split filter provides the same
- * functionality.
+ * N.B. 2: a filtergraph output normally feeds exactly one consumer, since the
+ * (a)split filter provides fan-out inside filtergraphs. The only exception is
+ * several encoders with identical input requirements sharing the output of
+ * one simple filtergraph; they then all receive references to the same
+ * read-only frames.
  *
  * The scheduler, in the above model, is the master object that oversees and
  * facilitates the transcoding process. The basic idea is that all instances
@@ -300,6 +302,21 @@ int sch_mux_stream_ready(Scheduler *sch, unsigned mux_idx, unsigned stream_idx);
  */
 int sch_sdp_filename(Scheduler *sch, const char *sdp_filename);
 
+/**
+ * Limit the number of tasks that may be running at the same time.
+ *
+ * Every component still gets its own thread, but a task only competes for
+ * CPU time while it holds one of max_active slots. The slot is released for
+ * the duration of every blocking send/receive call into the scheduler, so
+ * this bounds CPU oversubscription on graphs with many components without
+ * affecting back-pressure.
+ *
+ * Must be called before sch_start().
+ *
+ * @param max_active maximum number of running tasks, 0 for no limit
+ */
+int sch_set_max_active(Scheduler *sch, unsigned max_active);
+
 /**
  * Add an encoder to the scheduler.
  *
@@ -479,6 +496,15 @@ int sch_enc_receive(Scheduler *sch, unsigned enc_idx, struct AVFrame *frame);
  */
 int sch_enc_send   (Scheduler *sch, unsigned enc_idx, struct AVPacket *pkt);
 
+/**
+ * Get the number of frames an encoder received from a filtergraph output
+ * which also delivered them to another encoder, i.e. the number of times
+ * filtering was avoided by sharing the filtergraph.
+ *
+ * @param enc_idx Encoder index previously returned by sch_add_enc().
+ */
+uint64_t sch_enc_frames_shared(Scheduler *sch, unsigned enc_idx);
+
 /**
  * Called by muxer tasks to obtain packets for muxing. Will wait for a packet
  * for any muxed stream to become available and return it in pkt.
@@ -30,6 +30,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "libavutil/timecode.h"
 #include "decode.h"
 #include "cabac.h"
@@ -2511,8 +2512,11 @@ static void predict_field_decoding_flag(const H264Context *h, H264SliceContext *
 
 /**
  * Draw edges and report progress for the last MB row.
+ *
+ * @param error_occurred error status of the picture once the row was decoded
  */
-static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
+static void decode_finish_row(const H264Context *h, H264SliceContext *sl,
+                              int error_occurred)
 {
     int top            = 16 * (sl->mb_y      >> FIELD_PICTURE(h));
     int pic_height     = 16 *  h->mb_height >> FIELD_PICTURE(h);
@@ -2536,13 +2540,251 @@ static void decode_finish_row(const H264Context *h, H264SliceContext *sl)
 
     ff_h264_draw_horiz_band(h, sl, top, height);
 
-    if (h->droppable || h->er.error_occurred)
+    if (h->droppable || error_occurred)
         return;
 
     ff_thread_report_progress(&h->cur_pic_ptr->tf, top + height - 1,
                               h->picture_structure == PICT_BOTTOM_FIELD);
 }
 
+#if HAVE_THREADS
+/**
+ * State of the thread deblocking the MB rows of a slice behind the decoding
+ * thread.
+ *
+ * Decoding MB row y + 1 temporarily swaps the unfiltered bottom line of row y
+ * into the picture for intra prediction, so row y may only be deblocked once
+ * row y + 1 is fully decoded. The decoding thread saves the unfiltered borders
+ * itself right after each row, and the deblocking thread lags one row behind.
+ */
+typedef struct H264DeblockThread {
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+
+    /* copy of the slice context, owned by the deblocking thread while rows
+     * are pending; it has its own top borders so that backing them up in
+     * loop_filter() does not touch the ones used by the decoding thread */
+    H264SliceContext sl;
+    uint8_t (*top_borders[2])[(16 * 3) * 2];
+    unsigned int top_borders_allocated[2];
+
+    int first_row;      ///< first MB row of the slice
+    int first_x;        ///< first MB column of the first row
+    int rows_queued;    ///< MB rows below this one may be deblocked
+    int rows_done;      ///< MB rows below this one have been deblocked
+    /* error status of the picture when the rows were queued, the decoding
+     * thread may set it again meanwhile */
+    int error_occurred;
+    int exit;
+} H264DeblockThread;
+
+static void *deblock_thread_worker(void *arg)
+{
+    H264DeblockThread *dt = arg;
+    H264SliceContext  *sl = &dt->sl;
+
+    pthread_mutex_lock(&dt->mutex);
+    for (;;) {
+        int row, end, error_occurred;
+
+        while (!dt->exit && dt->rows_done == dt->rows_queued)
+            pthread_cond_wait(&dt->cond, &dt->mutex);
+        if (dt->exit)
+            break;
+        row            = dt->rows_done;
+        end            = dt->rows_queued;
+        error_occurred = dt->error_occurred;
+        pthread_mutex_unlock(&dt->mutex);
+
+        for (; row < end; row++) {
+            const H264Context *h = sl->h264;
+
+            sl->mb_y = row;
+            loop_filter(h, sl, row == dt->first_row ? dt->first_x : 0, h->mb_width);
+            decode_finish_row(h, sl, error_occurred);
+        }
+
+        pthread_mutex_lock(&dt->mutex);
+        dt->rows_done = end;
+        pthread_cond_broadcast(&dt->cond);
+    }
+    pthread_mutex_unlock(&dt->mutex);
+
+    return NULL;
+}
+
+static int deblock_thread_init(H264Context *h)
+{
+    H264DeblockThread *dt;
+    int ret;
+
+    dt = av_mallocz(sizeof(*dt));
+    if (!dt)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&dt->mutex, NULL))) {
+        av_free(dt);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&dt->cond, NULL))) {
+        pthread_mutex_destroy(&dt->mutex);
+        av_free(dt);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&dt->thread, NULL, deblock_thread_worker, dt))) {
+        pthread_cond_destroy(&dt->cond);
+        pthread_mutex_destroy(&dt->mutex);
+        av_free(dt);
+        return AVERROR(ret);
+    }
+
+    h->deblock_ctx = dt;
+    return 0;
+}
+
+/**
+ * Hand the deblocking of the slice over to the deblocking thread, once the
+ * slice context is fully set up.
+ */
+static int deblock_thread_start(const H264Context *h, H264SliceContext *sl)
+{
+    H264DeblockThread *dt = sl->deblock_thread;
+
+    for (int i = 0; i < 2; i++) {
+        av_fast_mallocz(&dt->top_borders[i], &dt->top_borders_allocated[i],
+                        h->mb_width * sizeof(*dt->top_borders[i]));
+        if (!dt->top_borders[i]) {
+            dt->top_borders_allocated[i] = 0;
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    /* the thread is idle between slices */
+    dt->sl                = *sl;
+    dt->sl.top_borders[0] = dt->top_borders[0];
+    dt->sl.top_borders[1] = dt->top_borders[1];
+    dt->first_row         = sl->mb_y;
+    dt->first_x           = sl->mb_x;
+    dt->rows_queued       =
+    dt->rows_done         = sl->mb_y;
+
+    return 0;
+}
+
+/**
+ * Save the unfiltered borders of the MB row that was just decoded and
+ * release the row above it to the deblocking thread.
+ */
+static void deblock_thread_queue_row(const H264Context *h, H264SliceContext *sl,
+                                     int start_x)
+{
+    H264DeblockThread *dt = sl->deblock_thread;
+    const int pixel_shift = h->pixel_shift;
+    const int block_h     = 16 >> h->chroma_y_shift;
+    const int mb_y        = sl->mb_y;
+
+    for (int mb_x = start_x; mb_x < h->mb_width; mb_x++) {
+        const int uvoffset = (mb_x << pixel_shift) * (8 << CHROMA444(h)) +
+                             mb_y * sl->uvlinesize * block_h;
+
+        sl->mb_x = mb_x;
+        backup_mb_border(h, sl,
+                         h->cur_pic.f->data[0] +
+                         ((mb_x << pixel_shift) + mb_y * sl->linesize) * 16,
+                         h->cur_pic.f->data[1] + uvoffset,
+                         h->cur_pic.f->data[2] + uvoffset,
+                         sl->linesize, sl->uvlinesize, 0);
+    }
+
+    pthread_mutex_lock(&dt->mutex);
+    dt->rows_queued    = mb_y;
+    dt->error_occurred = h->er.error_occurred;
+    pthread_cond_broadcast(&dt->cond);
+    pthread_mutex_unlock(&dt->mutex);
+}
+
+/**
+ * Deblock all fully decoded MB rows of the slice and stop using the
+ * deblocking thread for it.
+ */
+static void deblock_thread_flush(const H264Context *h, H264SliceContext *sl)
+{
+    H264DeblockThread *dt = sl->deblock_thread;
+
+    if (!dt)
+        return;
+
+    pthread_mutex_lock(&dt->mutex);
+    dt->rows_queued    = FFMAX(dt->rows_queued, sl->mb_y);
+    dt->error_occurred = h->er.error_occurred;
+    pthread_cond_broadcast(&dt->cond);
+    while (dt->rows_done != dt->rows_queued)
+        pthread_cond_wait(&dt->cond, &dt->mutex);
+    pthread_mutex_unlock(&dt->mutex);
+
+    sl->deblock_thread = NULL;
+}
+
+void ff_h264_deblock_thread_free(H264Context *h)
+{
+    H264DeblockThread *dt = h->deblock_ctx;
+
+    if (!dt)
+        return;
+
+    pthread_mutex_lock(&dt->mutex);
+    dt->exit = 1;
+    pthread_cond_broadcast(&dt->cond);
+    pthread_mutex_unlock(&dt->mutex);
+    pthread_join(dt->thread, NULL);
+
+    pthread_cond_destroy(&dt->cond);
+    pthread_mutex_destroy(&dt->mutex);
+    av_freep(&dt->top_borders[0]);
+    av_freep(&dt->top_borders[1]);
+    av_freep(&h->deblock_ctx);
+}
+#else
+static int deblock_thread_init(H264Context *h)
+{
+    return AVERROR(ENOSYS);
+}
+
+static int deblock_thread_start(const H264Context *h, H264SliceContext *sl)
+{
+    return AVERROR(ENOSYS);
+}
+
+static void deblock_thread_queue_row(const H264Context *h, H264SliceContext *sl,
+                                     int start_x)
+{
+}
+
+static void deblock_thread_flush(const H264Context *h, H264SliceContext *sl)
+{
+}
+
+void ff_h264_deblock_thread_free(H264Context *h)
+{
+}
+#endif
+
+/**
+ * Deblock the MB row that was just decoded, or queue it for the deblocking
+ * thread.
+ */
+static void finish_row(const H264Context *h, H264SliceContext *sl, int lf_x_start)
+{
+    if (sl->deblock_thread) {
+        deblock_thread_queue_row(h, sl, lf_x_start);
+        return;
+    }
+
+    loop_filter(h, sl, lf_x_start, h->mb_width);
+    decode_finish_row(h, sl, h->er.error_occurred);
+}
+
 static void er_add_slice(H264SliceContext *sl,
                          int startx, int starty,
                          int endx, int endy, int status)
@@ -2577,6 +2819,14 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     if (h->postpone_filter)
         sl->deblocking_filter = 0;
 
+    if (sl->deblock_thread) {
+        ret = deblock_thread_start(h, sl);
+        if (ret < 0) {
+            sl->deblock_thread = NULL;
+            return ret;
+        }
+    }
+
     sl->is_complex = FRAME_MBAFF(h) || h->picture_structure != PICT_FRAME ||
                      (CONFIG_GRAY && (h->flags & AV_CODEC_FLAG_GRAY));
 
@@ -2634,6 +2884,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                 sl->cabac.bytestream > sl->cabac.bytestream_end + 2) {
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x - 1,
                              sl->mb_y, ER_MB_END);
+                deblock_thread_flush(h, sl);
                 if (sl->mb_x >= lf_x_start)
                     loop_filter(h, sl, lf_x_start, sl->mb_x + 1);
                 goto finish;
@@ -2651,9 +2902,8 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             }
 
             if (++sl->mb_x >= h->mb_width) {
-                loop_filter(h, sl, lf_x_start, sl->mb_x);
+                finish_row(h, sl, lf_x_start);
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2667,6 +2917,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                         get_bits_count(&sl->gb), sl->gb.size_in_bits);
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x - 1,
                              sl->mb_y, ER_MB_END);
+                deblock_thread_flush(h, sl);
                 if (sl->mb_x > lf_x_start)
                     loop_filter(h, sl, lf_x_start, sl->mb_x);
                 goto finish;
@@ -2708,9 +2959,8 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             }
 
             if (++sl->mb_x >= h->mb_width) {
-                loop_filter(h, sl, lf_x_start, sl->mb_x);
+                finish_row(h, sl, lf_x_start);
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2743,6 +2993,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                 if (get_bits_left(&sl->gb) == 0) {
                     er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y,
                                  sl->mb_x - 1, sl->mb_y, ER_MB_END);
+                    deblock_thread_flush(h, sl);
                     if (sl->mb_x > lf_x_start)
                         loop_filter(h, sl, lf_x_start, sl->mb_x);
 
@@ -2784,11 +3035,23 @@ int ff_h264_execute_decode_slices(H264Context *h)
 
     if (context_count == 1) {
 
-        h->slice_ctx[0].next_slice_idx = h->mb_width * h->mb_height;
+        sl = &h->slice_ctx[0];
+        sl->next_slice_idx = h->mb_width * h->mb_height;
         h->postpone_filter = 0;
 
-        ret = decode_slice(avctx, &h->slice_ctx[0]);
-        h->mb_y = h->slice_ctx[0].mb_y;
+        if (h->deblock_thread && sl->deblocking_filter &&
+            h->picture_structure == PICT_FRAME && !FRAME_MBAFF(h)) {
+            if (!h->deblock_ctx) {
+                ret = deblock_thread_init(h);
+                if (ret < 0)
+                    goto finish;
+            }
+            sl->deblock_thread = h->deblock_ctx;
+        }
+
+        ret = decode_slice(avctx, sl);
+        deblock_thread_flush(h, sl);
+        h->mb_y = sl->mb_y;
         if (ret < 0)
             goto finish;
     } else {
@@ -283,6 +283,7 @@ typedef struct H264SliceContext {
     uint8_t *bipred_scratchpad;
     uint8_t *edge_emu_buffer;
     uint8_t (*top_borders[2])[(16 * 3) * 2];
+    struct H264DeblockThread *deblock_thread; ///< set while the rows of the slice are deblocked by a separate thread
     int bipred_scratchpad_allocated;
     int edge_emu_buffer_allocated;
     int top_borders_allocated[2];
@@ -577,6 +578,9 @@ typedef struct H264Context {
     int non_gray;                       ///< Did we encounter a intra frame after a gray gap frame
     int noref_gray;
     int skip_gray;
+
+    int deblock_thread;                 ///< deblock single-slice pictures in a separate thread
+    struct H264DeblockThread *deblock_ctx;
 } H264Context;
 
 extern const uint16_t ff_h264_mb_sizes[4];
@@ -592,6 +596,8 @@ int ff_h264_get_slice_type(const H264SliceContext *sl);
  */
 int ff_h264_alloc_tables(H264Context *h);
 
+void ff_h264_deblock_thread_free(H264Context *h);
+
 int ff_h264_decode_ref_pic_list_reordering(H264SliceContext *sl, void *logctx);
 int ff_h264_build_ref_list(H264Context *h, H264SliceContext *sl);
 void ff_h264_remove_all_refs(H264Context *h);
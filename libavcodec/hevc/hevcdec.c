@@ -35,6 +35,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/stereo3d.h"
 #include "libavutil/tdrdi.h"
 #include "libavutil/timecode.h"
@@ -2896,6 +2897,15 @@ error:
     return ret;
 }
 
+static void hls_decode_entry_wpp_pool(void *priv, int jobnr, int threadnr,
+                                      int nb_jobs, int nb_threads)
+{
+    HEVCContext *s = priv;
+
+    s->wpp_ret[jobnr] = hls_decode_entry_wpp(s->avctx, s->local_ctx,
+                                             jobnr, threadnr);
+}
+
 static int wpp_progress_init(HEVCContext *s, unsigned count)
 {
     if (s->nb_wpp_progress < count) {
@@ -2931,6 +2941,8 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     int *ret;
     int64_t offset;
     int64_t startheader, cmpt = 0;
+    int slice_threads = s->avctx->active_thread_type == FF_THREAD_SLICE;
+    int nb_threads    = slice_threads ? s->avctx->thread_count : s->wpp_pool_threads;
     int i, j, res = 0;
 
     if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * sps->ctb_width >= sps->ctb_width * sps->ctb_height) {
@@ -2941,8 +2953,8 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         return AVERROR_INVALIDDATA;
     }
 
-    if (s->avctx->thread_count > s->nb_local_ctx) {
-        HEVCLocalContext *tmp = av_malloc_array(s->avctx->thread_count, sizeof(*s->local_ctx));
+    if (nb_threads > s->nb_local_ctx) {
+        HEVCLocalContext *tmp = av_malloc_array(nb_threads, sizeof(*s->local_ctx));
 
         if (!tmp)
             return AVERROR(ENOMEM);
@@ -2951,7 +2963,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         av_free(s->local_ctx);
         s->local_ctx = tmp;
 
-        for (unsigned i = s->nb_local_ctx; i < s->avctx->thread_count; i++) {
+        for (unsigned i = s->nb_local_ctx; i < nb_threads; i++) {
             tmp = &s->local_ctx[i];
 
             memset(tmp, 0, sizeof(*tmp));
@@ -2961,7 +2973,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
             tmp->common_cabac_state = &s->cabac;
         }
 
-        s->nb_local_ctx = s->avctx->thread_count;
+        s->nb_local_ctx = nb_threads;
     }
 
     offset = s->sh.data_offset;
@@ -3014,8 +3026,16 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     if (!ret)
         return AVERROR(ENOMEM);
 
-    if (pps->entropy_coding_sync_enabled_flag)
-        s->avctx->execute2(s->avctx, hls_decode_entry_wpp, s->local_ctx, ret, s->sh.num_entry_point_offsets + 1);
+    if (pps->entropy_coding_sync_enabled_flag) {
+        if (slice_threads) {
+            s->avctx->execute2(s->avctx, hls_decode_entry_wpp, s->local_ctx, ret,
+                               s->sh.num_entry_point_offsets + 1);
+        } else {
+            s->wpp_ret = ret;
+            avpriv_slicethread_execute(s->wpp_pool, s->sh.num_entry_point_offsets + 1, 0);
+            s->wpp_ret = NULL;
+        }
+    }
 
     for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
         res += ret[i];
@@ -3024,6 +3044,23 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     return res;
 }
 
+static int wpp_pool_init(HEVCContext *s)
+{
+    int ret = avpriv_slicethread_create(&s->wpp_pool, s, hls_decode_entry_wpp_pool,
+                                        NULL, s->wpp_threads);
+    if (ret == AVERROR(ENOSYS)) {
+        av_log(s->avctx, AV_LOG_WARNING,
+               "Threads are not supported, decoding WPP rows sequentially\n");
+        s->wpp_threads = 1;
+        return 0;
+    }
+    if (ret < 0)
+        return ret;
+
+    s->wpp_pool_threads = ret;
+    return 0;
+}
+
 static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
                              const H2645NAL *nal, GetBitContext *gb)
 {
@@ -3070,7 +3107,15 @@ static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
     s->local_ctx[0].tu.cu_qp_offset_cb = 0;
     s->local_ctx[0].tu.cu_qp_offset_cr = 0;
 
-    if (s->avctx->active_thread_type == FF_THREAD_SLICE  &&
+    if (s->avctx->active_thread_type != FF_THREAD_SLICE && s->wpp_threads > 1 &&
+        pps->entropy_coding_sync_enabled_flag && !s->wpp_pool) {
+        ret = wpp_pool_init(s);
+        if (ret < 0)
+            return ret;
+    }
+
+    if ((s->avctx->active_thread_type == FF_THREAD_SLICE ||
+         (s->wpp_threads > 1 && pps->entropy_coding_sync_enabled_flag)) &&
         s->sh.num_entry_point_offsets > 0                &&
         pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
         return hls_slice_data_wpp(s, nal);
@@ -3951,6 +3996,7 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
 
     ff_hevc_ps_uninit(&s->ps);
 
+    avpriv_slicethread_free(&s->wpp_pool);
     for (int i = 0; i < s->nb_wpp_progress; i++)
         ff_thread_progress_destroy(&s->wpp_progress[i]);
     av_freep(&s->wpp_progress);
@@ -4210,6 +4256,9 @@ static const AVOption options[] = {
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
     { "strict-displaywin", "strictly apply default display window size", OFFSET(apply_defdispwin),
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "wpp_threads", "Number of threads decoding WPP rows when slice threading is not used, "
+        "e.g. within each frame thread", OFFSET(wpp_threads),
+        AV_OPT_TYPE_INT, {.i64 = 1}, 1, 64, PAR },
     { "view_ids", "Array of view IDs that should be decoded and output; a single -1 to decode all views",
         .offset = OFFSET(view_ids), .type = AV_OPT_TYPE_INT | AV_OPT_TYPE_FLAG_ARRAY,
         .min = -1, .max = INT_MAX, .flags = PAR },
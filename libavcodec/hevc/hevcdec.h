@@ -548,6 +548,14 @@ typedef struct HEVCContext {
 
     atomic_int wpp_err;
 
+    /**
+     * Pool decoding the WPP rows of a slice when slice threading is not
+     * active, e.g. inside each frame thread.
+     */
+    struct AVSliceThread *wpp_pool;
+    int                   wpp_pool_threads;
+    int                  *wpp_ret;
+
     const uint8_t *data;
 
     H2645Packet pkt;
@@ -560,6 +568,7 @@ typedef struct HEVCContext {
     int is_nalff;           ///< this flag is != 0 if bitstream is encapsulated
                             ///< as a format defined in 14496-15
     int apply_defdispwin;
+    int wpp_threads;
 
     // multi-layer AVOptions
     int         *view_ids;
@@ -936,6 +936,9 @@ const uint8_t *avpriv_find_start_code(const uint8_t *restrict p,
                                       const uint8_t *end,
                                       uint32_t *restrict state)
 {
+#if HAVE_FAST_UNALIGNED && HAVE_FAST_64BIT
+    const uint8_t *next = p;
+#endif
     int i;
 
     av_assert0(p <= end);
@@ -950,6 +953,22 @@ const uint8_t *avpriv_find_start_code(const uint8_t *restrict p,
     }
 
     while (p < end) {
+#if HAVE_FAST_UNALIGNED && HAVE_FAST_64BIT
+        /* A start code ending in [p, p + 8) has its 0x01 byte in
+         * [p - 1, p + 7), so skip 8 bytes at once if there is none.
+         * Otherwise scan those bytes one by one before trying again. */
+        if (p >= next) {
+            while (end - p >= 7) {
+                uint64_t x = AV_RN64(p - 1) ^ 0x0101010101010101ULL;
+                if ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL)
+                    break;
+                p += 8;
+            }
+            if (p >= end)
+                break;
+            next = p + 8;
+        }
+#endif
         if      (p[-1] > 1      ) p += 3;
         else if (p[-2]          ) p += 2;
         else if (p[-3]|(p[-1]-1)) p++;
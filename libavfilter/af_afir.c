@@ -56,6 +56,7 @@ typedef struct AudioFIRSegment {
 
     int *output_offset;
     int *part_index;
+    int *input_index;
 
     AVFrame *sumin;
     AVFrame *sumout;
@@ -214,7 +215,8 @@ static int init_segment(AVFilterContext *ctx, AudioFIRSegment *seg, int selir,
 
     seg->part_index    = av_calloc(ctx->inputs[0]->ch_layout.nb_channels, sizeof(*seg->part_index));
     seg->output_offset = av_calloc(ctx->inputs[0]->ch_layout.nb_channels, sizeof(*seg->output_offset));
-    if (!seg->part_index || !seg->output_offset)
+    seg->input_index   = av_calloc(ctx->inputs[0]->ch_layout.nb_channels, sizeof(*seg->input_index));
+    if (!seg->part_index || !seg->output_offset || !seg->input_index)
         return AVERROR(ENOMEM);
 
     switch (s->format) {
@@ -289,6 +291,7 @@ static void uninit_segment(AVFilterContext *ctx, AudioFIRSegment *seg)
 
     av_freep(&seg->output_offset);
     av_freep(&seg->part_index);
+    av_freep(&seg->input_index);
 
     av_frame_free(&seg->tempin);
     av_frame_free(&seg->tempout);
@@ -327,8 +330,12 @@ static int convert_coeffs(AVFilterContext *ctx, int selir)
         part_size = 1 << av_log2(s->minp);
         max_part_size = 1 << av_log2(s->maxp);
 
+        /* Each segment is fed from a delay line holding its IR offset plus
+         * one min_part_size quantum, so a segment can use partitions up to
+         * that size. Three partitions per size let the next segment grow
+         * fourfold, which needs fewer (costly) large FFTs than doubling. */
         for (int i = 0; left > 0; i++) {
-            int step = (part_size == max_part_size) ? INT_MAX : 1 + (i == 0);
+            int step = (part_size == max_part_size) ? INT_MAX : 3;
             int nb_partitions = FFMIN(step, (left + part_size - 1) / part_size);
 
             s->nb_segments[selir] = i + 1;
@@ -338,7 +345,7 @@ static int convert_coeffs(AVFilterContext *ctx, int selir)
             offset += nb_partitions * part_size;
             s->max_offset[selir] = offset;
             left -= nb_partitions * part_size;
-            part_size *= 2;
+            part_size *= 4;
             part_size = FFMIN(part_size, max_part_size);
         }
     }
@@ -20,6 +20,8 @@
 
 /* http://k.ylo.ph/2016/04/04/loudnorm.html */
 
+#include "libavutil/fifo.h"
+#include "libavutil/float_dsp.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "avfilter.h"
@@ -33,6 +35,7 @@ enum FrameType {
     INNER_FRAME,
     FINAL_FRAME,
     LINEAR_MODE,
+    LOOKAHEAD_MODE,
     FRAME_NB
 };
 
@@ -62,6 +65,7 @@ typedef struct LoudNormContext {
     double measured_thresh;
     double offset;
     int linear;
+    int64_t lookahead;
     int dual_mono;
     enum PrintFormat print_format;
 
@@ -95,6 +99,15 @@ typedef struct LoudNormContext {
 
     FFEBUR128State *r128_in;
     FFEBUR128State *r128_out;
+
+    /* single-pass linear mode */
+    AVFifo *fifo;
+    AVFloatDSPContext *fdsp;
+    int64_t lookahead_samples;
+    int64_t queued_samples;
+    double gain;
+    int eof_status;
+    int64_t eof_pts;
 } LoudNormContext;
 
 #define OFFSET(x) offsetof(LoudNormContext, x)
@@ -116,6 +129,7 @@ static const AVOption loudnorm_options[] = {
     { "measured_thresh",  "measured threshold of input file",  OFFSET(measured_thresh),  AV_OPT_TYPE_DOUBLE,  {.dbl = -70.},   -99.,        0.,  FLAGS },
     { "offset",           "set offset gain",                   OFFSET(offset),           AV_OPT_TYPE_DOUBLE,  {.dbl =  0.},    -99.,       99.,  FLAGS },
     { "linear",           "normalize linearly if possible",    OFFSET(linear),           AV_OPT_TYPE_BOOL,    {.i64 =  1},        0,         1,  FLAGS },
+    { "lookahead",        "set lookahead for single-pass linear normalization", OFFSET(lookahead), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, 60000000, FLAGS },
     { "dual_mono",        "treat mono input as dual-mono",     OFFSET(dual_mono),        AV_OPT_TYPE_BOOL,    {.i64 =  0},        0,         1,  FLAGS },
     { "print_format",     "set print format for stats",        OFFSET(print_format),     AV_OPT_TYPE_INT,     {.i64 =  NONE},  NONE,  PF_NB -1,  FLAGS, .unit = "print_format" },
     {     "none",         0,                                   0,                        AV_OPT_TYPE_CONST,   {.i64 =  NONE},     0,         0,  FLAGS, .unit = "print_format" },
@@ -631,6 +645,150 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     return ff_filter_frame(outlink, out);
 }
 
+static void apply_gain(LoudNormContext *s, double *dst, const double *src,
+                       int nb_samples, double gain, double gain_next)
+{
+    const int channels = s->channels;
+    int len = nb_samples * channels;
+
+    if (gain != gain_next) {
+        const double step = (gain_next - gain) / nb_samples;
+
+        for (int n = 0; n < nb_samples; n++) {
+            const double g = gain + n * step;
+
+            for (int c = 0; c < channels; c++)
+                dst[c] = src[c] * g;
+            dst += channels;
+            src += channels;
+        }
+        return;
+    }
+
+    if (!(((uintptr_t)dst | (uintptr_t)src) & 31)) {
+        const int len8 = len & ~7;
+
+        s->fdsp->vector_dmul_scalar(dst, src, gain, len8);
+        dst += len8;
+        src += len8;
+        len -= len8;
+    }
+
+    for (int i = 0; i < len; i++)
+        dst[i] = src[i] * gain;
+}
+
+/**
+ * Output a frame that has left the lookahead window. The gain follows the
+ * integrated loudness measured so far, which already includes the whole
+ * lookahead, and is capped so that the highest sample peak seen so far
+ * stays below the true peak target. Gain changes are ramped over one frame.
+ */
+static int filter_frame_lookahead(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LoudNormContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    double global, peak = 0., gain;
+    AVFrame *out;
+
+    if (av_frame_is_writable(in)) {
+        out = in;
+    } else {
+        out = ff_get_audio_buffer(outlink, in->nb_samples);
+        if (!out) {
+            av_frame_free(&in);
+            return AVERROR(ENOMEM);
+        }
+        av_frame_copy_props(out, in);
+    }
+
+    ff_ebur128_loudness_global(s->r128_in, &global);
+    for (int c = 0; c < s->channels; c++) {
+        double tmp;
+        ff_ebur128_sample_peak(s->r128_in, c, &tmp);
+        peak = FFMAX(peak, tmp);
+    }
+
+    if (global > -70.)
+        gain = pow(10., (s->target_i - global) / 20.);
+    else
+        gain = s->gain < 0. ? 1. : s->gain;
+    if (peak * gain > s->target_tp)
+        gain = s->target_tp / peak;
+    if (s->gain < 0.)
+        s->gain = gain;
+
+    apply_gain(s, (double *)out->data[0], (const double *)in->data[0],
+               in->nb_samples, s->gain, gain);
+    s->gain = gain;
+
+    ff_ebur128_add_frames_double(s->r128_out, (const double *)out->data[0], out->nb_samples);
+
+    if (in != out)
+        av_frame_free(&in);
+    return ff_filter_frame(outlink, out);
+}
+
+static int activate_lookahead(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    LoudNormContext *s = ctx->priv;
+    AVFrame *in = NULL;
+    int ret, status;
+    int64_t pts;
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    if (!s->eof_status) {
+        /* bound the frame size so that gain ramps stay short
+         * compared to the lookahead */
+        ret = ff_inlink_consume_samples(inlink, 1, frame_size(inlink->sample_rate, 100), &in);
+        if (ret < 0)
+            return ret;
+        if (ret > 0) {
+            ff_ebur128_add_frames_double(s->r128_in, (const double *)in->data[0], in->nb_samples);
+            s->queued_samples += in->nb_samples;
+            ret = av_fifo_write(s->fifo, &in, 1);
+            if (ret < 0) {
+                av_frame_free(&in);
+                return ret;
+            }
+        }
+
+        if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+            s->eof_status = status;
+            s->eof_pts    = pts;
+        }
+    }
+
+    if (av_fifo_peek(s->fifo, &in, 1, 0) >= 0 &&
+        (s->eof_status || s->queued_samples - in->nb_samples >= s->lookahead_samples)) {
+        av_fifo_drain2(s->fifo, 1);
+        s->queued_samples -= in->nb_samples;
+        ret = filter_frame_lookahead(inlink, in);
+        if (ret < 0)
+            return ret;
+        ff_filter_set_ready(ctx, 100);
+        return 0;
+    }
+
+    if (s->eof_status) {
+        ff_outlink_set_status(outlink, s->eof_status, s->eof_pts);
+        return 0;
+    }
+
+    if (ff_inlink_queued_samples(inlink)) {
+        ff_filter_set_ready(ctx, 100);
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED(outlink, inlink);
+
+    return FFERROR_NOT_READY;
+}
+
 static int flush_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -684,6 +842,9 @@ static int activate(AVFilterContext *ctx)
     int ret = 0, status;
     int64_t pts;
 
+    if (s->frame_type == LOOKAHEAD_MODE)
+        return activate_lookahead(ctx);
+
     FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
 
     if (s->frame_type != LINEAR_MODE) {
@@ -744,7 +905,7 @@ static int query_formats(const AVFilterContext *ctx,
     if (ret < 0)
         return ret;
 
-    if (s->frame_type != LINEAR_MODE) {
+    if (s->frame_type != LINEAR_MODE && s->frame_type != LOOKAHEAD_MODE) {
         return ff_set_common_samplerates_from_list2(ctx, cfg_in, cfg_out, input_srate);
     }
     return 0;
@@ -795,6 +956,11 @@ static int config_input(AVFilterLink *inlink)
     s->attack_length = frame_size(inlink->sample_rate, 10);
     s->release_length = frame_size(inlink->sample_rate, 100);
 
+    if (s->frame_type == LOOKAHEAD_MODE) {
+        s->lookahead_samples = av_rescale(s->lookahead, inlink->sample_rate, AV_TIME_BASE);
+        s->gain = -1.;
+    }
+
     return 0;
 }
 
@@ -813,6 +979,17 @@ static av_cold int init(AVFilterContext *ctx)
                 s->frame_type = LINEAR_MODE;
                 s->offset = offset;
             }
+        } else if (s->lookahead) {
+            if (s->lookahead < 300000) {
+                av_log(ctx, AV_LOG_ERROR, "lookahead must be at least 0.3 seconds\n");
+                return AVERROR(EINVAL);
+            }
+
+            s->frame_type = LOOKAHEAD_MODE;
+            s->fifo = av_fifo_alloc2(32, sizeof(AVFrame *), AV_FIFO_FLAG_AUTO_GROW);
+            s->fdsp = avpriv_float_dsp_alloc(0);
+            if (!s->fifo || !s->fdsp)
+                return AVERROR(ENOMEM);
         }
     }
 
@@ -874,7 +1051,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             20. * log10(tp_out),
             lra_out,
             thresh_out,
-            s->frame_type == LINEAR_MODE ? "linear" : "dynamic",
+            s->frame_type == LINEAR_MODE || s->frame_type == LOOKAHEAD_MODE ? "linear" : "dynamic",
             s->target_i - i_out
         );
         break;
@@ -902,7 +1079,7 @@ static av_cold void uninit(AVFilterContext *ctx)
             20. * log10(tp_out),
             lra_out,
             thresh_out,
-            s->frame_type == LINEAR_MODE ? "Linear" : "Dynamic",
+            s->frame_type == LINEAR_MODE || s->frame_type == LOOKAHEAD_MODE ? "Linear" : "Dynamic",
             s->target_i - i_out
         );
         break;
@@ -916,6 +1093,14 @@ end:
     av_freep(&s->limiter_buf);
     av_freep(&s->prev_smp);
     av_freep(&s->buf);
+    if (s->fifo) {
+        AVFrame *frame;
+
+        while (av_fifo_read(s->fifo, &frame, 1) >= 0)
+            av_frame_free(&frame);
+        av_fifo_freep2(&s->fifo);
+    }
+    av_freep(&s->fdsp);
 }
 
 static const AVFilterPad avfilter_af_loudnorm_inputs[] = {
@@ -155,10 +155,18 @@ static int fn(fir_quantum)(AVFilterContext *ctx, AVFrame *out, int ch, int ioffs
         ftype *buf = (ftype *)seg->buffer->extended_data[ch];
         int *output_offset = &seg->output_offset[ch];
         const int nb_partitions = seg->nb_partitions;
-        const int input_offset = seg->input_offset;
+        const int input_size = seg->input_size;
         const int part_size = seg->part_size;
+        /* The input delay line is a ring buffer of input_size samples.
+         * Its start and the write position are multiples of min_part_size,
+         * and input_size is too, so only reads can wrap around. */
+        const int start = seg->input_index[ch];
+        int input_offset = start + seg->input_offset;
         int j;
 
+        if (input_offset >= input_size)
+            input_offset -= input_size;
+
         seg->part_index[ch] = seg->part_index[ch] % nb_partitions;
         if (dry_gain == 1.f) {
             memcpy(src + input_offset, in, nb_samples * sizeof(*src));
@@ -174,12 +182,12 @@ static int fn(fir_quantum)(AVFilterContext *ctx, AVFrame *out, int ch, int ioffs
                 src2[n] = in[n] * dry_gain;
         }
 
+        seg->input_index[ch] = start + min_part_size < input_size ? start + min_part_size : 0;
+
         output_offset[0] += min_part_size;
         if (output_offset[0] >= part_size) {
             output_offset[0] = 0;
         } else {
-            memmove(src, src + min_part_size, (seg->input_size - min_part_size) * sizeof(*src));
-
             dst += output_offset[0];
             fn(fir_fadd)(s, ptr, dst, nb_samples);
             continue;
@@ -189,7 +197,14 @@ static int fn(fir_quantum)(AVFilterContext *ctx, AVFrame *out, int ch, int ioffs
 
         blockout = (ftype *)seg->blockout->extended_data[ch] + seg->part_index[ch] * seg->block_size;
         memset(tempin + part_size, 0, sizeof(*tempin) * (seg->block_size - part_size));
-        memcpy(tempin, src, sizeof(*src) * part_size);
+        if (start + part_size <= input_size) {
+            memcpy(tempin, src + start, sizeof(*src) * part_size);
+        } else {
+            const int size = input_size - start;
+
+            memcpy(tempin, src + start, sizeof(*src) * size);
+            memcpy(tempin + size, src, sizeof(*src) * (part_size - size));
+        }
         seg->tx_fn(seg->tx[ch], blockout, tempin, sizeof(ftype));
 
         j = seg->part_index[ch];
@@ -219,9 +234,6 @@ static int fn(fir_quantum)(AVFilterContext *ctx, AVFrame *out, int ch, int ioffs
 
         fn(fir_fadd)(s, ptr, dst, nb_samples);
 
-        if (part_size != min_part_size)
-            memmove(src, src + min_part_size, (seg->input_size - min_part_size) * sizeof(*src));
-
         seg->part_index[ch] = (seg->part_index[ch] + 1) % nb_partitions;
     }
 
@@ -270,6 +270,12 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Activate independent filters of a graph concurrently. Only meaningful in
+ * AVFilterGraph.thread_type.
+ */
+#define AVFILTER_THREAD_GRAPH (1 << 1)
+
 /** An instance of a filter */
 typedef struct AVFilterContext {
     const AVClass *av_class;        ///< needed for av_log() and filters common options
@@ -604,6 +610,10 @@ typedef struct AVFilterGraph {
      * bit AND with AVFilterContext.thread_type to get the final mask used for
      * determining allowed threading types. I.e. a threading type needs to be
      * set in both to be allowed.
+     *
+     * AVFILTER_THREAD_GRAPH is not enabled by default. It must be set before
+     * adding any filters to the graph and only has an effect when the graph
+     * uses the internal thread pool, i.e. AVFilterGraph.execute is not set.
      */
     int thread_type;
 
@@ -25,6 +25,7 @@
 #ifndef AVFILTER_AVFILTER_INTERNAL_H
 #define AVFILTER_AVFILTER_INTERNAL_H
 
+#include <stdatomic.h>
 #include <stdint.h>
 
 #include "avfilter.h"
@@ -107,8 +108,10 @@ typedef struct FFFilterContext {
      * Ready status of the filter.
      * A non-0 value means that the filter needs activating;
      * a higher value suggests a more urgent activation.
+     * Atomic since with graph threading the neighbours of several
+     * concurrently running filters may mark it ready.
      */
-    unsigned ready;
+    atomic_uint ready;
 
     /// parsed expression
     struct AVExpr *enable;
@@ -116,6 +119,17 @@ typedef struct FFFilterContext {
     double *var_values;
 
     struct AVFilterCommand *command_queue;
+
+    /// set if the filter was inserted by format negotiation to convert formats
+    int auto_convert;
+
+    /**
+     * Equal to FFFilterGraph.run_gen when the filter is within two links of
+     * a filter selected for concurrent activation (run_claimed), or is fed
+     * directly by one (run_fed).
+     */
+    unsigned run_claimed;
+    unsigned run_fed;
 } FFFilterContext;
 
 static inline FFFilterContext *fffilterctx(AVFilterContext *ctx)
@@ -145,6 +159,20 @@ typedef struct FFFilterGraph {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Maximum number of filters activated concurrently by
+     * ff_filter_graph_run_once(), 1 when graph threading is disabled.
+     */
+    int max_run_filters;
+    /**
+     * Filters selected for concurrent activation and their return codes,
+     * max_run_filters entries each.
+     */
+    AVFilterContext **run_filters;
+    int              *run_rets;
+    /// generation of the run_claimed/run_fed marks of the current selection
+    unsigned          run_gen;
 } FFFilterGraph;
 
 static inline FFFilterGraph *fffiltergraph(AVFilterGraph *graph)
@@ -190,6 +218,12 @@ int ff_filter_opt_parse(void *logctx, const AVClass *priv_class,
 
 int ff_graph_thread_init(FFFilterGraph *graph);
 
+/**
+ * Activate graph->run_filters[0..nb_filters-1] concurrently on the graph
+ * thread pool and store the return codes in graph->run_rets.
+ */
+void ff_graph_thread_activate(FFFilterGraph *graph, int nb_filters);
+
 void ff_graph_thread_free(FFFilterGraph *graph);
 
 /**
@@ -49,6 +49,7 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, .unit = "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "graph", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_GRAPH }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, .unit = "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
@@ -80,6 +81,10 @@ int ff_graph_thread_init(FFFilterGraph *graph)
     graph->p.nb_threads  = 1;
     return 0;
 }
+
+void ff_graph_thread_activate(FFFilterGraph *graph, int nb_filters)
+{
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -638,6 +643,7 @@ retry:
                                                    conv_opts[k], NULL, graph);
                 if (ret < 0)
                     return ret;
+                fffilterctx(conv[k])->auto_convert = 1;
                 if ((ret = avfilter_insert_filter(link, conv[k], 0, 0)) < 0)
                     return ret;
 
@@ -760,15 +766,47 @@ static int get_fmt_score(enum AVSampleFormat dst_fmt, enum AVSampleFormat src_fm
     return score;
 }
 
-static enum AVSampleFormat find_best_sample_fmt_of_2(enum AVSampleFormat dst_fmt1, enum AVSampleFormat dst_fmt2,
-                                                     enum AVSampleFormat src_fmt)
+/**
+ * Follow the sample format list shared by link and the filters downstream
+ * of it, and return the format the filter at the end of that list has
+ * already settled on for its output, i.e. the format the samples will be
+ * converted to next. Return AV_SAMPLE_FMT_NONE if unknown.
+ */
+static enum AVSampleFormat next_sample_fmt(AVFilterLink *link)
+{
+    const AVFilterFormats *formats = link->incfg.formats;
+
+    while (link->dst->nb_inputs == 1 && link->dst->nb_outputs == 1) {
+        AVFilterLink *next = link->dst->outputs[0];
+
+        if (next->type != AVMEDIA_TYPE_AUDIO)
+            break;
+        if (next->format != AV_SAMPLE_FMT_NONE)
+            return next->format;
+        if (!next->incfg.formats)
+            break;
+        if (next->incfg.formats != formats)
+            return next->incfg.formats->nb_formats == 1 ?
+                   next->incfg.formats->formats[0] : AV_SAMPLE_FMT_NONE;
+        link = next;
+    }
+
+    return AV_SAMPLE_FMT_NONE;
+}
+
+/**
+ * Cost of converting src_fmt to dst_fmt, plus that of converting dst_fmt
+ * to next_fmt later on if known.
+ */
+static int get_conversion_cost(enum AVSampleFormat dst_fmt, enum AVSampleFormat src_fmt,
+                               enum AVSampleFormat next_fmt)
 {
-    int score1, score2;
+    int cost = get_fmt_score(dst_fmt, src_fmt);
 
-    score1 = get_fmt_score(dst_fmt1, src_fmt);
-    score2 = get_fmt_score(dst_fmt2, src_fmt);
+    if (next_fmt != AV_SAMPLE_FMT_NONE)
+        cost += get_fmt_score(next_fmt, dst_fmt);
 
-    return score1 < score2 ? dst_fmt1 : dst_fmt2;
+    return cost;
 }
 
 int ff_fmt_is_regular_yuv(enum AVPixelFormat fmt)
@@ -821,10 +859,16 @@ static int pick_format(AVFilterLink *link, AVFilterLink *ref)
     } else if (link->type == AVMEDIA_TYPE_AUDIO) {
         if(ref && ref->type == AVMEDIA_TYPE_AUDIO){
             enum AVSampleFormat best= AV_SAMPLE_FMT_NONE;
+            enum AVSampleFormat next = next_sample_fmt(link);
+            int best_cost = INT_MAX;
             int i;
             for (i = 0; i < link->incfg.formats->nb_formats; i++) {
                 enum AVSampleFormat p = link->incfg.formats->formats[i];
-                best = find_best_sample_fmt_of_2(best, p, ref->format);
+                int cost = get_conversion_cost(p, ref->format, next);
+                if (cost <= best_cost) {
+                    best_cost = cost;
+                    best      = p;
+                }
             }
             av_log(link->src,AV_LOG_DEBUG, "picking %s out of %d ref:%s\n",
                    av_get_sample_fmt_name(best), link->incfg.formats->nb_formats,
@@ -1261,6 +1305,7 @@ static void swap_sample_fmts_on_filter(AVFilterContext *filter)
     for (i = 0; i < filter->nb_outputs; i++) {
         AVFilterLink *outlink = filter->outputs[i];
         int best_idx = -1, best_score = INT_MIN;
+        enum AVSampleFormat next_format;
 
         if (outlink->type != AVMEDIA_TYPE_AUDIO ||
             outlink->incfg.formats->nb_formats < 2)
@@ -1294,6 +1339,23 @@ static void swap_sample_fmts_on_filter(AVFilterContext *filter)
             }
         }
         av_assert0(best_idx >= 0);
+
+        /* If the samples get converted again further down, minimize the
+         * cost of both conversions instead of only this one. */
+        next_format = next_sample_fmt(outlink);
+        if (next_format != AV_SAMPLE_FMT_NONE) {
+            const int *formats = outlink->incfg.formats->formats;
+            int best_cost = get_conversion_cost(formats[best_idx], format, next_format);
+
+            for (j = 0; j < outlink->incfg.formats->nb_formats; j++) {
+                int cost = get_conversion_cost(formats[j], format, next_format);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_idx  = j;
+                }
+            }
+        }
+
         FFSWAP(int, outlink->incfg.formats->formats[0],
                outlink->incfg.formats->formats[best_idx]);
     }
@@ -1360,6 +1422,44 @@ static int pick_formats(AVFilterGraph *graph)
     return 0;
 }
 
+static void report_conversions(AVFilterGraph *graph, void *log_ctx)
+{
+    int nb_conv = 0;
+
+    for (int i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        AVFilterLink *in, *out;
+
+        if (!fffilterctx(f)->auto_convert)
+            continue;
+        nb_conv++;
+
+        in  = f->inputs[0];
+        out = f->outputs[0];
+        if (in->type == AVMEDIA_TYPE_AUDIO) {
+            char in_layout[64], out_layout[64];
+
+            av_channel_layout_describe(&in->ch_layout,  in_layout,  sizeof(in_layout));
+            av_channel_layout_describe(&out->ch_layout, out_layout, sizeof(out_layout));
+            av_log(log_ctx, AV_LOG_VERBOSE,
+                   "'%s' converts %s %dHz %s to %s %dHz %s between '%s' and '%s'\n",
+                   f->name,
+                   av_get_sample_fmt_name(in->format),  in->sample_rate,  in_layout,
+                   av_get_sample_fmt_name(out->format), out->sample_rate, out_layout,
+                   in->src->name, out->dst->name);
+        } else if (in->type == AVMEDIA_TYPE_VIDEO) {
+            av_log(log_ctx, AV_LOG_VERBOSE,
+                   "'%s' converts %s to %s between '%s' and '%s'\n",
+                   f->name, av_get_pix_fmt_name(in->format),
+                   av_get_pix_fmt_name(out->format),
+                   in->src->name, out->dst->name);
+        }
+    }
+
+    if (nb_conv)
+        av_log(log_ctx, AV_LOG_VERBOSE, "%d format conversion filter(s) inserted\n", nb_conv);
+}
+
 /**
  * Configure the formats of all the links in the graph.
  */
@@ -1388,6 +1488,8 @@ static int graph_config_formats(AVFilterGraph *graph, void *log_ctx)
     if ((ret = pick_formats(graph)) < 0)
         return ret;
 
+    report_conversions(graph, log_ctx);
+
     return 0;
 }
 
@@ -1613,21 +1715,119 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+/**
+ * Mark the filters that can not be activated concurrently with the given
+ * one: those sharing a link with it, feeding it or fed by it through at most
+ * one intermediate filter (whose links are unblocked by the frames it gets),
+ * and those feeding the same filter.
+ */
+static void filter_claim(unsigned gen, AVFilterContext *filter)
+{
+    fffilterctx(filter)->run_claimed = gen;
+
+    for (unsigned i = 0; i < filter->nb_outputs; i++) {
+        AVFilterContext *dst = filter->outputs[i]->dst;
+
+        fffilterctx(dst)->run_claimed = gen;
+        fffilterctx(dst)->run_fed     = gen;
+        for (unsigned j = 0; j < dst->nb_outputs; j++)
+            fffilterctx(dst->outputs[j]->dst)->run_claimed = gen;
+    }
+    for (unsigned i = 0; i < filter->nb_inputs; i++) {
+        AVFilterContext *src = filter->inputs[i]->src;
+
+        fffilterctx(src)->run_claimed = gen;
+        for (unsigned j = 0; j < src->nb_inputs; j++)
+            fffilterctx(src->inputs[j]->src)->run_claimed = gen;
+    }
+}
+
+static int filter_claimed(unsigned gen, AVFilterContext *filter)
+{
+    if (fffilterctx(filter)->run_claimed == gen)
+        return 1;
+    for (unsigned i = 0; i < filter->nb_outputs; i++)
+        if (fffilterctx(filter->outputs[i]->dst)->run_fed == gen)
+            return 1;
+    return 0;
+}
+
+static int filter_graph_exclusive(const AVFilterContext *filter)
+{
+    return fffilter(filter->filter)->flags_internal & FF_FILTER_FLAG_GRAPH_EXCLUSIVE;
+}
+
+/**
+ * Add the ready filters that can run concurrently with the ones already
+ * selected to graphi->run_filters, in a single pass over the graph.
+ * Sink filters update the graph-wide age heap, so at most one is selected.
+ */
+static int filter_graph_select(FFFilterGraph *graphi, int nb_run)
+{
+    AVFilterGraph *graph = &graphi->p;
+    int has_sink = !graphi->run_filters[0]->nb_outputs;
+    unsigned gen = ++graphi->run_gen;
+
+    if (!gen) {
+        for (unsigned i = 0; i < graph->nb_filters; i++) {
+            fffilterctx(graph->filters[i])->run_claimed = 0;
+            fffilterctx(graph->filters[i])->run_fed     = 0;
+        }
+        gen = graphi->run_gen = 1;
+    }
+
+    for (int i = 0; i < nb_run; i++)
+        filter_claim(gen, graphi->run_filters[i]);
+
+    for (unsigned i = 0; i < graph->nb_filters && nb_run < graphi->max_run_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (!atomic_load_explicit(&fffilterctx(filter)->ready, memory_order_relaxed) ||
+            filter_graph_exclusive(filter) || (has_sink && !filter->nb_outputs) ||
+            filter_claimed(gen, filter))
+            continue;
+
+        filter_claim(gen, filter);
+        has_sink |= !filter->nb_outputs;
+        graphi->run_filters[nb_run++] = filter;
+    }
+    return nb_run;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
+    FFFilterGraph *graphi = fffiltergraph(graph);
     FFFilterContext *ctxi;
-    unsigned i;
+    unsigned i, ready;
+    int nb_run;
 
     av_assert0(graph->nb_filters);
-    ctxi = fffilterctx(graph->filters[0]);
+    ctxi  = fffilterctx(graph->filters[0]);
+    ready = atomic_load_explicit(&ctxi->ready, memory_order_relaxed);
     for (i = 1; i < graph->nb_filters; i++) {
         FFFilterContext *ctxi_other = fffilterctx(graph->filters[i]);
+        unsigned ready_other = atomic_load_explicit(&ctxi_other->ready,
+                                                    memory_order_relaxed);
 
-        if (ctxi_other->ready > ctxi->ready)
-            ctxi = ctxi_other;
+        if (ready_other > ready) {
+            ctxi  = ctxi_other;
+            ready = ready_other;
+        }
     }
 
-    if (!ctxi->ready)
+    if (!ready)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(&ctxi->p);
+    if (graphi->max_run_filters <= 1 || filter_graph_exclusive(&ctxi->p))
+        return ff_filter_activate(&ctxi->p);
+
+    graphi->run_filters[0] = &ctxi->p;
+    nb_run = filter_graph_select(graphi, 1);
+    if (nb_run == 1)
+        return ff_filter_activate(&ctxi->p);
+
+    ff_graph_thread_activate(graphi, nb_run);
+    for (i = 0; i < nb_run; i++)
+        if (graphi->run_rets[i] < 0)
+            return graphi->run_rets[i];
+    return 0;
 }
@@ -40,12 +40,24 @@ typedef struct ThreadContext {
     AVFilterContext *ctx;
     void *arg;
     int   *rets;
+
+    /* set while the pool is activating whole filters with
+     * AVFILTER_THREAD_GRAPH; their slice jobs then run in the calling worker */
+    FFFilterGraph *activate_graph;
 } ThreadContext;
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     ThreadContext *c = priv;
-    int ret = c->func(c->ctx, c->arg, jobnr, nb_jobs);
+    FFFilterGraph *graphi = c->activate_graph;
+    int ret;
+
+    if (graphi) {
+        graphi->run_rets[jobnr] = ff_filter_activate(graphi->run_filters[jobnr]);
+        return;
+    }
+
+    ret = c->func(c->ctx, c->arg, jobnr, nb_jobs);
     if (c->rets)
         c->rets[jobnr] = ret;
 }
@@ -62,6 +74,17 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+
+    /* the pool is busy activating this and other filters */
+    if (c->activate_graph) {
+        for (int i = 0; i < nb_jobs; i++) {
+            int r = func(ctx, arg, i, nb_jobs);
+            if (ret)
+                ret[i] = r;
+        }
+        return 0;
+    }
+
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
@@ -71,6 +94,31 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
     return 0;
 }
 
+void ff_graph_thread_activate(FFFilterGraph *graphi, int nb_filters)
+{
+    ThreadContext *c = graphi->thread;
+
+    c->activate_graph = graphi;
+    avpriv_slicethread_execute(c->thread, nb_filters, 0);
+    c->activate_graph = NULL;
+}
+
+static int graph_thread_init(FFFilterGraph *graphi)
+{
+    int nb_threads = graphi->p.nb_threads;
+
+    graphi->run_filters = av_calloc(nb_threads, sizeof(*graphi->run_filters));
+    graphi->run_rets    = av_calloc(nb_threads, sizeof(*graphi->run_rets));
+    if (!graphi->run_filters || !graphi->run_rets) {
+        av_freep(&graphi->run_filters);
+        av_freep(&graphi->run_rets);
+        return AVERROR(ENOMEM);
+    }
+    graphi->max_run_filters = nb_threads;
+
+    return 0;
+}
+
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
     nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
@@ -104,6 +152,12 @@ int ff_graph_thread_init(FFFilterGraph *graphi)
 
     graphi->thread_execute = thread_execute;
 
+    if (graph->thread_type & AVFILTER_THREAD_GRAPH) {
+        ret = graph_thread_init(graphi);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -112,4 +166,7 @@ void ff_graph_thread_free(FFFilterGraph *graph)
     if (graph->thread)
         slice_thread_uninit(graph->thread);
     av_freep(&graph->thread);
+    av_freep(&graph->run_filters);
+    av_freep(&graph->run_rets);
+    graph->max_run_filters = 0;
 }
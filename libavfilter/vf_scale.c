@@ -34,6 +34,7 @@
 #include "libavutil/pixfmt.h"
 #include "scale_eval.h"
 #include "video.h"
+#include "libavutil/avstring.h"
 #include "libavutil/eval.h"
 #include "libavutil/imgutils_internal.h"
 #include "libavutil/internal.h"
@@ -174,6 +175,12 @@ typedef struct ScaleContext {
 
     int eval_mode;              ///< expression evaluation mode
 
+    /* multi-output mode, one output per entry of the size list */
+    char *sizes_str;
+    int *out_w, *out_h;         ///< requested size for each output
+    int nb_sizes;
+    AVFrame **out_frames;       ///< per-output frames being produced
+    AVFrame **sws_frames;       ///< subset of out_frames passed to libswscale
 } ScaleContext;
 
 const FFFilter ff_vf_scale2ref;
@@ -325,6 +332,84 @@ static av_cold int preinit(AVFilterContext *ctx)
 
 static int do_scale(FFFrameSync *fs);
 
+static int init_multi(AVFilterContext *ctx)
+{
+    ScaleContext *scale = ctx->priv;
+    char *sizes, *entry, *saveptr = NULL;
+    int ret = 0;
+
+    if (IS_SCALE2REF(ctx) || scale->size_str || scale->w_expr || scale->h_expr) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Output size list cannot be combined with a single output size.\n");
+        return AVERROR(EINVAL);
+    }
+
+    sizes = av_strdup(scale->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (entry = av_strtok(sizes, "|", &saveptr); entry;
+         entry = av_strtok(NULL, "|", &saveptr)) {
+        int w, h, *tmp;
+        char c;
+
+        /* Allow 0 and negative values with the same meaning as for w/h */
+        if (sscanf(entry, "%dx%d%c", &w, &h, &c) != 2 &&
+            av_parse_video_size(&w, &h, entry) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", entry);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+
+        tmp = av_realloc_array(scale->out_w, scale->nb_sizes + 1, sizeof(*tmp));
+        if (!tmp)
+            goto nomem;
+        scale->out_w = tmp;
+        tmp = av_realloc_array(scale->out_h, scale->nb_sizes + 1, sizeof(*tmp));
+        if (!tmp)
+            goto nomem;
+        scale->out_h = tmp;
+
+        scale->out_w[scale->nb_sizes] = w;
+        scale->out_h[scale->nb_sizes] = h;
+        scale->nb_sizes++;
+    }
+
+    if (!scale->nb_sizes) {
+        av_log(ctx, AV_LOG_ERROR, "Empty output size list\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    scale->out_frames = av_calloc(scale->nb_sizes, sizeof(*scale->out_frames));
+    scale->sws_frames = av_calloc(scale->nb_sizes, sizeof(*scale->sws_frames));
+    if (!scale->out_frames || !scale->sws_frames)
+        goto nomem;
+
+    /* The first output is the static default pad */
+    for (int i = 1; i < scale->nb_sizes; i++) {
+        AVFilterPad pad = {
+            .type         = AVMEDIA_TYPE_VIDEO,
+            .config_props = config_props,
+        };
+
+        pad.name = av_asprintf("output%d", i);
+        if (!pad.name)
+            goto nomem;
+
+        ret = ff_append_outpad_free_name(ctx, &pad);
+        if (ret < 0)
+            goto end;
+    }
+
+    goto end;
+nomem:
+    ret = AVERROR(ENOMEM);
+end:
+    av_free(sizes);
+    return ret;
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
@@ -333,6 +418,9 @@ static av_cold int init(AVFilterContext *ctx)
     if (IS_SCALE2REF(ctx))
         av_log(ctx, AV_LOG_WARNING, "scale2ref is deprecated, use scale=rw:rh instead\n");
 
+    if (scale->sizes_str && (ret = init_multi(ctx)) < 0)
+        return ret;
+
     if (scale->size_str && (scale->w_expr || scale->h_expr)) {
         av_log(ctx, AV_LOG_ERROR,
                "Size and width/height expressions cannot be set at the same time.\n");
@@ -444,6 +532,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_expr_free(scale->w_pexpr);
     av_expr_free(scale->h_pexpr);
     scale->w_pexpr = scale->h_pexpr = NULL;
+    av_freep(&scale->out_w);
+    av_freep(&scale->out_h);
+    av_freep(&scale->out_frames);
+    av_freep(&scale->sws_frames);
     ff_framesync_uninit(&scale->fs);
     sws_free_context(&scale->sws);
 }
@@ -470,18 +562,6 @@ static int query_formats(const AVFilterContext *ctx,
     if ((ret = ff_formats_ref(formats, &cfg_in[0]->formats)) < 0)
         return ret;
 
-    desc    = NULL;
-    formats = NULL;
-    while ((desc = av_pix_fmt_desc_next(desc))) {
-        pix_fmt = av_pix_fmt_desc_get_id(desc);
-        if (sws_test_format(pix_fmt, 1) || pix_fmt == AV_PIX_FMT_PAL8) {
-            if ((ret = ff_add_format(&formats, pix_fmt)) < 0)
-                return ret;
-        }
-    }
-    if ((ret = ff_formats_ref(formats, &cfg_out[0]->formats)) < 0)
-        return ret;
-
     /* accept all supported inputs, even if user overrides their properties */
     formats = ff_all_color_spaces();
     for (int i = 0; i < formats->nb_formats; i++) {
@@ -498,27 +578,42 @@ static int query_formats(const AVFilterContext *ctx,
                               &cfg_in[0]->color_ranges)) < 0)
         return ret;
 
-    /* propagate output properties if overridden */
-    if (scale->out_color_matrix != AVCOL_SPC_UNSPECIFIED) {
-        formats = ff_make_formats_list_singleton(scale->out_color_matrix);
-    } else {
-        formats = ff_all_color_spaces();
-        for (int i = 0; i < formats->nb_formats; i++) {
-            if (!sws_test_colorspace(formats->formats[i], 1)) {
-                for (int j = i--; j + 1 < formats->nb_formats; j++)
-                    formats->formats[j] = formats->formats[j + 1];
-                formats->nb_formats--;
+    /* every output negotiates independently */
+    for (int n = 0; n < FFMAX(scale->nb_sizes, 1); n++) {
+        desc    = NULL;
+        formats = NULL;
+        while ((desc = av_pix_fmt_desc_next(desc))) {
+            pix_fmt = av_pix_fmt_desc_get_id(desc);
+            if (sws_test_format(pix_fmt, 1) || pix_fmt == AV_PIX_FMT_PAL8) {
+                if ((ret = ff_add_format(&formats, pix_fmt)) < 0)
+                    return ret;
             }
         }
-    }
-    if ((ret = ff_formats_ref(formats, &cfg_out[0]->color_spaces)) < 0)
-        return ret;
+        if ((ret = ff_formats_ref(formats, &cfg_out[n]->formats)) < 0)
+            return ret;
 
-    formats = scale->out_range != AVCOL_RANGE_UNSPECIFIED
-                ? ff_make_formats_list_singleton(scale->out_range)
-                : ff_all_color_ranges();
-    if ((ret = ff_formats_ref(formats, &cfg_out[0]->color_ranges)) < 0)
-        return ret;
+        /* propagate output properties if overridden */
+        if (scale->out_color_matrix != AVCOL_SPC_UNSPECIFIED) {
+            formats = ff_make_formats_list_singleton(scale->out_color_matrix);
+        } else {
+            formats = ff_all_color_spaces();
+            for (int i = 0; i < formats->nb_formats; i++) {
+                if (!sws_test_colorspace(formats->formats[i], 1)) {
+                    for (int j = i--; j + 1 < formats->nb_formats; j++)
+                        formats->formats[j] = formats->formats[j + 1];
+                    formats->nb_formats--;
+                }
+            }
+        }
+        if ((ret = ff_formats_ref(formats, &cfg_out[n]->color_spaces)) < 0)
+            return ret;
+
+        formats = scale->out_range != AVCOL_RANGE_UNSPECIFIED
+                    ? ff_make_formats_list_singleton(scale->out_range)
+                    : ff_all_color_ranges();
+        if ((ret = ff_formats_ref(formats, &cfg_out[n]->color_ranges)) < 0)
+            return ret;
+    }
 
     if (scale->sws->alpha_blend) {
         if ((ret = ff_formats_ref(ff_make_formats_list_singleton(AVALPHA_MODE_STRAIGHT),
@@ -630,11 +725,17 @@ static int config_props(AVFilterLink *outlink)
     double w_adj = 1.0;
     int ret;
 
-    if ((ret = scale_eval_dimensions(ctx)) < 0)
-        goto fail;
+    if (scale->nb_sizes) {
+        int idx = FF_OUTLINK_IDX(outlink);
+        outlink->w = scale->out_w[idx] ? scale->out_w[idx] : inlink->w;
+        outlink->h = scale->out_h[idx] ? scale->out_h[idx] : inlink->h;
+    } else {
+        if ((ret = scale_eval_dimensions(ctx)) < 0)
+            goto fail;
 
-    outlink->w = scale->w;
-    outlink->h = scale->h;
+        outlink->w = scale->w;
+        outlink->h = scale->h;
+    }
 
     if (scale->reset_sar)
         w_adj = IS_SCALE2REF(ctx) ? scale->var_values[VAR_S2R_MAIN_SAR] :
@@ -683,7 +784,7 @@ static int config_props(AVFilterLink *outlink)
                                            AV_SIDE_DATA_PROP_COLOR_DEPENDENT);
     }
 
-    if (!IS_SCALE2REF(ctx)) {
+    if (!IS_SCALE2REF(ctx) && !scale->nb_sizes) {
         ff_framesync_uninit(&scale->fs);
         ret = ff_framesync_init(&scale->fs, ctx, ctx->nb_inputs);
         if (ret < 0)
@@ -739,6 +840,68 @@ static int request_frame_ref(AVFilterLink *outlink)
     return ff_request_frame(outlink->src->inputs[1]);
 }
 
+/* Apply the user overrides of the input frame properties */
+static void apply_input_props(const ScaleContext *scale, AVFrame *in)
+{
+    if (scale->in_color_matrix != -1)
+        in->colorspace = scale->in_color_matrix;
+    if (scale->in_primaries != -1)
+        in->color_primaries = scale->in_primaries;
+    if (scale->in_transfer != -1)
+        in->color_trc = scale->in_transfer;
+    if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
+        in->color_range = scale->in_range;
+    in->chroma_location = scale->in_chroma_loc;
+
+    if (scale->interlaced > 0)
+        in->flags |= AV_FRAME_FLAG_INTERLACED;
+    else if (!scale->interlaced)
+        in->flags &= ~AV_FRAME_FLAG_INTERLACED;
+}
+
+/* Allocate an output frame for outlink, with properties derived from in */
+static AVFrame *alloc_output_frame(const ScaleContext *scale, AVFilterLink *inlink,
+                                   AVFilterLink *outlink, const AVFrame *in)
+{
+    AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    if (!out)
+        return NULL;
+
+    av_frame_copy_props(out, in);
+    out->width  = outlink->w;
+    out->height = outlink->h;
+    out->color_range = outlink->color_range;
+    out->colorspace = outlink->colorspace;
+    out->alpha_mode = outlink->alpha_mode;
+    if (scale->out_chroma_loc != AVCHROMA_LOC_UNSPECIFIED)
+        out->chroma_location = scale->out_chroma_loc;
+    if (scale->out_primaries != -1)
+        out->color_primaries = scale->out_primaries;
+    if (scale->out_transfer != -1)
+        out->color_trc = scale->out_transfer;
+
+    if (out->width != in->width || out->height != in->height) {
+        av_frame_side_data_remove_by_props(&out->side_data, &out->nb_side_data,
+                                           AV_SIDE_DATA_PROP_SIZE_DEPENDENT);
+    }
+
+    if (in->color_primaries != out->color_primaries || in->color_trc != out->color_trc) {
+        av_frame_side_data_remove_by_props(&out->side_data, &out->nb_side_data,
+                                           AV_SIDE_DATA_PROP_COLOR_DEPENDENT);
+    }
+
+    if (scale->reset_sar) {
+        out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+    } else {
+        av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
+                (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                INT_MAX);
+    }
+
+    return out;
+}
+
 /* Takes over ownership of *frame_in, passes ownership of *frame_out to caller */
 static int scale_frame(AVFilterLink *link, AVFrame **frame_in,
                        AVFrame **frame_out)
@@ -816,60 +979,15 @@ scale:
     scale->hsub = desc->log2_chroma_w;
     scale->vsub = desc->log2_chroma_h;
 
-    out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+    flags_orig = in->flags;
+    apply_input_props(scale, in);
+
+    out = alloc_output_frame(scale, link, outlink, in);
     if (!out) {
         ret = AVERROR(ENOMEM);
         goto err;
     }
 
-    if (scale->in_color_matrix != -1)
-        in->colorspace = scale->in_color_matrix;
-    if (scale->in_primaries != -1)
-        in->color_primaries = scale->in_primaries;
-    if (scale->in_transfer != -1)
-        in->color_trc = scale->in_transfer;
-    if (scale->in_range != AVCOL_RANGE_UNSPECIFIED)
-        in->color_range = scale->in_range;
-    in->chroma_location = scale->in_chroma_loc;
-
-    flags_orig = in->flags;
-    if (scale->interlaced > 0)
-        in->flags |= AV_FRAME_FLAG_INTERLACED;
-    else if (!scale->interlaced)
-        in->flags &= ~AV_FRAME_FLAG_INTERLACED;
-
-    av_frame_copy_props(out, in);
-    out->width  = outlink->w;
-    out->height = outlink->h;
-    out->color_range = outlink->color_range;
-    out->colorspace = outlink->colorspace;
-    out->alpha_mode = outlink->alpha_mode;
-    if (scale->out_chroma_loc != AVCHROMA_LOC_UNSPECIFIED)
-        out->chroma_location = scale->out_chroma_loc;
-    if (scale->out_primaries != -1)
-        out->color_primaries = scale->out_primaries;
-    if (scale->out_transfer != -1)
-        out->color_trc = scale->out_transfer;
-
-    if (out->width != in->width || out->height != in->height) {
-        av_frame_side_data_remove_by_props(&out->side_data, &out->nb_side_data,
-                                           AV_SIDE_DATA_PROP_SIZE_DEPENDENT);
-    }
-
-    if (in->color_primaries != out->color_primaries || in->color_trc != out->color_trc) {
-        av_frame_side_data_remove_by_props(&out->side_data, &out->nb_side_data,
-                                           AV_SIDE_DATA_PROP_COLOR_DEPENDENT);
-    }
-
-    if (scale->reset_sar) {
-        out->sample_aspect_ratio = outlink->sample_aspect_ratio;
-    } else {
-        av_reduce(&out->sample_aspect_ratio.num, &out->sample_aspect_ratio.den,
-                (int64_t)in->sample_aspect_ratio.num * outlink->h * link->w,
-                (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
-                INT_MAX);
-    }
-
     if (sws_is_noop(out, in)) {
         av_frame_free(&out);
         in->flags = flags_orig;
@@ -1019,7 +1137,7 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     w = !strcmp(cmd, "width")  || !strcmp(cmd, "w");
     h = !strcmp(cmd, "height")  || !strcmp(cmd, "h");
 
-    if (w || h) {
+    if ((w || h) && !scale->nb_sizes) {
         str_expr = w ? scale->w_expr : scale->h_expr;
         pexpr_ptr = w ? &scale->w_pexpr : &scale->h_pexpr;
 
@@ -1033,9 +1151,132 @@ static int process_command(AVFilterContext *ctx, const char *cmd, const char *ar
     return ret;
 }
 
+/* Takes over ownership of in, scales it to all outputs at once */
+static int scale_frame_multi(AVFilterContext *ctx, AVFrame *in)
+{
+    ScaleContext *scale = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int ret = 0, flags_orig, nb_sws = 0;
+
+    if (in->width  != inlink->w ||
+        in->height != inlink->h ||
+        in->format != inlink->format ||
+        in->sample_aspect_ratio.den != inlink->sample_aspect_ratio.den ||
+        in->sample_aspect_ratio.num != inlink->sample_aspect_ratio.num ||
+        in->colorspace != inlink->colorspace ||
+        in->color_range != inlink->color_range) {
+        inlink->format              = in->format;
+        inlink->w                   = in->width;
+        inlink->h                   = in->height;
+        inlink->colorspace          = in->colorspace;
+        inlink->color_range         = in->color_range;
+        inlink->sample_aspect_ratio = in->sample_aspect_ratio;
+
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if ((ret = config_props(ctx->outputs[i])) < 0)
+                goto end;
+        }
+    }
+
+    flags_orig = in->flags;
+    apply_input_props(scale, in);
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        AVFrame *out;
+
+        if (ff_outlink_get_status(outlink))
+            continue;
+
+        out = alloc_output_frame(scale, inlink, outlink, in);
+        if (!out) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+
+        if (sws_is_noop(out, in)) {
+            av_frame_free(&out);
+            out = av_frame_clone(in);
+            if (!out) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+        } else {
+            if (out->format == AV_PIX_FMT_PAL8) {
+                out->format = AV_PIX_FMT_BGR8;
+                avpriv_set_systematic_pal2((uint32_t*) out->data[1], out->format);
+            }
+            scale->sws_frames[nb_sws++] = out;
+        }
+
+        scale->out_frames[i] = out;
+    }
+
+    if (ret >= 0 && nb_sws)
+        ret = sws_scale_frames(scale->sws, scale->sws_frames, nb_sws, in);
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        AVFrame *out = scale->out_frames[i];
+        if (!out)
+            continue;
+        out->flags  = flags_orig;
+        out->format = ctx->outputs[i]->format; /* undo PAL8 handling */
+    }
+
+    for (int i = 0; ret >= 0 && i < ctx->nb_outputs; i++) {
+        AVFrame *out = scale->out_frames[i];
+        scale->out_frames[i] = NULL;
+        if (out)
+            ret = ff_filter_frame(ctx->outputs[i], out);
+    }
+
+end:
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        av_frame_free(&scale->out_frames[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+static int activate_multi(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret, nb_eofs = 0;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        nb_eofs += ff_outlink_get_status(ctx->outputs[i]) == AVERROR_EOF;
+
+    if (nb_eofs == ctx->nb_outputs) {
+        ff_inlink_set_status(inlink, AVERROR_EOF);
+        return 0;
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0)
+        return scale_frame_multi(ctx, in);
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    FF_FILTER_FORWARD_WANTED_ANY(ctx, inlink);
+
+    return FFERROR_NOT_READY;
+}
+
 static int activate(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
+    if (scale->nb_sizes)
+        return activate_multi(ctx);
     return ff_framesync_activate(&scale->fs);
 }
 
@@ -1076,6 +1317,7 @@ static const AVOption scale_options[] = {
     { "interl", "set interlacing", OFFSET(interlaced), AV_OPT_TYPE_BOOL, {.i64 = 0 }, -1, 1, FLAGS },
     { "size",   "set video size",          OFFSET(size_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, .flags = FLAGS },
     { "s",      "set video size",          OFFSET(size_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, .flags = FLAGS },
+    { "sizes",  "set '|'-separated list of output sizes, one output per entry", OFFSET(sizes_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, .flags = FLAGS },
     {  "in_color_matrix", "set input YCbCr type",   OFFSET(in_color_matrix),  AV_OPT_TYPE_INT, { .i64 = -1 }, -1, AVCOL_SPC_NB-1, .flags = FLAGS, .unit = "color" },
     { "out_color_matrix", "set output YCbCr type",  OFFSET(out_color_matrix), AV_OPT_TYPE_INT, { .i64 = AVCOL_SPC_UNSPECIFIED }, 0, AVCOL_SPC_NB-1, .flags = FLAGS, .unit = "color"},
         { "auto",        NULL, 0, AV_OPT_TYPE_CONST, {.i64=-1},                       0, 0, FLAGS, .unit = "color" },
@@ -1191,7 +1433,7 @@ const FFFilter ff_vf_scale = {
     .p.name          = "scale",
     .p.description   = NULL_IF_CONFIG_SMALL("Scale the input video size and/or convert the image format."),
     .p.priv_class    = &scale_class,
-    .p.flags         = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_DYNAMIC_OUTPUTS,
     .preinit         = preinit,
     .init            = init,
     .uninit          = uninit,
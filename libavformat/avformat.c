@@ -38,6 +38,7 @@
 #include "avformat.h"
 #include "avformat_internal.h"
 #include "avio.h"
+#include "compact_index.h"
 #include "demux.h"
 #include "mux.h"
 #include "internal.h"
@@ -57,6 +58,7 @@ void ff_free_stream(AVStream **pst)
     avcodec_free_context(&sti->avctx);
     av_bsf_free(&sti->bsfc);
     av_freep(&sti->index_entries);
+    ff_compact_index_free(&sti->compact_index);
     av_freep(&sti->probe_data.buf);
 
     av_packet_free(&sti->parse_pkt);
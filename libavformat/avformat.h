@@ -2745,6 +2745,10 @@ int avformat_index_get_entries_count(const AVStream *st);
  * @note The pointer returned by this function is only guaranteed to be valid
  *       until any function that takes the stream or the parent AVFormatContext
  *       as input argument is called.
+ * @note Some demuxers keep their index in a compressed form, which this
+ *       function decodes into a cache held by the stream. It must therefore
+ *       not be called concurrently with any other function using the index
+ *       of the same stream.
  */
 const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx);
 
@@ -2762,6 +2766,9 @@ const AVIndexEntry *avformat_index_get_entry(AVStream *st, int idx);
  * @note The pointer returned by this function is only guaranteed to be valid
  *       until any function that takes the stream or the parent AVFormatContext
  *       as input argument is called.
+ * @note Like avformat_index_get_entry(), this function must not be called
+ *       concurrently with any other function using the index of the same
+ *       stream.
  */
 const AVIndexEntry *avformat_index_get_entry_from_timestamp(AVStream *st,
                                                             int64_t wanted_timestamp,
@@ -21,6 +21,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/log.h"
 
 extern const AVClass ff_avio_class;
@@ -119,6 +120,21 @@ void ffio_init_write_context(FFIOContext *s, uint8_t *buffer, int buffer_size);
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Read size bytes from AVIOContext without copying them, if the underlying
+ * protocol can provide them in a buffer of its own (e.g. a mapped file).
+ * The data is followed by AV_INPUT_BUFFER_PADDING_SIZE readable bytes, which
+ * are zeroed at the end of the resource and hold its next bytes elsewhere,
+ * like the data of packets output by parsers.
+ *
+ * @param buf  set to a new reference to the read-only buffer holding the data
+ * @param data set to the start of the data inside buf
+ * @return size on success, AVERROR(ENOSYS) if the data can not be accessed
+ *         without copying, in which case nothing was read, or another
+ *         negative error code
+ */
+int ffio_read_mapped(AVIOContext *s, int size, AVBufferRef **buf, uint8_t **data);
+
 void ffio_fill(AVIOContext *s, int b, int64_t count);
 
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
@@ -31,6 +31,7 @@
 #include "avio.h"
 #include "avio_internal.h"
 #include "internal.h"
+#include "url.h"
 #include <stdarg.h>
 
 #define IO_BUFFER_SIZE 32768
@@ -684,6 +685,42 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_read_mapped(AVIOContext *s, int size, AVBufferRef **pbuf, uint8_t **data)
+{
+    FFIOContext *const ctx = ffiocontext(s);
+    URLContext *h = ffio_geturlcontext(s);
+    int64_t pos, end, cur_pos = s->pos, bytes_read, res;
+    int ret;
+
+    if (!h || !h->prot->url_map || s->write_flag || s->update_checksum ||
+        size <= 0)
+        return AVERROR(ENOSYS);
+
+    pos = avio_tell(s);
+    if (pos < 0)
+        return AVERROR(ENOSYS);
+    end = pos + size;
+
+    ret = h->prot->url_map(h, pos, size, pbuf, data);
+    if (ret < 0)
+        return ret;
+
+    /* Skip the data. avio_seek() may read it into the buffer if it is close
+     * enough, otherwise the mapped bytes are accounted as read here. */
+    bytes_read = ctx->bytes_read;
+    res = avio_seek(s, end, SEEK_SET);
+    if (res < 0) {
+        av_buffer_unref(pbuf);
+        return res;
+    }
+    if (ctx->bytes_read == bytes_read && end > cur_pos) {
+        ctx->bytes_read += end - cur_pos;
+        s->bytes_read    = ctx->bytes_read;
+    }
+
+    return size;
+}
+
 int avio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -994,7 +1031,8 @@ void ffio_write_lines(AVIOContext *s, const unsigned char *buf, int size,
 int ffio_copy_url_options(AVIOContext* pb, AVDictionary** avio_opts)
 {
     const char *opts[] = {
-        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy", NULL };
+        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy",
+        "connection_pool", NULL };
     const char **opt = opts;
     uint8_t *buf = NULL;
     int ret = 0;
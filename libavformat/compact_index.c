@@ -0,0 +1,582 @@
+/*
+ * Compact delta-encoded stream index
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/mem.h"
+
+#include "compact_index.h"
+
+#define CHUNK_ENTRIES   128
+/* four varints of at most 10 bytes each */
+#define MAX_ENTRY_BYTES 40
+
+/**
+ * Each entry is coded relative to the previous one in the same chunk:
+ *  - timestamp: zigzag(delta - previous delta)
+ *  - pos:       zigzag(pos - (previous pos + previous size))
+ *  - size << 2 | flags
+ *  - distance:  zigzag(distance - previous distance)
+ * so constant frame durations and contiguous packets code to single bytes.
+ */
+typedef struct CodingState {
+    uint64_t ts;
+    uint64_t ts_delta;
+    uint64_t end_pos;
+    int      distance;
+} CodingState;
+
+typedef struct IndexChunk {
+    uint8_t *data;
+    unsigned size;
+    unsigned allocated;
+    int nb_entries;
+} IndexChunk;
+
+/**
+ * The chunks are stored in a gap buffer: chunks [0, gap) are in the slots of
+ * the same index and the following ones in the last slots, so that inserting
+ * a chunk only moves the chunks lying between the previous insertion point
+ * and the new one. The numbers of entries of the slots are summed in a
+ * Fenwick tree, which finds the chunk holding an entry in O(log n) without
+ * storing, and renumbering on insertion, the index of its first entry.
+ */
+struct FFCompactIndex {
+    IndexChunk *chunks;
+    int *tree;             ///< Fenwick tree of the nb_entries of the slots
+    int nb_slots;
+    int nb_chunks;
+    int gap;               ///< number of chunks before the gap
+    int nb_entries;
+
+    size_t data_size;      ///< sum of the allocated chunk payloads
+    CodingState tail;      ///< state after the last entry
+    int64_t last_ts;
+
+    int cached_slot;       ///< slot decoded into cache, or -1
+    int cached_first;      ///< index of the first entry of cached_slot
+    AVIndexEntry cache[CHUNK_ENTRIES];
+};
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v  >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static inline const uint8_t *get_varint(const uint8_t *p, uint64_t *v)
+{
+    uint64_t val = 0;
+    int shift = 0;
+
+    do {
+        val   |= (uint64_t)(*p & 0x7F) << shift;
+        shift += 7;
+    } while (*p++ & 0x80);
+    *v = val;
+    return p;
+}
+
+static uint8_t *encode_entry(uint8_t *p, CodingState *s, const AVIndexEntry *e)
+{
+    uint64_t ts_delta = (uint64_t)e->timestamp - s->ts;
+
+    p = put_varint(p, zigzag(ts_delta - s->ts_delta));
+    p = put_varint(p, zigzag((uint64_t)e->pos - s->end_pos));
+    p = put_varint(p, (uint64_t)e->size << 2 | (e->flags & 3));
+    p = put_varint(p, zigzag((int64_t)e->min_distance - s->distance));
+
+    s->ts       = e->timestamp;
+    s->ts_delta = ts_delta;
+    s->end_pos  = (uint64_t)e->pos + e->size;
+    s->distance = e->min_distance;
+    return p;
+}
+
+static void decode_chunk(FFCompactIndex *idx, int slot, int first)
+{
+    const IndexChunk *chunk = &idx->chunks[slot];
+    const uint8_t *p = chunk->data;
+    CodingState s = { 0 };
+
+    for (int i = 0; i < chunk->nb_entries; i++) {
+        AVIndexEntry *e = &idx->cache[i];
+        uint64_t v;
+
+        p = get_varint(p, &v);
+        s.ts_delta += unzigzag(v);
+        s.ts       += s.ts_delta;
+        p = get_varint(p, &v);
+        e->pos      = s.end_pos + unzigzag(v);
+        p = get_varint(p, &v);
+        e->size     = v >> 2;
+        e->flags    = v & 3;
+        p = get_varint(p, &v);
+        s.distance += unzigzag(v);
+
+        e->timestamp    = s.ts;
+        e->min_distance = s.distance;
+        s.end_pos       = (uint64_t)e->pos + e->size;
+    }
+    idx->cached_slot  = slot;
+    idx->cached_first = first;
+}
+
+static int chunk_slot(const FFCompactIndex *idx, int c)
+{
+    return c < idx->gap ? c : c + idx->nb_slots - idx->nb_chunks;
+}
+
+static int slot_chunk(const FFCompactIndex *idx, int slot)
+{
+    return slot < idx->gap ? slot : slot - (idx->nb_slots - idx->nb_chunks);
+}
+
+static void tree_add(FFCompactIndex *idx, int slot, int delta)
+{
+    for (int i = slot + 1; i <= idx->nb_slots; i += i & -i)
+        idx->tree[i] += delta;
+}
+
+static void tree_build(FFCompactIndex *idx)
+{
+    memset(idx->tree, 0, (idx->nb_slots + 1) * sizeof(*idx->tree));
+    for (int i = 1; i <= idx->nb_slots; i++) {
+        int parent = i + (i & -i);
+        idx->tree[i] += idx->chunks[i - 1].nb_entries;
+        if (parent <= idx->nb_slots)
+            idx->tree[parent] += idx->tree[i];
+    }
+}
+
+/**
+ * Find the slot holding entry n, which must exist.
+ *
+ * @param first set to the index of the first entry of the slot
+ */
+static int find_slot(const FFCompactIndex *idx, int n, int *first)
+{
+    int slot = 0, left = n;
+
+    for (int step = 1 << av_log2(idx->nb_slots); step; step >>= 1) {
+        if (slot + step <= idx->nb_slots && idx->tree[slot + step] <= left) {
+            slot += step;
+            left -= idx->tree[slot];
+        }
+    }
+    *first = n - left;
+    return slot;
+}
+
+/**
+ * Encode entries into chunk c, replacing its contents.
+ */
+static int encode_chunk(FFCompactIndex *idx, int slot,
+                        const AVIndexEntry *entries, int nb_entries)
+{
+    IndexChunk *chunk = &idx->chunks[slot];
+    uint8_t buf[CHUNK_ENTRIES * MAX_ENTRY_BYTES];
+    CodingState s = { 0 };
+    uint8_t *p = buf;
+    unsigned size;
+
+    for (int i = 0; i < nb_entries; i++)
+        p = encode_entry(p, &s, &entries[i]);
+    size = p - buf;
+
+    if (size > chunk->allocated || size < chunk->allocated / 2) {
+        uint8_t *data = av_realloc(chunk->data, size + MAX_ENTRY_BYTES);
+        if (!data)
+            return AVERROR(ENOMEM);
+        idx->data_size  += size + MAX_ENTRY_BYTES;
+        idx->data_size  -= chunk->allocated;
+        chunk->data      = data;
+        chunk->allocated = size + MAX_ENTRY_BYTES;
+    }
+    memcpy(chunk->data, buf, size);
+    chunk->size       = size;
+    tree_add(idx, slot, nb_entries - chunk->nb_entries);
+    chunk->nb_entries = nb_entries;
+
+    if (slot == chunk_slot(idx, idx->nb_chunks - 1)) {
+        idx->tail    = s;
+        idx->last_ts = entries[nb_entries - 1].timestamp;
+    }
+    if (idx->cached_slot == slot)
+        idx->cached_slot = -1;
+    return 0;
+}
+
+static int grow_slots(FFCompactIndex *idx)
+{
+    int nb_slots = FFMAX(2 * idx->nb_slots, 16);
+    int nb_after = idx->nb_chunks - idx->gap;
+    IndexChunk *chunks;
+    int *tree;
+
+    if (idx->nb_slots > INT_MAX / 2 - 1)
+        return AVERROR(ENOMEM);
+
+    chunks = av_realloc_array(idx->chunks, nb_slots, sizeof(*chunks));
+    if (!chunks)
+        return AVERROR(ENOMEM);
+    idx->chunks = chunks;
+    tree = av_realloc_array(idx->tree, nb_slots + 1, sizeof(*tree));
+    if (!tree)
+        return AVERROR(ENOMEM);
+    idx->tree = tree;
+
+    memmove(chunks + nb_slots - nb_after, chunks + idx->nb_slots - nb_after,
+            nb_after * sizeof(*chunks));
+    memset(chunks + idx->gap, 0,
+           (nb_slots - idx->nb_chunks) * sizeof(*chunks));
+    idx->nb_slots    = nb_slots;
+    idx->cached_slot = -1;
+    tree_build(idx);
+    return 0;
+}
+
+/**
+ * Move the gap so that it follows the first c chunks.
+ */
+static void move_gap(FFCompactIndex *idx, int c)
+{
+    int gap_size = idx->nb_slots - idx->nb_chunks;
+    int from, to, nb;
+
+    if (c < idx->gap) {
+        from = c;
+        to   = c + gap_size;
+        nb   = idx->gap - c;
+    } else {
+        from = idx->gap + gap_size;
+        to   = idx->gap;
+        nb   = c - idx->gap;
+    }
+    idx->gap = c;
+    if (!nb || !gap_size)
+        return;
+
+    memmove(idx->chunks + to, idx->chunks + from, nb * sizeof(*idx->chunks));
+    memset(idx->chunks + c, 0, gap_size * sizeof(*idx->chunks));
+    idx->cached_slot = -1;
+
+    /* updating the moved slots one by one costs O(nb log n) */
+    if ((int64_t)nb * av_log2(idx->nb_slots) >= idx->nb_slots) {
+        tree_build(idx);
+    } else {
+        for (int i = 0; i < nb; i++) {
+            int nb_entries = idx->chunks[to + i].nb_entries;
+            tree_add(idx, from + i, -nb_entries);
+            tree_add(idx, to + i,    nb_entries);
+        }
+    }
+}
+
+/**
+ * Insert an empty chunk before chunk c.
+ *
+ * @return the slot of the new chunk, which is c
+ */
+static int insert_chunk(FFCompactIndex *idx, int c)
+{
+    if (idx->nb_chunks == idx->nb_slots) {
+        int ret = grow_slots(idx);
+        if (ret < 0)
+            return ret;
+    }
+    move_gap(idx, c);
+    idx->gap++;
+    idx->nb_chunks++;
+    return c;
+}
+
+const AVIndexEntry *ff_compact_index_get(FFCompactIndex *idx, int n)
+{
+    int slot = idx->cached_slot;
+
+    if (n < 0 || n >= idx->nb_entries)
+        return NULL;
+
+    if (slot < 0 || n < idx->cached_first ||
+        n >= idx->cached_first + idx->chunks[slot].nb_entries) {
+        int first;
+        slot = find_slot(idx, n, &first);
+        decode_chunk(idx, slot, first);
+    }
+    return &idx->cache[n - idx->cached_first];
+}
+
+int ff_compact_index_search(FFCompactIndex *idx, int64_t wanted_timestamp,
+                            int flags)
+{
+    int nb_entries = idx->nb_entries;
+    int a, b, m;
+    int64_t timestamp;
+
+    a = -1;
+    b = nb_entries;
+
+    // Optimize appending index entries at the end.
+    if (b && idx->last_ts < wanted_timestamp)
+        a = b - 1;
+
+    while (b - a > 1) {
+        m = (a + b) >> 1;
+
+        // Search for the next non-discarded packet.
+        while ((ff_compact_index_get(idx, m)->flags & AVINDEX_DISCARD_FRAME) &&
+               m < b && m < nb_entries - 1) {
+            m++;
+            if (m == b && ff_compact_index_get(idx, m)->timestamp >= wanted_timestamp) {
+                m = b - 1;
+                break;
+            }
+        }
+
+        timestamp = ff_compact_index_get(idx, m)->timestamp;
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = (flags & AVSEEK_FLAG_BACKWARD) ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < nb_entries &&
+               !(ff_compact_index_get(idx, m)->flags & AVINDEX_KEYFRAME))
+            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+
+    if (m == nb_entries)
+        return -1;
+    return m;
+}
+
+static int append_entry(FFCompactIndex *idx, const AVIndexEntry *e)
+{
+    IndexChunk *chunk;
+    uint8_t *p;
+    int slot;
+
+    if (!idx->nb_chunks ||
+        idx->chunks[chunk_slot(idx, idx->nb_chunks - 1)].nb_entries == CHUNK_ENTRIES) {
+        slot = insert_chunk(idx, idx->nb_chunks);
+        if (slot < 0)
+            return slot;
+        memset(&idx->tail, 0, sizeof(idx->tail));
+    }
+    slot  = chunk_slot(idx, idx->nb_chunks - 1);
+    chunk = &idx->chunks[slot];
+
+    if (chunk->size + MAX_ENTRY_BYTES > chunk->allocated) {
+        unsigned allocated = FFMAX(chunk->allocated * 2, 4 * MAX_ENTRY_BYTES);
+        uint8_t *data = av_realloc(chunk->data, allocated);
+        if (!data)
+            return AVERROR(ENOMEM);
+        idx->data_size  += allocated - chunk->allocated;
+        chunk->data      = data;
+        chunk->allocated = allocated;
+    }
+
+    p = encode_entry(chunk->data + chunk->size, &idx->tail, e);
+    chunk->size = p - chunk->data;
+    chunk->nb_entries++;
+    tree_add(idx, slot, 1);
+
+    /* full chunks only change on insertion, which reallocates them anyway */
+    if (chunk->nb_entries == CHUNK_ENTRIES) {
+        uint8_t *data = av_realloc(chunk->data, chunk->size);
+        if (data) {
+            idx->data_size  -= chunk->allocated - chunk->size;
+            chunk->data      = data;
+            chunk->allocated = chunk->size;
+        }
+    }
+    idx->nb_entries++;
+    idx->last_ts = e->timestamp;
+
+    if (idx->cached_slot == slot)
+        idx->cache[chunk->nb_entries - 1] = *e;
+    return idx->nb_entries - 1;
+}
+
+static int insert_entry(FFCompactIndex *idx, int n, const AVIndexEntry *e)
+{
+    AVIndexEntry entries[CHUNK_ENTRIES + 1];
+    int first, slot = find_slot(idx, n, &first);
+    int nb = idx->chunks[slot].nb_entries, local = n - first;
+    int ret;
+
+    decode_chunk(idx, slot, first);
+    memcpy(entries, idx->cache, local * sizeof(*entries));
+    entries[local] = *e;
+    memcpy(entries + local + 1, idx->cache + local,
+           (nb - local) * sizeof(*entries));
+    nb++;
+    /* the following entries are renumbered */
+    idx->cached_slot = -1;
+
+    if (nb > CHUNK_ENTRIES) {
+        int half = nb / 2, c = slot_chunk(idx, slot);
+        /* the chunks before the new one keep the slot of their index */
+        ret = insert_chunk(idx, c + 1);
+        if (ret < 0)
+            return ret;
+        slot = c;
+        ret = encode_chunk(idx, c + 1, entries + half, nb - half);
+        if (ret < 0)
+            return ret;
+        nb = half;
+    }
+    ret = encode_chunk(idx, slot, entries, nb);
+    if (ret < 0)
+        return ret;
+
+    idx->nb_entries++;
+    return n;
+}
+
+static int replace_entry(FFCompactIndex *idx, int n, const AVIndexEntry *e)
+{
+    AVIndexEntry entries[CHUNK_ENTRIES];
+    int first, slot = find_slot(idx, n, &first);
+    int nb = idx->chunks[slot].nb_entries;
+    int ret;
+
+    decode_chunk(idx, slot, first);
+    memcpy(entries, idx->cache, nb * sizeof(*entries));
+    entries[n - first] = *e;
+    ret = encode_chunk(idx, slot, entries, nb);
+    return ret < 0 ? ret : n;
+}
+
+int ff_compact_index_add(FFCompactIndex *idx, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags)
+{
+    AVIndexEntry e = {
+        .pos          = pos,
+        .timestamp    = timestamp,
+        .flags        = flags,
+        .size         = size,
+        .min_distance = distance,
+    };
+    const AVIndexEntry *ie;
+    int index;
+
+    if ((unsigned)idx->nb_entries + 1 >= INT_MAX)
+        return -1;
+
+    index = ff_compact_index_search(idx, timestamp, AVSEEK_FLAG_ANY);
+    if (index < 0) {
+        av_assert0(!idx->nb_entries || idx->last_ts < timestamp);
+        return append_entry(idx, &e);
+    }
+
+    ie = ff_compact_index_get(idx, index);
+    if (ie->timestamp != timestamp) {
+        if (ie->timestamp <= timestamp)
+            return -1;
+        return insert_entry(idx, index, &e);
+    } else if (ie->pos == pos && distance < ie->min_distance)
+        // do not reduce the distance
+        e.min_distance = ie->min_distance;
+
+    return replace_entry(idx, index, &e);
+}
+
+int ff_compact_index_nb_entries(const FFCompactIndex *idx)
+{
+    return idx->nb_entries;
+}
+
+size_t ff_compact_index_size(const FFCompactIndex *idx)
+{
+    return sizeof(*idx) + idx->data_size +
+           idx->nb_slots * (sizeof(*idx->chunks) + sizeof(*idx->tree));
+}
+
+int ff_compact_index_reduce(FFCompactIndex *idx)
+{
+    FFCompactIndex *reduced = ff_compact_index_alloc();
+    int ret = 0;
+
+    if (!reduced)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < idx->nb_entries && ret >= 0; i += 2)
+        ret = append_entry(reduced, ff_compact_index_get(idx, i));
+    if (ret < 0) {
+        ff_compact_index_free(&reduced);
+        return ret;
+    }
+
+    for (int i = 0; i < idx->nb_slots; i++)
+        av_free(idx->chunks[i].data);
+    av_free(idx->chunks);
+    av_free(idx->tree);
+    idx->chunks      = reduced->chunks;
+    idx->tree        = reduced->tree;
+    idx->nb_slots    = reduced->nb_slots;
+    idx->nb_chunks   = reduced->nb_chunks;
+    idx->gap         = reduced->gap;
+    idx->nb_entries  = reduced->nb_entries;
+    idx->data_size   = reduced->data_size;
+    idx->tail        = reduced->tail;
+    idx->last_ts     = reduced->last_ts;
+    idx->cached_slot = -1;
+    av_free(reduced);
+    return 0;
+}
+
+FFCompactIndex *ff_compact_index_alloc(void)
+{
+    FFCompactIndex *idx = av_mallocz(sizeof(*idx));
+    if (idx)
+        idx->cached_slot = -1;
+    return idx;
+}
+
+void ff_compact_index_free(FFCompactIndex **pidx)
+{
+    FFCompactIndex *idx = *pidx;
+
+    if (!idx)
+        return;
+    for (int i = 0; i < idx->nb_slots; i++)
+        av_free(idx->chunks[i].data);
+    av_free(idx->chunks);
+    av_free(idx->tree);
+    av_freep(pidx);
+}
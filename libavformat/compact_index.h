@@ -0,0 +1,85 @@
+/*
+ * Compact delta-encoded stream index
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_COMPACT_INDEX_H
+#define AVFORMAT_COMPACT_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "avformat.h"
+
+/**
+ * Alternative storage for the index of a stream.
+ *
+ * Entries are kept sorted by timestamp in fixed-capacity chunks of
+ * variable-length, delta-encoded records, which typically take 4 to 6
+ * bytes instead of sizeof(AVIndexEntry). Appending is O(1); lookups and
+ * insertions locate the chunk in O(log n) and only decode or re-encode
+ * that chunk.
+ *
+ * Demuxers opt in with FF_INFMT_FLAG_COMPACT_INDEX. Their streams then
+ * keep FFStream.index_entries empty, and all index accesses must go
+ * through av_index_search_timestamp(), avformat_index_get_entry(),
+ * avformat_index_get_entries_count() and friends.
+ */
+typedef struct FFCompactIndex FFCompactIndex;
+
+FFCompactIndex *ff_compact_index_alloc(void);
+
+void ff_compact_index_free(FFCompactIndex **idx);
+
+/**
+ * Add an entry, with the same semantics as ff_add_index_entry().
+ *
+ * @return the index of the entry or a negative value on failure
+ */
+int ff_compact_index_add(FFCompactIndex *idx, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags);
+
+/**
+ * Search for a timestamp, with the same semantics as
+ * ff_index_search_timestamp().
+ */
+int ff_compact_index_search(FFCompactIndex *idx, int64_t wanted_timestamp,
+                            int flags);
+
+/**
+ * Get an entry. The chunk holding it is decoded into a cache owned by idx,
+ * so this function modifies idx like the others taking it, and the
+ * returned pointer is only valid until the next call to any of them.
+ *
+ * @return the entry or NULL if n is out of range
+ */
+const AVIndexEntry *ff_compact_index_get(FFCompactIndex *idx, int n);
+
+int ff_compact_index_nb_entries(const FFCompactIndex *idx);
+
+/**
+ * @return the number of bytes allocated for the index
+ */
+size_t ff_compact_index_size(const FFCompactIndex *idx);
+
+/**
+ * Drop every second entry, like ff_reduce_index() does for the plain index.
+ */
+int ff_compact_index_reduce(FFCompactIndex *idx);
+
+#endif /* AVFORMAT_COMPACT_INDEX_H */
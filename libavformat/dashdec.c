@@ -19,6 +19,8 @@
  * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include "config_components.h"
+
 #include <libxml/parser.h>
 #include <time.h>
 #include "libavutil/bprint.h"
@@ -26,10 +28,13 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "dash.h"
 #include "demux.h"
+#include "http.h"
+#include "prefetch.h"
 #include "url.h"
 
 #define INITIAL_BUFFER_SIZE 32768
@@ -71,6 +76,7 @@ struct timeline {
     int64_t duration;
 };
 
+
 /*
  * Each playlist has its own demuxer. If it is currently active,
  * it has an opened AVIOContext too, and potentially an AVPacket
@@ -118,6 +124,12 @@ struct representation {
     uint32_t init_sec_buf_read_offset;
     int64_t cur_timestamp;
     int is_restart_needed;
+
+    /* Segments downloaded in the background, if enabled, and the one
+     * currently read from */
+    FFPrefetchSlot *prefetch_slots;
+    int nb_prefetch_slots;
+    FFPrefetchSlot *cur_slot;
 };
 
 typedef struct DASHContext {
@@ -154,6 +166,9 @@ typedef struct DASHContext {
     AVDictionary *avio_opts;
     int max_url_size;
     char *cenc_decryption_key;
+    int prefetch_segments;
+    int64_t prefetch_max_size;
+    FFPrefetch *prefetch;
 
     /* Flags for init section*/
     int is_init_section_common_video;
@@ -468,6 +483,84 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     return ret;
 }
 
+#if HAVE_THREADS
+/*
+ * Background segment fetching.
+ *
+ * A pool of threads shared by all the representations downloads the
+ * current segment of each of them and the following ones, see prefetch.h,
+ * so that the segments of the audio and video representations are
+ * requested in parallel instead of one after the other. Each thread keeps
+ * its last HTTP connection open to reuse it for the next segment.
+ */
+
+#define PREFETCH_MAX_THREADS 16
+
+static int prefetch_open_url(AVFormatContext *s, AVIOContext **pb,
+                             FFPrefetchSlot *slot)
+{
+#if CONFIG_HTTP_PROTOCOL
+    if (*pb) {
+        AVDictionary *tmp = NULL;
+        int ret;
+
+        av_dict_copy(&tmp, slot->avio_opts, 0);
+        av_dict_copy(&tmp, slot->opts, 0);
+        (*pb)->eof_reached = 0;
+        ret = ff_http_do_new_request2(ffio_geturlcontext(*pb), slot->url, &tmp);
+        av_dict_free(&tmp);
+        /* only retry with a new connection if the server did not answer */
+        if (ret >= 0 || ret == AVERROR_EXIT ||
+            ret == AVERROR_HTTP_BAD_REQUEST || ret == AVERROR_HTTP_UNAUTHORIZED ||
+            ret == AVERROR_HTTP_FORBIDDEN   || ret == AVERROR_HTTP_NOT_FOUND ||
+            ret == AVERROR_HTTP_TOO_MANY_REQUESTS ||
+            ret == AVERROR_HTTP_OTHER_4XX   || ret == AVERROR_HTTP_SERVER_ERROR) {
+            slot->keepalive = 1;
+            return ret;
+        }
+    }
+#endif
+    ff_format_io_close(s, pb);
+    return open_url(s, pb, slot->url, &slot->avio_opts, slot->opts, &slot->keepalive);
+}
+
+static int prefetch_read(struct representation *pls, uint8_t *buf, int buf_size)
+{
+    DASHContext *c = pls->parent->priv_data;
+
+    return ff_prefetch_read(c->prefetch, pls->cur_slot, &pls->cur_seg_offset,
+                            buf, buf_size);
+}
+
+static int64_t prefetch_seek(struct representation *pls, int64_t offset, int whence)
+{
+    DASHContext *c = pls->parent->priv_data;
+
+    return ff_prefetch_seek(c->prefetch, pls->cur_slot, &pls->cur_seg_offset,
+                            offset, whence);
+}
+#endif /* HAVE_THREADS */
+
+/* Drop the segments prefetched for a representation, e.g. after a seek. */
+static void prefetch_reset(DASHContext *c, struct representation *pls)
+{
+#if HAVE_THREADS
+    if (pls->prefetch_slots)
+        ff_prefetch_flush(c->prefetch, pls->prefetch_slots, pls->nb_prefetch_slots);
+#endif
+    pls->cur_slot = NULL;
+}
+
+/* Release the current segment once it was read. */
+static void prefetch_close(DASHContext *c, struct representation *pls)
+{
+#if HAVE_THREADS
+    if (pls->cur_slot)
+        ff_prefetch_close(c->prefetch, pls->cur_slot);
+#endif
+    pls->cur_slot = NULL;
+}
+
 static char *get_content_url(xmlNodePtr *baseurl_nodes,
                              int n_baseurl_nodes,
                              int max_url_size,
@@ -1611,29 +1704,67 @@ finish:
     return ret;
 }
 
+/* Get the fragment with the given number, either from the fragment list or
+ * from the URL template. */
+static struct fragment *new_fragment(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    struct fragment *seg;
+    char *tmpfilename;
+
+    seg = av_mallocz(sizeof(struct fragment));
+    if (!seg)
+        return NULL;
+
+    if (seq_no < pls->n_fragments) {
+        struct fragment *seg_ptr = pls->fragments[seq_no];
+        seg->url = av_strdup(seg_ptr->url);
+        if (!seg->url) {
+            av_free(seg);
+            return NULL;
+        }
+        seg->size = seg_ptr->size;
+        seg->url_offset = seg_ptr->url_offset;
+        return seg;
+    }
+
+    if (!pls->url_template) {
+        av_log(pls->parent, AV_LOG_ERROR, "Cannot get fragment, missing template URL\n");
+        av_free(seg);
+        return NULL;
+    }
+    tmpfilename = av_mallocz(c->max_url_size);
+    if (!tmpfilename) {
+        av_free(seg);
+        return NULL;
+    }
+    ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0, get_segment_start_time_based_on_timeline(pls, seq_no));
+    seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+    if (!seg->url) {
+        av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
+        seg->url = av_strdup(pls->url_template);
+        if (!seg->url) {
+            av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
+            av_free(tmpfilename);
+            av_free(seg);
+            return NULL;
+        }
+    }
+    av_free(tmpfilename);
+    seg->size = -1;
+
+    return seg;
+}
+
 static struct fragment *get_current_fragment(struct representation *pls)
 {
     int64_t min_seq_no = 0;
     int64_t max_seq_no = 0;
-    struct fragment *seg = NULL;
-    struct fragment *seg_ptr = NULL;
     DASHContext *c = pls->parent->priv_data;
 
     while (( !ff_check_interrupt(c->interrupt_callback)&& pls->n_fragments > 0)) {
         if (pls->cur_seq_no < pls->n_fragments) {
-            seg_ptr = pls->fragments[pls->cur_seq_no];
-            seg = av_mallocz(sizeof(struct fragment));
-            if (!seg) {
-                return NULL;
-            }
-            seg->url = av_strdup(seg_ptr->url);
-            if (!seg->url) {
-                av_free(seg);
-                return NULL;
-            }
-            seg->size = seg_ptr->size;
-            seg->url_offset = seg_ptr->url_offset;
-            return seg;
+            return new_fragment(pls, pls->cur_seq_no);
         } else if (c->is_live) {
             refresh_manifest(pls->parent);
         } else {
@@ -1653,45 +1784,11 @@ static struct fragment *get_current_fragment(struct representation *pls)
         } else if (pls->cur_seq_no > max_seq_no) {
             av_log(pls->parent, AV_LOG_VERBOSE, "new fragment: min[%"PRId64"] max[%"PRId64"]\n", min_seq_no, max_seq_no);
         }
-        seg = av_mallocz(sizeof(struct fragment));
-        if (!seg) {
-            return NULL;
-        }
-    } else if (pls->cur_seq_no <= pls->last_seq_no) {
-        seg = av_mallocz(sizeof(struct fragment));
-        if (!seg) {
-            return NULL;
-        }
-    }
-    if (seg) {
-        char *tmpfilename;
-        if (!pls->url_template) {
-            av_log(pls->parent, AV_LOG_ERROR, "Cannot get fragment, missing template URL\n");
-            av_free(seg);
-            return NULL;
-        }
-        tmpfilename = av_mallocz(c->max_url_size);
-        if (!tmpfilename) {
-            av_free(seg);
-            return NULL;
-        }
-        ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, pls->cur_seq_no, 0, get_segment_start_time_based_on_timeline(pls, pls->cur_seq_no));
-        seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
-        if (!seg->url) {
-            av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
-            seg->url = av_strdup(pls->url_template);
-            if (!seg->url) {
-                av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
-                av_free(tmpfilename);
-                av_free(seg);
-                return NULL;
-            }
-        }
-        av_free(tmpfilename);
-        seg->size = -1;
+    } else if (pls->cur_seq_no > pls->last_seq_no) {
+        return NULL;
     }
 
-    return seg;
+    return new_fragment(pls, pls->cur_seq_no);
 }
 
 static int read_from_url(struct representation *pls, struct fragment *seg,
@@ -1699,6 +1796,11 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
 {
     int ret;
 
+#if HAVE_THREADS
+    if (pls->cur_slot)
+        return prefetch_read(pls, buf, buf_size);
+#endif
+
     /* limit read if the fragment was only a part of a file */
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
@@ -1710,28 +1812,38 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     return ret;
 }
 
-static int open_input(DASHContext *c, struct representation *pls, struct fragment *seg)
+/* Build the absolute URL and the protocol options used to fetch a fragment. */
+static int prepare_input(DASHContext *c, struct representation *pls, struct fragment *seg,
+                         char **url, AVDictionary **opts)
 {
-    AVDictionary *opts = NULL;
-    char *url = NULL;
-    int ret = 0;
-
-    url = av_mallocz(c->max_url_size);
-    if (!url) {
-        ret = AVERROR(ENOMEM);
-        goto cleanup;
-    }
+    *url = av_mallocz(c->max_url_size);
+    if (!*url)
+        return AVERROR(ENOMEM);
 
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
          * (if this is in fact a HTTP request) */
-        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
-        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+        av_dict_set_int(opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(opts, "end_offset", seg->url_offset + seg->size, 0);
     }
 
-    ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
+    ff_make_absolute_url(*url, c->max_url_size, c->base_url, seg->url);
     av_log(pls->parent, AV_LOG_VERBOSE, "DASH request for url '%s', offset %"PRId64"\n",
-           url, seg->url_offset);
+           *url, seg->url_offset);
+
+    return 0;
+}
+
+static int open_input(DASHContext *c, struct representation *pls, struct fragment *seg)
+{
+    AVDictionary *opts = NULL;
+    char *url = NULL;
+    int ret = 0;
+
+    ret = prepare_input(c, pls, seg, &url, &opts);
+    if (ret < 0)
+        goto cleanup;
+
     ret = open_url(pls->parent, &pls->input, url, &c->avio_opts, opts, NULL);
 
 cleanup:
@@ -1742,6 +1854,130 @@ cleanup:
     return ret;
 }
 
+#if HAVE_THREADS
+static int prefetch_alloc(AVFormatContext *s)
+{
+    DASHContext *c = s->priv_data;
+    struct representation **reps[] = { c->videos, c->audios, c->subtitles };
+    int n_reps[] = { c->n_videos, c->n_audios, c->n_subtitles };
+    FFPrefetchSlot *slots;
+    int nb_slots = 0;
+    int ret;
+
+    /* single file representations are read directly */
+    for (int i = 0; i < FF_ARRAY_ELEMS(reps); i++)
+        for (int j = 0; j < n_reps[i]; j++)
+            if (reps[i][j]->n_fragments != 1)
+                nb_slots += c->prefetch_segments;
+    if (!nb_slots)
+        return 0;
+
+    ret = ff_prefetch_alloc(&c->prefetch, s, nb_slots,
+                            FFMIN(nb_slots, PREFETCH_MAX_THREADS), 0,
+                            "dash-prefetch", prefetch_open_url);
+    if (ret < 0)
+        return ret;
+
+    slots = ff_prefetch_slots(c->prefetch);
+    for (int i = 0; i < FF_ARRAY_ELEMS(reps); i++) {
+        for (int j = 0; j < n_reps[i]; j++) {
+            struct representation *pls = reps[i][j];
+            if (pls->n_fragments == 1)
+                continue;
+            pls->prefetch_slots    = slots;
+            pls->nb_prefetch_slots = c->prefetch_segments;
+            slots += c->prefetch_segments;
+        }
+    }
+
+    return 0;
+}
+
+/* Release the slots outside of the prefetch window of a representation and
+ * queue the fragments of the window that are not fetched yet. */
+static int prefetch_schedule(void *opaque)
+{
+    struct representation *pls = opaque;
+    DASHContext *c = pls->parent->priv_data;
+    FFPrefetch *pf = c->prefetch;
+    int64_t end;
+
+    /* the following fragments of live streams may not be available yet */
+    if (c->is_live)
+        end = pls->cur_seq_no + 1;
+    else
+        end = FFMIN(pls->cur_seq_no + pls->nb_prefetch_slots,
+                    pls->n_fragments ? pls->n_fragments : pls->last_seq_no + 1);
+
+    ff_prefetch_release(pf, pls->prefetch_slots, pls->nb_prefetch_slots,
+                        pls->cur_seq_no, end);
+
+    for (int64_t seq_no = pls->cur_seq_no; seq_no < end; seq_no++) {
+        FFPrefetchSlot *slot;
+        struct fragment *seg;
+        AVDictionary *opts = NULL;
+        char *url = NULL;
+        int ret;
+
+        /* the current fragment is always fetched, the following ones only
+         * while the memory limit is not reached */
+        if (ff_prefetch_get_slot(pf, pls->prefetch_slots, pls->nb_prefetch_slots,
+                                 seq_no, seq_no == pls->cur_seq_no ? INT64_MAX :
+                                                                     c->prefetch_max_size,
+                                 &slot))
+            continue;
+        if (!slot)
+            break;
+
+        seg = seq_no == pls->cur_seq_no ? pls->cur_seg : new_fragment(pls, seq_no);
+        if (!seg)
+            return seq_no == pls->cur_seq_no ? AVERROR(ENOMEM) : 0;
+
+        /* empty slots are only used by this thread, no need for locking */
+        ret = prepare_input(c, pls, seg, &url, &opts);
+        if (ret >= 0)
+            ret = av_dict_set(&opts, "multiple_requests", "1", 0);
+        if (ret >= 0)
+            ret = av_dict_copy(&slot->avio_opts, c->avio_opts, 0);
+        slot->size = seg->size;
+        if (seg != pls->cur_seg)
+            free_fragment(&seg);
+        if (ret < 0) {
+            av_free(url);
+            av_dict_free(&opts);
+            av_dict_free(&slot->avio_opts);
+            return seq_no == pls->cur_seq_no ? ret : 0;
+        }
+        slot->seq_no = seq_no;
+        slot->url    = url;
+        slot->opts   = opts;
+
+        ff_prefetch_queue(pf, slot);
+    }
+
+    return 0;
+}
+
+/* Wait for the current fragment to start arriving. */
+static int prefetch_open(struct representation *pls)
+{
+    DASHContext *c = pls->parent->priv_data;
+    FFPrefetchSlot *slot;
+    int ret;
+
+    ret = ff_prefetch_open(c->prefetch, pls->prefetch_slots, pls->nb_prefetch_slots,
+                           pls->cur_seq_no, prefetch_schedule, pls, &slot);
+    if (ret < 0)
+        return ret;
+
+    pls->cur_slot       = slot;
+    pls->cur_seg_offset = 0;
+    pls->cur_seg_size   = slot->size;
+
+    return 0;
+}
+#endif /* HAVE_THREADS */
+
 static int update_init_section(struct representation *pls)
 {
     static const int max_init_section_size = 1024 * 1024;
@@ -1792,6 +2028,10 @@ static int64_t seek_data(void *opaque, int64_t offset, int whence)
 {
     struct representation *v = opaque;
     if (v->n_fragments && !v->init_sec_data_len) {
+#if HAVE_THREADS
+        if (v->cur_slot)
+            return prefetch_seek(v, offset, whence);
+#endif
         return avio_seek(v->input, offset, whence);
     }
 
@@ -1805,7 +2045,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->cur_slot) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1818,6 +2058,11 @@ restart:
         if (ret)
             goto end;
 
+#if HAVE_THREADS
+        if (v->prefetch_slots)
+            ret = prefetch_open(v);
+        else
+#endif
         ret = open_input(c, v, v->cur_seg);
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback)) {
@@ -2066,6 +2311,18 @@ static int dash_read_header(AVFormatContext *s)
         av_dict_set(&c->avio_opts, "seekable", "0", 0);
     }
 
+    if (c->prefetch_segments) {
+#if HAVE_THREADS
+        if (!ff_format_io_is_default(s)) {
+            av_log(s, AV_LOG_WARNING, "Segment prefetching calls the I/O callbacks "
+                   "from several threads, disabling it with custom ones\n");
+        } else if ((ret = prefetch_alloc(s)) < 0)
+            return ret;
+#else
+        av_log(s, AV_LOG_WARNING, "Segment prefetching requires threads, disabling it\n");
+#endif
+    }
+
     if(c->n_videos)
         c->is_init_section_common_video = is_common_init_section_exist(c->videos, c->n_videos);
 
@@ -2177,6 +2434,7 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
             ff_format_io_close(pls->parent, &pls->input);
+            prefetch_reset(s->priv_data, pls);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2239,6 +2497,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->init_sec_buf_read_offset = 0;
             cur->is_restart_needed = 0;
             ff_format_io_close(cur->parent, &cur->input);
+            prefetch_close(c, cur);
             ret = reopen_demux_for_component(s, cur);
         }
     }
@@ -2248,6 +2507,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
 static int dash_close(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
+    ff_prefetch_free(&c->prefetch);
     free_audio_list(c);
     free_video_list(c);
     free_subtitle_list(c);
@@ -2277,6 +2537,7 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
     }
 
     ff_format_io_close(pls->parent, &pls->input);
+    prefetch_reset(s->priv_data, pls);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2375,6 +2636,8 @@ static const AVOption dash_options[] = {
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
     { "cenc_decryption_key", "Media decryption key (hex)", OFFSET(cenc_decryption_key), AV_OPT_TYPE_STRING, {.str = NULL}, INT_MIN, INT_MAX, .flags = FLAGS },
+    { "prefetch_segments", "Number of segments of each representation downloaded in parallel", OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, FLAGS },
+    { "prefetch_max_size", "Maximum amount of prefetched segment data held in memory", OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS },
     {NULL}
 };
 
@@ -43,6 +43,11 @@ struct AVDeviceInfoList;
  * Automatically parse ID3v2 metadata
  */
 #define FF_INFMT_FLAG_ID3V2_AUTO                               (1 << 2)
+/**
+ * The demuxer only accesses the stream index through the generic index
+ * functions, so the index may be stored as an FFCompactIndex.
+ */
+#define FF_INFMT_FLAG_COMPACT_INDEX                            (1 << 3)
 
 typedef struct FFInputFormat {
     /**
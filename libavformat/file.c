@@ -19,13 +19,18 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE     /* Needed for O_DIRECT */
+
 #include "config_components.h"
 
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavcodec/defs.h"
 #include "avio.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -39,6 +44,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -89,6 +97,10 @@
 
 /* standard file protocol */
 
+#define HAVE_READAHEAD (HAVE_THREADS && HAVE_PREAD)
+
+typedef struct Readahead Readahead;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -97,6 +109,17 @@ typedef struct FileContext {
     int pkt_size;
     int follow;
     int seekable;
+    int readahead;
+    int readahead_size;
+    int direct;
+    int mmap;
+    Readahead *ra;
+    /* size and modification time of the file when it was opened if packets
+     * can be mapped, else 0 */
+    int64_t map_size;
+    time_t map_mtime;
+    /* the whole file mapped in memory, created on the first mapped packet */
+    AVBufferRef *map;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -108,6 +131,10 @@ static const AVOption file_options[] = {
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
     { "pkt_size", "Maximum packet size", offsetof(FileContext, pkt_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "readahead", "Number of blocks read in advance in the background", offsetof(FileContext, readahead), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, AV_OPT_FLAG_DECODING_PARAM },
+    { "readahead_size", "Size of the blocks read in advance", offsetof(FileContext, readahead_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, 1 << 28, AV_OPT_FLAG_DECODING_PARAM },
+    { "direct", "Bypass the page cache when reading in advance", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "mmap", "Map the file in memory and let demuxers reference it without copying", offsetof(FileContext, mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -138,11 +165,341 @@ static const AVClass fd_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_READAHEAD
+/*
+ * Background readahead for regular files.
+ *
+ * A fixed set of blocks, aligned to READAHEAD_ALIGN in the file, is filled
+ * by a few worker threads with pread(), so that several reads are in flight
+ * while the caller consumes the current block. Blocks that fall out of the
+ * window [current position, next scheduled block) are recycled, which makes
+ * seeks cheap: a seek within the window keeps the blocks already read, any
+ * other one just restarts the window at the new position.
+ */
+
+#define READAHEAD_ALIGN       4096
+#define READAHEAD_MAX_THREADS 4
+
+enum BlockState {
+    BLOCK_FREE,
+    BLOCK_QUEUED,
+    BLOCK_READING,
+    BLOCK_READY,
+};
+
+typedef struct ReadaheadBlock {
+    uint8_t        *buf;
+    uint8_t        *data;       ///< buf aligned to READAHEAD_ALIGN
+    int64_t         pos;
+    /* number of bytes read, less than the block size only at the end of the
+     * file, or an error code */
+    int             size;
+    enum BlockState state;
+} ReadaheadBlock;
+
+struct Readahead {
+    int             fd;
+    int             block_size;
+
+    ReadaheadBlock *blocks;
+    int             nb_blocks;
+
+    /* current read position */
+    int64_t         pos;
+    /* position of the next block to read */
+    int64_t         next_pos;
+    int64_t         file_size;
+
+    pthread_t       threads[READAHEAD_MAX_THREADS];
+    int             nb_threads;
+    int             abort_request;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond_worker;
+    pthread_cond_t  cond_reader;
+};
+
+static void *readahead_worker(void *arg)
+{
+    Readahead *ra = arg;
+
+    ff_thread_setname("readahead");
+
+    pthread_mutex_lock(&ra->mutex);
+    while (!ra->abort_request) {
+        ReadaheadBlock *b = NULL;
+        int64_t pos;
+        int size = 0;
+
+        for (int i = 0; i < ra->nb_blocks; i++) {
+            if (ra->blocks[i].state == BLOCK_QUEUED) {
+                b = &ra->blocks[i];
+                break;
+            }
+        }
+        if (!b) {
+            pthread_cond_wait(&ra->cond_worker, &ra->mutex);
+            continue;
+        }
+
+        b->state = BLOCK_READING;
+        pos      = b->pos;
+        pthread_mutex_unlock(&ra->mutex);
+
+        while (size < ra->block_size) {
+            ssize_t ret = pread(ra->fd, b->data + size, ra->block_size - size, pos + size);
+            if (ret < 0 && errno == EINTR)
+                continue;
+            if (ret < 0) {
+                size = AVERROR(errno);
+                break;
+            }
+            size += ret;
+            /* A short read means the end of the file; do not read again
+             * from an unaligned offset, which O_DIRECT would reject. */
+            if (ret < ra->block_size - (size - ret))
+                break;
+        }
+
+        pthread_mutex_lock(&ra->mutex);
+        b->size  = size;
+        b->state = BLOCK_READY;
+        pthread_cond_signal(&ra->cond_reader);
+    }
+    pthread_mutex_unlock(&ra->mutex);
+
+    return NULL;
+}
+
+/* Recycle the blocks outside of the current window and queue the following
+ * blocks of the file into them. Must be called with the mutex held.
+ * Returns non zero if any block was queued. */
+static int readahead_schedule(Readahead *ra)
+{
+    int queued = 0;
+
+    for (int i = 0; i < ra->nb_blocks; i++) {
+        ReadaheadBlock *b = &ra->blocks[i];
+
+        if ((b->state == BLOCK_QUEUED || b->state == BLOCK_READY) &&
+            (b->pos + ra->block_size <= ra->pos || b->pos >= ra->next_pos))
+            b->state = BLOCK_FREE;
+    }
+
+    for (int i = 0; i < ra->nb_blocks && ra->next_pos < ra->file_size; i++) {
+        ReadaheadBlock *b = &ra->blocks[i];
+
+        if (b->state != BLOCK_FREE)
+            continue;
+
+        b->pos   = ra->next_pos;
+        b->size  = 0;
+        b->state = BLOCK_QUEUED;
+        ra->next_pos += ra->block_size;
+        queued = 1;
+    }
+
+    if (queued)
+        pthread_cond_broadcast(&ra->cond_worker);
+    return queued;
+}
+
+static ReadaheadBlock *readahead_find(Readahead *ra)
+{
+    for (int i = 0; i < ra->nb_blocks; i++) {
+        ReadaheadBlock *b = &ra->blocks[i];
+
+        if (b->state != BLOCK_FREE &&
+            b->pos <= ra->pos && ra->pos < b->pos + ra->block_size)
+            return b;
+    }
+    return NULL;
+}
+
+static int readahead_read(Readahead *ra, unsigned char *buf, int size)
+{
+    ReadaheadBlock *b;
+    int ret;
+
+    pthread_mutex_lock(&ra->mutex);
+    while (1) {
+        b = readahead_find(ra);
+        if (!b) {
+            if (ra->pos >= ra->file_size) {
+                /* the file may have grown since it was opened */
+                struct stat st;
+                if (!fstat(ra->fd, &st))
+                    ra->file_size = st.st_size;
+                if (ra->pos >= ra->file_size) {
+                    ret = AVERROR_EOF;
+                    break;
+                }
+            }
+            ra->next_pos = ra->pos & ~(int64_t)(READAHEAD_ALIGN - 1);
+            /* all blocks are being read, wait for one to be recycled */
+            if (!readahead_schedule(ra))
+                pthread_cond_wait(&ra->cond_reader, &ra->mutex);
+            continue;
+        }
+
+        if (b->state != BLOCK_READY) {
+            pthread_cond_wait(&ra->cond_reader, &ra->mutex);
+            continue;
+        }
+
+        if (b->size < 0) {
+            ret = b->size;
+            b->state = BLOCK_FREE;
+            break;
+        }
+
+        ret = FFMIN(size, b->pos + b->size - ra->pos);
+        if (ret <= 0) {
+            ret = AVERROR_EOF;
+            break;
+        }
+
+        memcpy(buf, b->data + (ra->pos - b->pos), ret);
+        ra->pos += ret;
+        if (ra->pos >= b->pos + ra->block_size)
+            readahead_schedule(ra);
+        break;
+    }
+    pthread_mutex_unlock(&ra->mutex);
+
+    return ret;
+}
+
+static int64_t readahead_seek(Readahead *ra, int64_t pos, int whence)
+{
+    int64_t ret;
+
+    pthread_mutex_lock(&ra->mutex);
+    switch (whence) {
+    case SEEK_SET: ret = pos;                 break;
+    case SEEK_CUR: ret = ra->pos + pos;       break;
+    case SEEK_END: ret = ra->file_size + pos; break;
+    default:       ret = AVERROR(EINVAL);     break;
+    }
+    if (ret < 0)
+        ret = AVERROR(EINVAL);
+    else
+        ra->pos = ret;
+    pthread_mutex_unlock(&ra->mutex);
+
+    return ret;
+}
+
+static void readahead_free(Readahead **pra)
+{
+    Readahead *ra = *pra;
+
+    if (!ra)
+        return;
+
+    pthread_mutex_lock(&ra->mutex);
+    ra->abort_request = 1;
+    pthread_cond_broadcast(&ra->cond_worker);
+    pthread_mutex_unlock(&ra->mutex);
+
+    for (int i = 0; i < ra->nb_threads; i++)
+        pthread_join(ra->threads[i], NULL);
+
+    pthread_cond_destroy(&ra->cond_reader);
+    pthread_cond_destroy(&ra->cond_worker);
+    pthread_mutex_destroy(&ra->mutex);
+
+    for (int i = 0; i < ra->nb_blocks; i++)
+        av_free(ra->blocks[i].buf);
+    av_freep(&ra->blocks);
+    av_freep(pra);
+}
+
+static int readahead_alloc(URLContext *h, Readahead **pra, int fd,
+                           int nb_blocks, int block_size, int64_t file_size)
+{
+    Readahead *ra;
+    int ret;
+
+    ra = av_mallocz(sizeof(*ra));
+    if (!ra)
+        return AVERROR(ENOMEM);
+
+    ra->fd         = fd;
+    ra->block_size = FFALIGN(block_size, READAHEAD_ALIGN);
+    ra->file_size  = file_size;
+
+    ra->blocks = av_calloc(nb_blocks, sizeof(*ra->blocks));
+    if (!ra->blocks) {
+        av_free(ra);
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < nb_blocks; i++) {
+        ReadaheadBlock *b = &ra->blocks[i];
+
+        /* O_DIRECT requires buffers aligned to the logical block size */
+        b->buf = av_malloc(ra->block_size + READAHEAD_ALIGN - 1);
+        if (!b->buf) {
+            ret = AVERROR(ENOMEM);
+            goto fail_blocks;
+        }
+        b->data = (uint8_t*)FFALIGN((uintptr_t)b->buf, READAHEAD_ALIGN);
+        ra->nb_blocks++;
+    }
+
+    ret = pthread_mutex_init(&ra->mutex, NULL);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto fail_blocks;
+    }
+    ret = pthread_cond_init(&ra->cond_worker, NULL);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto fail_mutex;
+    }
+    ret = pthread_cond_init(&ra->cond_reader, NULL);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto fail_cond;
+    }
+
+    *pra = ra;
+
+    for (int i = 0; i < FFMIN(nb_blocks, READAHEAD_MAX_THREADS); i++) {
+        ret = pthread_create(&ra->threads[i], NULL, readahead_worker, ra);
+        if (ret) {
+            av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            readahead_free(pra);
+            return AVERROR(ret);
+        }
+        ra->nb_threads++;
+    }
+
+    return 0;
+
+fail_cond:
+    pthread_cond_destroy(&ra->cond_worker);
+fail_mutex:
+    pthread_mutex_destroy(&ra->mutex);
+fail_blocks:
+    for (int i = 0; i < ra->nb_blocks; i++)
+        av_free(ra->blocks[i].buf);
+    av_free(ra->blocks);
+    av_free(ra);
+    return ret;
+}
+#endif /* HAVE_READAHEAD */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_READAHEAD
+    if (c->ra)
+        return readahead_read(c->ra, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -223,7 +580,12 @@ static int fd_dup(URLContext *h, int oldfd)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
+    int ret;
+#if HAVE_READAHEAD
+    readahead_free(&c->ra);
+#endif
+    av_buffer_unref(&c->map);
+    ret = close(c->fd);
     return (ret == -1) ? AVERROR(errno) : 0;
 }
 
@@ -239,6 +601,11 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if HAVE_READAHEAD
+    if (c->ra)
+        return readahead_seek(c->ra, pos, whence);
+#endif
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -246,6 +613,103 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 
 #if CONFIG_FILE_PROTOCOL
 
+/* Packets smaller than this are cheaper to copy than to map. */
+#define MAP_MIN_SIZE (64 * 1024)
+
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    size_t *size = opaque;
+    munmap(data, *size);
+    av_free(size);
+}
+
+static int file_map_init(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    int64_t page = sysconf(_SC_PAGESIZE);
+    size_t *map_size;
+    uint8_t *ptr;
+
+    if (page <= 0 || FFALIGN(c->map_size, page) > SIZE_MAX)
+        return AVERROR(ENOSYS);
+
+    map_size = av_malloc(sizeof(*map_size));
+    if (!map_size)
+        return AVERROR(ENOMEM);
+    *map_size = FFALIGN(c->map_size, page);
+
+    /* Mapped privately and writable, so that demuxers modifying their
+     * packets in place only ever touch their own copy of the pages. The
+     * buffer is still flagged read-only, so that av_packet_make_writable()
+     * and similar functions make a copy instead. */
+    ptr = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, 0);
+    if (ptr == MAP_FAILED) {
+        av_free(map_size);
+        return AVERROR(ENOSYS);
+    }
+
+    c->map = av_buffer_create(ptr, *map_size, file_unmap, map_size,
+                              AV_BUFFER_FLAG_READONLY);
+    if (!c->map) {
+        munmap(ptr, *map_size);
+        av_free(map_size);
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+#endif
+
+static int file_map(URLContext *h, int64_t pos, int size,
+                    AVBufferRef **buf, uint8_t **data)
+{
+#if HAVE_MMAP
+    FileContext *c = h->priv_data;
+    int64_t page = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    int ret;
+
+    if (size < MAP_MIN_SIZE || page <= 0 || pos < 0 ||
+        pos + size > c->map_size)
+        return AVERROR(ENOSYS);
+
+    /* The padding must lie within the mapped pages, i.e. at the end of the
+     * file within its last page, which the system fills with zeros;
+     * accessing the following pages would raise SIGBUS. */
+    if (pos + size + AV_INPUT_BUFFER_PADDING_SIZE > FFALIGN(c->map_size, page))
+        return AVERROR(ENOSYS);
+
+    /* Accessing the pages past the end of a truncated file raises SIGBUS,
+     * so stop mapping packets as soon as the file changes. */
+    if (fstat(c->fd, &st) < 0 ||
+        st.st_size != c->map_size || st.st_mtime != c->map_mtime) {
+        av_log(h, AV_LOG_WARNING,
+               "File changed while it was mapped, copying packets instead\n");
+        c->map_size = 0;
+        av_buffer_unref(&c->map);
+        return AVERROR(ENOSYS);
+    }
+
+    if (!c->map) {
+        ret = file_map_init(h);
+        if (ret < 0) {
+            c->map_size = 0;
+            return ret;
+        }
+    }
+
+    *buf = av_buffer_ref(c->map);
+    if (!*buf)
+        return AVERROR(ENOMEM);
+    *data = c->map->data + pos;
+
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
 static int file_delete(URLContext *h)
 {
 #if HAVE_UNISTD_H
@@ -287,7 +751,7 @@ static int file_open(URLContext *h, const char *filename, int flags)
     FileContext *c = h->priv_data;
     int access;
     int fd;
-    struct stat st;
+    struct stat st = { 0 };
 
     av_strstart(filename, "file:", &filename);
 
@@ -301,17 +765,53 @@ static int file_open(URLContext *h, const char *filename, int flags)
             access |= O_TRUNC;
     } else {
         access = O_RDONLY;
+#if HAVE_READAHEAD && defined(O_DIRECT)
+        if (c->readahead && c->direct)
+            access |= O_DIRECT;
+#endif
     }
 #ifdef O_BINARY
     access |= O_BINARY;
 #endif
     fd = avpriv_open(filename, access, 0666);
+#if HAVE_READAHEAD && defined(O_DIRECT)
+    if (fd == -1 && errno == EINVAL && (access & O_DIRECT)) {
+        /* e.g. tmpfs does not support O_DIRECT */
+        av_log(h, AV_LOG_WARNING, "Direct I/O is not supported for this file\n");
+        fd = avpriv_open(filename, access & ~O_DIRECT, 0666);
+    }
+#endif
     if (fd == -1)
         return AVERROR(errno);
     c->fd = fd;
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+    if (c->mmap && !(flags & AVIO_FLAG_WRITE) && !c->follow &&
+        S_ISREG(st.st_mode)) {
+#if HAVE_MMAP
+        c->map_size  = st.st_size;
+        c->map_mtime = st.st_mtime;
+#else
+        av_log(h, AV_LOG_WARNING, "Memory mapping is not supported in this build\n");
+#endif
+    }
+
+    if (c->readahead && !(flags & AVIO_FLAG_WRITE)) {
+#if HAVE_READAHEAD
+        if (!c->follow && S_ISREG(st.st_mode)) {
+            int ret = readahead_alloc(h, &c->ra, fd, c->readahead,
+                                      c->readahead_size, st.st_size);
+            if (ret < 0) {
+                close(fd);
+                return ret;
+            }
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "Readahead is not supported in this build\n");
+#endif
+    }
+
     if (c->pkt_size) {
         h->max_packet_size = c->pkt_size;
     } else {
@@ -423,6 +923,7 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+    .url_map             = file_map,
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
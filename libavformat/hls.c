@@ -38,12 +38,14 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "demux.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "id3v2.h"
+#include "prefetch.h"
 #include "url.h"
 
 #include "hls_sample_encryption.h"
@@ -143,6 +145,9 @@ struct playlist {
 
     char key_url[MAX_URL_SIZE];
     uint8_t key[16];
+    /* key of the segment being read, pls->key may already hold the key of a
+     * later segment when prefetching */
+    uint8_t cur_key[16];
 
     /* ID3 timestamp handling (elementary audio streams have ID3 timestamps
      * (and possibly other ID3 tags) in the beginning of each segment) */
@@ -174,6 +179,11 @@ struct playlist {
     int n_init_sections;
     struct segment **init_sections;
     int is_subtitle; /* Indicates if it's a subtitle playlist */
+
+    /* Segments downloaded in the background, if prefetching is enabled,
+     * and the one currently read from */
+    FFPrefetch *prefetch;
+    FFPrefetchSlot *cur_slot;
 };
 
 /*
@@ -231,6 +241,8 @@ typedef struct HLSContext {
     int http_multiple;
     int http_seekable;
     int seg_max_retry;
+    int prefetch_segments;
+    int64_t prefetch_max_size;
     AVIOContext *playlist_pb;
     HLSCryptoContext  crypto_ctx;
 } HLSContext;
@@ -735,6 +747,87 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     return ret;
 }
 
+/* Seek to the requested position. If this was a HTTP request, the offset
+ * should already be where want it to, but this allows e.g. local testing
+ * without a HTTP server.
+ *
+ * This is not done for HTTP at all as avio_seek() does internal bookkeeping
+ * of file offset which is out-of-sync with the actual offset when "offset"
+ * AVOption is used with http protocol, causing the seek to not be a no-op
+ * as would be expected. Wrong offset received from the server will not be
+ * noticed without the call, though.
+ */
+static int seek_to_url_offset(AVFormatContext *s, AVIOContext **in,
+                              const char *url, int64_t url_offset)
+{
+    int64_t seekret = avio_seek(*in, url_offset, SEEK_SET);
+    if (seekret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", url_offset, url);
+        ff_format_io_close(s, in);
+        return seekret;
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+/*
+ * Background segment prefetching.
+ *
+ * Each playlist owns a small pool of threads that download the segments
+ * following the current one, see prefetch.h. The demuxer thread builds the
+ * segment requests (reading the keys if needed, so that AES-128 segments
+ * are decrypted by the crypto protocol in the fetching threads).
+ */
+
+static int prefetch_open_url(AVFormatContext *s, AVIOContext **pb,
+                             FFPrefetchSlot *slot)
+{
+    int is_http = 0;
+    int ret;
+
+    if (*pb && !slot->keepalive)
+        ff_format_io_close(s, pb);
+    ret = open_url(s, pb, slot->url, &slot->avio_opts, slot->opts, &is_http);
+    if (ret >= 0 && !is_http && slot->url_offset)
+        ret = seek_to_url_offset(s, pb, slot->url, slot->url_offset);
+
+    return ret;
+}
+
+static int prefetch_alloc(struct playlist *pls, int nb_segments)
+{
+    /* the key of each segment is kept with it */
+    return ff_prefetch_alloc(&pls->prefetch, pls->parent, nb_segments,
+                             nb_segments, sizeof(pls->key), "hls-prefetch",
+                             prefetch_open_url);
+}
+
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size)
+{
+    return ff_prefetch_read(pls->prefetch, pls->cur_slot, &pls->cur_seg_offset,
+                            buf, buf_size);
+}
+#endif /* HAVE_THREADS */
+
+static void prefetch_free(struct playlist *pls)
+{
+    ff_prefetch_free(&pls->prefetch);
+    pls->cur_slot = NULL;
+}
+
+/* Drop all the prefetched segments, e.g. after a seek. */
+static void prefetch_reset(struct playlist *pls)
+{
+#if HAVE_THREADS
+    HLSContext *c = pls->parent->priv_data;
+
+    if (pls->prefetch)
+        ff_prefetch_flush(pls->prefetch, ff_prefetch_slots(pls->prefetch),
+                          c->prefetch_segments);
+#endif
+    pls->cur_slot = NULL;
+}
+
 static int test_segment(AVFormatContext *s, const AVInputFormat *in_fmt, struct playlist *pls, struct segment *seg)
 {
     HLSContext *c = s->priv_data;
@@ -1135,6 +1228,11 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
 {
     int ret;
 
+#if HAVE_THREADS
+    if (pls->cur_slot)
+        return prefetch_read(pls, buf, buf_size);
+#endif
+
      /* limit read if the segment was only a part of a file */
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
@@ -1378,20 +1476,21 @@ static int read_key(HLSContext *c, struct playlist *pls, struct segment *seg)
     return 0;
 }
 
-static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
+/* Build the URL and the protocol options used to fetch a segment, reading
+ * its key first if needed. */
+static int prepare_input(HLSContext *c, struct playlist *pls, struct segment *seg,
+                         char *url, size_t url_size, AVDictionary **opts)
 {
-    AVDictionary *opts = NULL;
     int ret;
-    int is_http = 0;
 
     if (c->http_persistent)
-        av_dict_set(&opts, "multiple_requests", "1", 0);
+        av_dict_set(opts, "multiple_requests", "1", 0);
 
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
          * (if this is in fact a HTTP request) */
-        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
-        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+        av_dict_set_int(opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(opts, "end_offset", seg->url_offset + seg->size, 0);
     }
 
     av_log(pls->parent, AV_LOG_VERBOSE, "HLS request for url '%s', offset %"PRId64", playlist %d\n",
@@ -1401,50 +1500,48 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
         if (strcmp(seg->key, pls->key_url)) {
             ret = read_key(c, pls, seg);
             if (ret < 0)
-                goto cleanup;
+                return ret;
         }
     }
 
     if (seg->key_type == KEY_AES_128) {
-        char iv[33], key[33], url[MAX_URL_SIZE];
+        char iv[33], key[33];
         ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
         ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
         if (strstr(seg->url, "://"))
-            snprintf(url, sizeof(url), "crypto+%s", seg->url);
+            snprintf(url, url_size, "crypto+%s", seg->url);
         else
-            snprintf(url, sizeof(url), "crypto:%s", seg->url);
-
-        av_dict_set(&opts, "key", key, 0);
-        av_dict_set(&opts, "iv", iv, 0);
+            snprintf(url, url_size, "crypto:%s", seg->url);
 
-        ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http);
-        if (ret < 0) {
-            goto cleanup;
-        }
-        ret = 0;
+        av_dict_set(opts, "key", key, 0);
+        av_dict_set(opts, "iv", iv, 0);
     } else {
-        ret = open_url(pls->parent, in, seg->url, &c->avio_opts, opts, &is_http);
-    }
-
-    /* Seek to the requested position. If this was a HTTP request, the offset
-     * should already be where want it to, but this allows e.g. local testing
-     * without a HTTP server.
-     *
-     * This is not done for HTTP at all as avio_seek() does internal bookkeeping
-     * of file offset which is out-of-sync with the actual offset when "offset"
-     * AVOption is used with http protocol, causing the seek to not be a no-op
-     * as would be expected. Wrong offset received from the server will not be
-     * noticed without the call, though.
-     */
-    if (ret == 0 && !is_http && seg->url_offset) {
-        int64_t seekret = avio_seek(*in, seg->url_offset, SEEK_SET);
-        if (seekret < 0) {
-            av_log(pls->parent, AV_LOG_ERROR, "Unable to seek to offset %"PRId64" of HLS segment '%s'\n", seg->url_offset, seg->url);
-            ret = seekret;
-            ff_format_io_close(pls->parent, in);
-        }
+        av_strlcpy(url, seg->url, url_size);
     }
 
+    return 0;
+}
+
+static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
+{
+    AVDictionary *opts = NULL;
+    char url[MAX_URL_SIZE];
+    int ret;
+    int is_http = 0;
+
+    ret = prepare_input(c, pls, seg, url, sizeof(url), &opts);
+    if (ret < 0)
+        goto cleanup;
+    memcpy(pls->cur_key, pls->key, sizeof(pls->key));
+
+    ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http);
+    if (ret < 0)
+        goto cleanup;
+    ret = 0;
+
+    if (!is_http && seg->url_offset)
+        ret = seek_to_url_offset(pls->parent, in, seg->url, seg->url_offset);
+
 cleanup:
     av_dict_free(&opts);
     pls->cur_seg_offset = 0;
@@ -1753,6 +1850,160 @@ restart:
     goto restart;
 }
 
+#if HAVE_THREADS
+/* Release the slots outside of the prefetch window and queue the segments
+ * of the window that are not fetched yet. */
+static int prefetch_schedule(void *opaque)
+{
+    struct playlist *pls = opaque;
+    HLSContext *c = pls->parent->priv_data;
+    FFPrefetch *pf = pls->prefetch;
+    FFPrefetchSlot *slots = ff_prefetch_slots(pf);
+    int nb_slots = c->prefetch_segments;
+    int64_t end = FFMIN(pls->cur_seq_no + nb_slots,
+                        pls->start_seq_no + pls->n_segments);
+
+    ff_prefetch_release(pf, slots, nb_slots, pls->cur_seq_no, end);
+
+    for (int64_t seq_no = pls->cur_seq_no; seq_no < end; seq_no++) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        FFPrefetchSlot *slot;
+        AVDictionary *opts = NULL;
+        char url[MAX_URL_SIZE];
+        int ret;
+
+        /* the current segment is always fetched, the following ones only
+         * while the memory limit is not reached */
+        if (ff_prefetch_get_slot(pf, slots, nb_slots, seq_no,
+                                 seq_no == pls->cur_seq_no ? INT64_MAX :
+                                                             c->prefetch_max_size,
+                                 &slot))
+            continue;
+        if (!slot)
+            break;
+
+        /* empty slots are only used by this thread, no need for locking */
+        ret = prepare_input(c, pls, seg, url, sizeof(url), &opts);
+        if (ret >= 0) {
+            slot->url = av_strdup(url);
+            ret = slot->url ? av_dict_copy(&slot->avio_opts, c->avio_opts, 0) :
+                              AVERROR(ENOMEM);
+        }
+        if (ret < 0) {
+            av_dict_free(&opts);
+            av_freep(&slot->url);
+            av_dict_free(&slot->avio_opts);
+            /* retried once it is the current segment */
+            return seq_no == pls->cur_seq_no ? ret : 0;
+        }
+        slot->seq_no     = seq_no;
+        slot->opts       = opts;
+        slot->url_offset = seg->url_offset;
+        slot->size       = seg->size;
+        memcpy(slot->priv, pls->key, sizeof(pls->key));
+        slot->keepalive  = c->http_persistent && seg->key_type == KEY_NONE &&
+                           av_strstart(seg->url, "http", NULL);
+
+        ff_prefetch_queue(pf, slot);
+    }
+
+    return 0;
+}
+
+/* Wait for the current segment to start arriving. */
+static int prefetch_open(struct playlist *pls)
+{
+    HLSContext *c = pls->parent->priv_data;
+    FFPrefetchSlot *slot;
+    int ret;
+
+    ret = ff_prefetch_open(pls->prefetch, ff_prefetch_slots(pls->prefetch),
+                           c->prefetch_segments, pls->cur_seq_no,
+                           prefetch_schedule, pls, &slot);
+    if (ret < 0)
+        return ret;
+
+    pls->cur_slot       = slot;
+    pls->cur_seg_offset = 0;
+    memcpy(pls->cur_key, slot->priv, sizeof(pls->cur_key));
+
+    return 0;
+}
+
+static int read_data_prefetch(void *opaque, uint8_t *buf, int buf_size)
+{
+    struct playlist *v = opaque;
+    HLSContext *c = v->parent->priv_data;
+    int ret;
+    int just_opened = 0;
+    int segment_retries = 0;
+    struct segment *seg;
+
+restart:
+    if (!v->cur_slot) {
+        ret = reload_playlist(v, c);
+        if (ret < 0)
+            return ret;
+
+        /* load/update Media Initialization Section, if any */
+        ret = update_init_section(v, current_segment(v));
+        if (ret)
+            return ret;
+
+        ret = prefetch_open(v);
+        if (ret < 0) {
+            if (ret == AVERROR_EXIT || ff_check_interrupt(c->interrupt_callback))
+                return AVERROR_EXIT;
+            av_log(v->parent, AV_LOG_WARNING, "Failed to open segment %"PRId64" of playlist %d\n",
+                   v->cur_seq_no,
+                   v->index);
+            if (segment_retries >= c->seg_max_retry) {
+                av_log(v->parent, AV_LOG_WARNING, "Segment %"PRId64" of playlist %d failed too many times, skipping\n",
+                       v->cur_seq_no,
+                       v->index);
+                v->cur_seq_no++;
+                segment_retries = 0;
+            } else {
+                segment_retries++;
+            }
+            goto restart;
+        }
+        segment_retries = 0;
+        just_opened = 1;
+    }
+
+    if (v->init_sec_buf_read_offset < v->init_sec_data_len) {
+        /* Push init section out first before first actual segment */
+        int copy_size = FFMIN(v->init_sec_data_len - v->init_sec_buf_read_offset, buf_size);
+        memcpy(buf, v->init_sec_buf, copy_size);
+        v->init_sec_buf_read_offset += copy_size;
+        return copy_size;
+    }
+
+    seg = current_segment(v);
+    ret = read_from_url(v, seg, buf, buf_size);
+    if (ret > 0) {
+        if (just_opened && v->is_id3_timestamped != 0) {
+            /* Intercept ID3 tags here, elementary audio streams are required
+             * to convey timestamps using them in the beginning of each segment. */
+            intercept_id3(v, buf, buf_size, &ret);
+        }
+
+        return ret;
+    }
+    if (ret == AVERROR_EXIT)
+        return ret;
+
+    ff_prefetch_close(v->prefetch, v->cur_slot);
+    v->cur_slot = NULL;
+    v->cur_seq_no++;
+
+    c->cur_seq_no = v->cur_seq_no;
+
+    goto restart;
+}
+#endif /* HAVE_THREADS */
+
 static int read_data_subtitle_segment(void *opaque, uint8_t *buf, int buf_size)
 {
     struct playlist *v = opaque;
@@ -2118,6 +2369,8 @@ static int hls_close(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
 
+    for (int i = 0; i < c->n_playlists; i++)
+        prefetch_free(c->playlists[i]);
     free_playlist_list(c);
     free_variant_list(c);
     free_rendition_list(c);
@@ -2144,6 +2397,16 @@ static int hls_read_header(AVFormatContext *s)
     c->first_timestamp = AV_NOPTS_VALUE;
     c->cur_timestamp = AV_NOPTS_VALUE;
 
+    if (!HAVE_THREADS && c->prefetch_segments) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching requires threads, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+    if (c->prefetch_segments && !ff_format_io_is_default(s)) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching calls the I/O callbacks "
+               "from several threads, disabling it with custom ones\n");
+        c->prefetch_segments = 0;
+    }
+
     if ((ret = ffio_copy_url_options(s->pb, &c->avio_opts)) < 0)
         return ret;
 
@@ -2264,12 +2527,24 @@ static int hls_read_header(AVFormatContext *s)
             return AVERROR(ENOMEM);
         }
 
-        if (pls->is_subtitle)
+        if (pls->is_subtitle) {
             ffio_init_context(&pls->pb, (unsigned char*)av_strdup("WEBVTT\n"), (int)strlen("WEBVTT\n"), 0, pls,
                                        NULL, NULL, NULL);
-        else
+#if HAVE_THREADS
+        } else if (c->prefetch_segments) {
+            ret = prefetch_alloc(pls, c->prefetch_segments);
+            if (ret < 0) {
+                avformat_free_context(pls->ctx);
+                pls->ctx = NULL;
+                return ret;
+            }
+            ffio_init_context(&pls->pb, pls->read_buffer, INITIAL_BUFFER_SIZE, 0, pls,
+                                        read_data_prefetch, NULL, NULL);
+#endif
+        } else {
             ffio_init_context(&pls->pb, pls->read_buffer, INITIAL_BUFFER_SIZE, 0, pls,
                                         read_data_continuous, NULL, NULL);
+        }
 
         /*
          * If encryption scheme is SAMPLE-AES, try to read  ID3 tags of
@@ -2295,6 +2570,7 @@ static int hls_read_header(AVFormatContext *s)
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next = NULL;
             pls->input_next_requested = 0;
+            prefetch_reset(pls);
             pls->cur_seg_offset = 0;
             pls->cur_init_section = NULL;
             /* Reset EOF flag */
@@ -2347,7 +2623,7 @@ static int hls_read_header(AVFormatContext *s)
         if (seg && seg->key_type == KEY_SAMPLE_AES) {
             if (strstr(in_fmt->name, "mov")) {
                 char key[33];
-                ff_data_to_hex(key, pls->key, sizeof(pls->key), 0);
+                ff_data_to_hex(key, pls->cur_key, sizeof(pls->cur_key), 0);
                 av_dict_set(&options, "decryption_key", key, 0);
             } else if (!c->crypto_ctx.aes_ctx) {
                 c->crypto_ctx.aes_ctx = av_aes_alloc();
@@ -2464,6 +2740,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            prefetch_reset(pls);
             if (pls->is_subtitle)
                 avformat_close_input(&pls->ctx);
             pls->needed = 0;
@@ -2558,7 +2835,7 @@ static int hls_read_packet(AVFormatContext *s, AVPacket *pkt)
                 if (seg && seg->key_type == KEY_SAMPLE_AES && !strstr(pls->ctx->iformat->name, "mov")) {
                     enum AVCodecID codec_id = pls->ctx->streams[pls->pkt->stream_index]->codecpar->codec_id;
                     memcpy(c->crypto_ctx.iv, seg->iv, sizeof(seg->iv));
-                    memcpy(c->crypto_ctx.key, pls->key, sizeof(pls->key));
+                    memcpy(c->crypto_ctx.key, pls->cur_key, sizeof(pls->cur_key));
                     ff_hls_senc_decrypt_frame(codec_id, &c->crypto_ctx, pls->pkt);
                 }
 
@@ -2725,6 +3002,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        prefetch_reset(pls);
         av_packet_unref(pls->pkt);
         pb->eof_reached = 0;
         /* Clear any buffered data */
@@ -2835,6 +3113,10 @@ static const AVOption hls_options[] = {
         OFFSET(seg_format_opts), AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, FLAGS},
     {"seg_max_retry", "Maximum number of times to reload a segment on error.",
      OFFSET(seg_max_retry), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS},
+    {"prefetch_segments", "Number of segments downloaded in parallel ahead of the current one",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 16, FLAGS},
+    {"prefetch_max_size", "Maximum amount of prefetched segment data held in memory",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 64 << 20}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
@@ -39,6 +39,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 
 #include "avformat.h"
 #include "http.h"
@@ -61,6 +62,8 @@
 #define HTTP_SINGLE   1
 #define HTTP_MUTLI    2
 #define MAX_DATE_LEN  19
+#define POOL_SIZE     16
+#define POOL_IDLE_TIMEOUT (30 * 1000000)
 #define WHITESPACES " \n\t\r"
 typedef enum {
     LOWER_PROTO,
@@ -69,9 +72,24 @@ typedef enum {
     FINISH
 }HandshakeState;
 
+/* A connection that can be handed over between HTTPContexts through the
+ * connection pool. */
+typedef struct HTTPPoolConn {
+    /* Set only while the connection is idle in the pool. */
+    URLContext *hd;
+    /* Interrupt callback of the current owner; the lower protocol is opened
+     * with a callback forwarding to it, since the owner may not outlive the
+     * connection. */
+    AVIOInterruptCB int_cb;
+    char *key;
+    int64_t last_used;
+} HTTPPoolConn;
+
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
+    /* Non-NULL if hd may be returned to the connection pool. */
+    HTTPPoolConn *conn;
     unsigned char buffer[BUFFER_SIZE], *buf_ptr, *buf_end;
     int line_count;
     int http_code;
@@ -148,8 +166,10 @@ typedef struct HTTPContext {
     int reconnect_delay_total_max;
     uint64_t initial_request_size;
     int partial_requests; /* whether or not to limit requests to initial_request_size */
+    int connection_pool;
     /* Connection statistics */
     int nb_connections;
+    int nb_reused;
     int nb_requests;
     int nb_retries;
     int nb_reconnects;
@@ -202,6 +222,7 @@ static const AVOption options[] = {
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
     { "short_seek_size", "Threshold to favor readahead over seek.", OFFSET(short_seek_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, D },
+    { "connection_pool", "share idle persistent connections between HTTP contexts", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D | E },
     { NULL }
 };
 
@@ -211,6 +232,224 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
 static int http_read_header(URLContext *h);
 static int http_shutdown(URLContext *h, int flags);
 
+static AVMutex pool_mutex = AV_MUTEX_INITIALIZER;
+static HTTPPoolConn *pool[POOL_SIZE];
+static int pool_nb;
+
+static int pool_interrupt_cb(void *opaque)
+{
+    HTTPPoolConn *conn = opaque;
+    return ff_check_interrupt(&conn->int_cb);
+}
+
+static void pool_conn_free(HTTPPoolConn **pconn)
+{
+    HTTPPoolConn *conn = *pconn;
+
+    if (!conn)
+        return;
+    ffurl_closep(&conn->hd);
+    av_freep(&conn->key);
+    av_freep(pconn);
+}
+
+static void http_close_connection(HTTPContext *s)
+{
+    ffurl_closep(&s->hd);
+    pool_conn_free(&s->conn);
+}
+
+/**
+ * Build the pool key of a lower protocol connection: its URL, the protocols
+ * allowed to open it and all options passed on to it. Options of the HTTP
+ * protocol itself are left out (except the proxy, which the TLS protocol
+ * uses), so that e.g. requests for different byte ranges can share
+ * connections.
+ */
+static char *pool_key(URLContext *h, const char *lower_url, const AVDictionary *options)
+{
+    HTTPContext *s = h->priv_data;
+    const AVDictionaryEntry *e = NULL;
+    AVBPrint key;
+    char *str;
+
+    av_bprint_init(&key, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&key, "%s\nprotocol_whitelist=%s\nprotocol_blacklist=%s", lower_url,
+               h->protocol_whitelist ? h->protocol_whitelist : "",
+               h->protocol_blacklist ? h->protocol_blacklist : "");
+    while ((e = av_dict_iterate(options, e))) {
+        if (strcmp(e->key, "http_proxy") && av_opt_find(s, e->key, NULL, 0, 0))
+            continue;
+        av_bprintf(&key, "\n%s=%s", e->key, e->value);
+    }
+    if (!av_bprint_is_complete(&key)) {
+        av_bprint_finalize(&key, NULL);
+        return NULL;
+    }
+    if (av_bprint_finalize(&key, &str) < 0)
+        return NULL;
+    return str;
+}
+
+/* Check that an idle connection has neither been closed by the server nor
+ * received unexpected data. */
+static int pool_conn_alive(HTTPPoolConn *conn)
+{
+    struct pollfd p = { .fd = ffurl_get_file_handle(conn->hd), .events = POLLIN };
+
+    if (p.fd < 0)
+        return 0;
+    return poll(&p, 1, 0) == 0;
+}
+
+/**
+ * Remove from the pool the connections matching key if non-NULL (at most
+ * one, returned in *conn) and the ones idle for too long (returned in
+ * expired, to be closed without holding the mutex).
+ * Must be called with the mutex held.
+ *
+ * @return the number of expired connections
+ */
+static int pool_take(const char *key, int64_t now, HTTPPoolConn **conn,
+                     HTTPPoolConn **expired)
+{
+    int nb_expired = 0;
+
+    for (int i = pool_nb - 1; i >= 0; i--) {
+        HTTPPoolConn *c = pool[i];
+        int take = key && !*conn && !strcmp(c->key, key);
+
+        if (!take && now - c->last_used <= POOL_IDLE_TIMEOUT)
+            continue;
+        if (take)
+            *conn = c;
+        else
+            expired[nb_expired++] = c;
+        memmove(&pool[i], &pool[i + 1], (pool_nb - i - 1) * sizeof(*pool));
+        pool_nb--;
+    }
+    return nb_expired;
+}
+
+static HTTPPoolConn *pool_get(const char *key)
+{
+    HTTPPoolConn *conn = NULL, *expired[POOL_SIZE];
+    int64_t now = av_gettime_relative();
+    int nb_expired;
+
+    ff_mutex_lock(&pool_mutex);
+    nb_expired = pool_take(key, now, &conn, expired);
+    ff_mutex_unlock(&pool_mutex);
+
+    while (nb_expired)
+        pool_conn_free(&expired[--nb_expired]);
+    if (conn && (now - conn->last_used > POOL_IDLE_TIMEOUT || !pool_conn_alive(conn)))
+        pool_conn_free(&conn);
+    return conn;
+}
+
+static void pool_put(HTTPPoolConn *conn)
+{
+    HTTPPoolConn *unused = NULL, *expired[POOL_SIZE + 1];
+    int nb_expired;
+
+    conn->last_used = av_gettime_relative();
+    conn->int_cb    = (AVIOInterruptCB){ NULL };
+
+    ff_mutex_lock(&pool_mutex);
+    nb_expired = pool_take(NULL, conn->last_used, &unused, expired);
+    if (pool_nb == POOL_SIZE) {
+        expired[nb_expired++] = pool[0];
+        memmove(&pool[0], &pool[1], (POOL_SIZE - 1) * sizeof(*pool));
+        pool_nb--;
+    }
+    pool[pool_nb++] = conn;
+    ff_mutex_unlock(&pool_mutex);
+
+    while (nb_expired)
+        pool_conn_free(&expired[--nb_expired]);
+}
+
+void ff_http_pool_close(void)
+{
+    HTTPPoolConn *conns[POOL_SIZE];
+    int nb;
+
+    ff_mutex_lock(&pool_mutex);
+    nb = pool_nb;
+    memcpy(conns, pool, nb * sizeof(*pool));
+    pool_nb = 0;
+    ff_mutex_unlock(&pool_mutex);
+
+    while (nb)
+        pool_conn_free(&conns[--nb]);
+}
+
+/**
+ * Open the lower protocol connection, taking an idle one from the pool if
+ * possible and allowed by try_pool.
+ *
+ * @return 1 if a pooled connection is used, 0 if a new one has been opened,
+ *         negative AVERROR on failure
+ */
+static int http_open_lower(URLContext *h, const char *lower_url,
+                           AVDictionary **options, int try_pool)
+{
+    HTTPContext *s = h->priv_data;
+    const AVIOInterruptCB *int_cb = &h->interrupt_callback;
+    AVIOInterruptCB pool_int_cb;
+    int err;
+
+    if (s->connection_pool) {
+        char *key = pool_key(h, lower_url, *options);
+        if (!key)
+            return AVERROR(ENOMEM);
+
+        if (try_pool)
+            s->conn = pool_get(key);
+        if (s->conn) {
+            av_free(key);
+            s->conn->int_cb = h->interrupt_callback;
+            s->hd = s->conn->hd;
+            s->conn->hd = NULL;
+            s->nb_reused++;
+            av_log(h, AV_LOG_DEBUG, "Reusing pooled connection to %s\n", lower_url);
+            return 1;
+        }
+
+        s->conn = av_mallocz(sizeof(*s->conn));
+        if (!s->conn) {
+            av_free(key);
+            return AVERROR(ENOMEM);
+        }
+        s->conn->key    = key;
+        s->conn->int_cb = h->interrupt_callback;
+        pool_int_cb     = (AVIOInterruptCB){ pool_interrupt_cb, s->conn };
+        int_cb          = &pool_int_cb;
+    }
+
+    s->nb_connections++;
+    err = ffurl_open_whitelist(&s->hd, lower_url, AVIO_FLAG_READ_WRITE,
+                               int_cb, options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (err < 0)
+        pool_conn_free(&s->conn);
+    return err < 0 ? err : 0;
+}
+
+/* Return non zero if the last response has been consumed completely and the
+ * connection can be used for another request. */
+static int http_conn_reusable(HTTPContext *s)
+{
+    uint64_t end = s->range_end ? s->range_end : s->filesize;
+
+    if (!s->hd || !s->end_header || s->willclose || s->buf_ptr != s->buf_end)
+        return 0;
+    if (s->chunksize != UINT64_MAX)
+        return s->chunkend;
+    return s->http_code == 204 || s->http_code == 304 || s->off == end;
+}
+
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
 {
     memcpy(&((HTTPContext *)dest->priv_data)->auth_state,
@@ -230,7 +469,8 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE], sanitized_path[MAX_URL_SIZE + 1];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err = 0;
+    int port, use_proxy, err = 0, reused = 0;
+    uint64_t off;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -308,16 +548,30 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        s->nb_connections++;
-        err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
+        err = http_open_lower(h, buf, options, 1);
+        reused = err > 0;
     }
 
 end:
     freeenv_utf8(env_http_proxy);
-    return err < 0 ? err : http_connect(
-        h, path, local_path, hoststr, auth, proxyauth);
+    if (err < 0)
+        return err;
+
+    off = s->off;
+    err = http_connect(h, path, local_path, hoststr, auth, proxyauth);
+    if (reused && (err == AVERROR_EOF || err == AVERROR(ECONNRESET) ||
+                   err == AVERROR(EPIPE))) {
+        /* The server may have closed the idle connection while we were
+         * sending the request, retry once on a new connection. */
+        av_log(h, AV_LOG_DEBUG, "Pooled connection failed, reconnecting\n");
+        http_close_connection(s);
+        s->off = off;
+        err = http_open_lower(h, buf, options, 0);
+        if (err < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr, auth, proxyauth);
+    }
+    return err;
 }
 
 static int http_should_reconnect(HTTPContext *s, int err)
@@ -454,7 +708,7 @@ redo:
         /* restore the offset (http_connect resets it) */
         s->off = off;
 
-        ffurl_closep(&s->hd);
+        http_close_connection(s);
         goto redo;
     }
 
@@ -462,7 +716,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && auth_attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_connection(s);
             goto redo;
         } else
             goto fail;
@@ -470,7 +724,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && auth_attempts < 4) {
-            ffurl_closep(&s->hd);
+            http_close_connection(s);
             goto redo;
         } else
             goto fail;
@@ -479,7 +733,7 @@ redo:
          s->http_code == 303 || s->http_code == 307 || s->http_code == 308) &&
         s->new_location) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        http_close_connection(s);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
 
@@ -505,8 +759,7 @@ redo:
     return 0;
 
 fail:
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    http_close_connection(s);
     if (ret < 0)
         return ret;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -783,6 +1036,10 @@ static int http_open(URLContext *h, const char *uri, int flags,
     if (options)
         av_dict_copy(&s->chained_options, *options, 0);
 
+    /* pooled connections must be kept alive */
+    if (s->connection_pool)
+        s->multiple_requests = 1;
+
     if (s->headers) {
         int len = strlen(s->headers);
         if (len < 2 || strcmp("\r\n", s->headers + len - 2)) {
@@ -1720,7 +1977,7 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
             }
             else if (!s->chunksize) {
                 av_log(h, AV_LOG_DEBUG, "Last chunk received, closing conn\n");
-                ffurl_closep(&s->hd);
+                http_close_connection(s);
                 return 0;
             }
             else if (s->chunksize == UINT64_MAX) {
@@ -1834,7 +2091,7 @@ static int http_read_stream(URLContext *h, uint8_t *buf, int size)
             /* send new request for more data on existing connection */
             AVDictionary *options = NULL;
             if (s->willclose)
-                ffurl_closep(&s->hd);
+                http_close_connection(s);
             s->partial_requests = 0; /* continue streaming uninterrupted from now on */
             read_ret = http_open_cnx(h, &options);
             av_dict_free(&options);
@@ -2000,6 +2257,26 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
     return size;
 }
 
+/* Read the reply to an upload and skip its body. */
+static int http_read_reply(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint8_t buf[1024];
+    int ret;
+
+    if ((ret = http_read_header(h)) < 0)
+        return ret;
+    if (s->http_code == 204 || s->http_code == 304)
+        return 0;
+    if (s->chunksize == UINT64_MAX && s->filesize == UINT64_MAX) {
+        /* the body is delimited by the end of the connection */
+        s->willclose = 1;
+        return 0;
+    }
+    while ((ret = http_buf_read(h, buf, sizeof(buf))) > 0);
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
 static int http_shutdown(URLContext *h, int flags)
 {
     int ret = 0;
@@ -2011,8 +2288,11 @@ static int http_shutdown(URLContext *h, int flags)
         ((flags & AVIO_FLAG_READ) && s->chunked_post && s->listen)) {
         ret = ffurl_write(s->hd, footer, sizeof(footer) - 1);
         ret = ret > 0 ? 0 : ret;
-        /* flush the receive buffer when it is write only mode */
-        if (!(flags & AVIO_FLAG_READ)) {
+        /* read the reply to be able to reuse the connection, otherwise
+         * flush the receive buffer when it is write only mode */
+        if (ret >= 0 && s->conn && !(flags & AVIO_FLAG_READ)) {
+            ret = http_read_reply(h);
+        } else if (!(flags & AVIO_FLAG_READ)) {
             char buf[1024];
             int read_ret;
             s->hd->flags |= AVIO_FLAG_NONBLOCK;
@@ -2043,16 +2323,22 @@ static int http_close(URLContext *h)
         /* Close the write direction by sending the end of chunked encoding. */
         ret = http_shutdown(h, h->flags);
 
-    if (s->hd)
-        ffurl_closep(&s->hd);
+    if (s->conn && ret >= 0 && http_conn_reusable(s)) {
+        s->conn->hd = s->hd;
+        s->hd = NULL;
+        pool_put(s->conn);
+        s->conn = NULL;
+    }
+    http_close_connection(s);
     av_dict_free(&s->chained_options);
     av_dict_free(&s->cookie_dict);
     av_dict_free(&s->redirect_cache);
     av_freep(&s->new_location);
     av_freep(&s->uri);
 
-    av_log(h, AV_LOG_DEBUG, "Statistics: %d connection%s, %d request%s, %d retr%s, %d reconnection%s, %d redirect%s\n",
+    av_log(h, AV_LOG_DEBUG, "Statistics: %d connection%s, %d reused, %d request%s, %d retr%s, %d reconnection%s, %d redirect%s\n",
            s->nb_connections, s->nb_connections == 1 ? ""  : "s",
+           s->nb_reused,
            s->nb_requests,    s->nb_requests    == 1 ? ""  : "s",
            s->nb_retries,     s->nb_retries     == 1 ? "y" : "ies",
            s->nb_reconnects,  s->nb_reconnects  == 1 ? ""  : "s",
@@ -2070,6 +2356,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = NULL;
+    HTTPPoolConn *old_conn = NULL;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -2127,15 +2414,17 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
             int ret = ffurl_read(s->hd, discard, FFMIN(remaining, sizeof(discard)));
             if (ret < 0 || ret == AVERROR_EOF || (ret == 0 && remaining)) {
                 /* connection broken or stuck, need to reopen */
-                ffurl_closep(&s->hd);
+                http_close_connection(s);
                 break;
             }
             remaining -= ret;
         }
     } else {
         /* can't soft seek; always open new connection */
-        old_hd = s->hd;
-        s->hd = NULL;
+        old_hd   = s->hd;
+        old_conn = s->conn;
+        s->hd    = NULL;
+        s->conn  = NULL;
     }
 
     /* if it fails, continue on old connection */
@@ -2145,11 +2434,13 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
         s->hd      = old_hd;
+        s->conn    = old_conn;
         s->off     = old_off;
         return ret;
     }
     av_dict_free(&options);
     ffurl_close(old_hd);
+    pool_conn_free(&old_conn);
     return off;
 }
 
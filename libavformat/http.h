@@ -64,4 +64,10 @@ int ff_http_averror(int status_code, int default_averror);
 
 const char* ff_http_get_new_location(URLContext *h);
 
+/**
+ * Close the idle connections kept in the pool shared by the HTTP contexts
+ * opened with the connection_pool option.
+ */
+void ff_http_pool_close(void);
+
 #endif /* AVFORMAT_HTTP_H */
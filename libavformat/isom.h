@@ -318,6 +318,8 @@ typedef struct HEIFGrid {
     int nb_tiles;
 } HEIFGrid;
 
+#define MOV_INDEX_CACHE_MAX_RFPS 100
+
 typedef struct MOVContext {
     const AVClass *class; ///< class for private options
     AVFormatContext *fc;
@@ -385,6 +387,10 @@ typedef struct MOVContext {
     int nb_heif_grid;
     int64_t idat_offset;
     int interleaved_read;
+    char *index_cache_dir;
+    struct MOVIndexCache *index_cache;
+    int64_t rfps_dts[MOV_INDEX_CACHE_MAX_RFPS];  ///< ff_rfps_add_frame() input recorded for the index cache
+    unsigned nb_rfps_dts;
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -4333,6 +4333,8 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     MatroskaTrack *tracks = NULL;
     AVStream *st = s->streams[stream_index];
     FFStream *const sti = ffstream(st);
+    const AVIndexEntry *ie;
+    int64_t seek_ts;
     int i, index;
 
     /* Parse the CUES now since we need the index data to seek. */
@@ -4341,15 +4343,16 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
         matroska_parse_cues(matroska);
     }
 
-    if (!sti->nb_index_entries)
+    if (!avformat_index_get_entries_count(st))
         goto err;
-    timestamp = FFMAX(timestamp, sti->index_entries[0].timestamp);
+    timestamp = FFMAX(timestamp, avformat_index_get_entry(st, 0)->timestamp);
 
     if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
-         index == sti->nb_index_entries - 1) {
-        matroska_reset_status(matroska, 0, sti->index_entries[sti->nb_index_entries - 1].pos);
+         index == avformat_index_get_entries_count(st) - 1) {
+        ie = avformat_index_get_entry(st, avformat_index_get_entries_count(st) - 1);
+        matroska_reset_status(matroska, 0, ie->pos);
         while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0 ||
-               index == sti->nb_index_entries - 1) {
+               index == avformat_index_get_entries_count(st) - 1) {
             matroska_clear_queue(matroska);
             if (matroska_parse_cluster(matroska) < 0)
                 break;
@@ -4358,7 +4361,7 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
 
     matroska_clear_queue(matroska);
     if (index < 0 || (matroska->cues_parsing_deferred < 0 &&
-                      index == sti->nb_index_entries - 1))
+                      index == avformat_index_get_entries_count(st) - 1))
         goto err;
 
     tracks = matroska->tracks.elem;
@@ -4370,17 +4373,19 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
 
     /* We seek to a level 1 element, so set the appropriate status. */
-    matroska_reset_status(matroska, 0, sti->index_entries[index].pos);
+    ie = avformat_index_get_entry(st, index);
+    seek_ts = ie->timestamp;
+    matroska_reset_status(matroska, 0, ie->pos);
     if (flags & AVSEEK_FLAG_ANY) {
         sti->skip_to_keyframe = 0;
         matroska->skip_to_timecode = timestamp;
     } else {
         sti->skip_to_keyframe = 1;
-        matroska->skip_to_timecode = sti->index_entries[index].timestamp;
+        matroska->skip_to_timecode = seek_ts;
     }
     matroska->skip_to_keyframe = 1;
     matroska->done             = 0;
-    avpriv_update_cur_dts(s, st, sti->index_entries[index].timestamp);
+    avpriv_update_cur_dts(s, st, seek_ts);
     return 0;
 err:
     // slightly hackish but allows proper fallback to
@@ -4861,7 +4866,7 @@ const FFInputFormat ff_matroska_demuxer = {
     .p.extensions   = "mkv,mk3d,mka,mks,webm",
     .p.mime_type    = "audio/webm,audio/x-matroska,video/webm,video/x-matroska",
     .priv_data_size = sizeof(MatroskaDemuxContext),
-    .flags_internal = FF_INFMT_FLAG_INIT_CLEANUP,
+    .flags_internal = FF_INFMT_FLAG_INIT_CLEANUP | FF_INFMT_FLAG_COMPACT_INDEX,
     .read_probe     = matroska_probe,
     .read_header    = matroska_read_header,
     .read_packet    = matroska_read_packet,
@@ -69,6 +69,7 @@
 #include "libavcodec/get_bits.h"
 #include "id3v1.h"
 #include "mov_chan.h"
+#include "mov_index_cache.h"
 #include "replaygain.h"
 
 #if CONFIG_ZLIB
@@ -1599,6 +1600,34 @@ static int mov_read_ftyp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+/* look up the indexes parsed from the moov atom starting at the current
+ * position in the index cache */
+static int mov_index_cache_open(MOVContext *c, AVIOContext *pb, MOVAtom atom)
+{
+    int64_t pos = avio_tell(pb);
+    MOVIndexCache *cache;
+    int ret;
+
+    cache = av_mallocz(sizeof(*cache));
+    if (!cache)
+        return AVERROR(ENOMEM);
+
+    ret = ff_mov_index_cache_key(cache, pb, pos, atom.size,
+                                 c->ignore_editlist | c->advanced_editlist << 1);
+    if (ret < 0) {
+        av_free(cache);
+        if (avio_tell(pb) != pos)
+            return ret;
+        av_log(c->fc, AV_LOG_WARNING, "Could not compute index cache key\n");
+        return 0;
+    }
+
+    ff_mov_index_cache_load(c->fc, cache, c->index_cache_dir);
+    cache->eligible = !cache->hit;
+    c->index_cache = cache;
+    return 0;
+}
+
 /* this atom should contain all header atoms */
 static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
@@ -1610,8 +1639,23 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return 0;
     }
 
+    if (c->index_cache_dir && (pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+        (ret = mov_index_cache_open(c, pb, atom)) < 0)
+        return ret;
+
     if ((ret = mov_read_default(c, pb, atom)) < 0)
         return ret;
+
+    if (c->index_cache) {
+        MOVIndexCache *cache = c->index_cache;
+        if (cache->hit && cache->next_track != cache->nb_tracks)
+            av_log(c->fc, AV_LOG_WARNING, "Index cache entry has %u tracks, "
+                   "%u were used\n", cache->nb_tracks, cache->next_track);
+        if (cache->eligible && !c->trex_count && cache->nb_tracks)
+            ff_mov_index_cache_save(c->fc, cache, c->index_cache_dir);
+        ff_mov_index_cache_free(&c->index_cache);
+    }
+
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
     /* so we don't parse the whole file if over a network */
     c->found_moov=1;
@@ -4861,8 +4905,11 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                     av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
                             "size %u, distance %u, keyframe %d\n", st->index, current_sample,
                             current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sti->nb_index_entries < 100)
+                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && sti->nb_index_entries < 100) {
                         ff_rfps_add_frame(mov->fc, st, current_dts);
+                        if (mov->nb_rfps_dts < FF_ARRAY_ELEMS(mov->rfps_dts))
+                            mov->rfps_dts[mov->nb_rfps_dts++] = current_dts;
+                    }
                 }
 
                 current_offset += sample_size;
@@ -5181,6 +5228,7 @@ static int sanity_checks(void *log_obj, MOVStreamContext *sc, int index)
 
 static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
+    MOVIndexCacheTrack *cached = NULL;
     AVStream *st;
     MOVStreamContext *sc;
     int ret;
@@ -5204,6 +5252,16 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     c->trak_index = -1;
 
+    if (c->index_cache && c->index_cache->hit) {
+        MOVIndexCache *cache = c->index_cache;
+        if (cache->next_track >= cache->nb_tracks) {
+            av_log(c->fc, AV_LOG_ERROR, "Index cache entry does not match the file\n");
+            return AVERROR_INVALIDDATA;
+        }
+        cached = &cache->tracks[cache->next_track++];
+        ff_mov_index_cache_restore_tables(cached, st);
+    }
+
     // Here stsc refers to a chunk not described in stco. This is technically invalid,
     // but we can overlook it (clearing stsc) whenever stts_count == 0 (indicating no samples).
     if (!sc->chunk_count && !sc->stts_count && sc->stsc_count) {
@@ -5211,9 +5269,15 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         av_freep(&sc->stsc_data);
     }
 
-    ret = sanity_checks(c->fc, sc, st->index);
-    if (ret)
-        return ret > 1 ? AVERROR_INVALIDDATA : 0;
+    /* the cached tables passed these checks when the entry was written */
+    if (!cached) {
+        ret = sanity_checks(c->fc, sc, st->index);
+        if (ret) {
+            if (c->index_cache)
+                c->index_cache->eligible = 0;
+            return ret > 1 ? AVERROR_INVALIDDATA : 0;
+        }
+    }
 
     fix_timescale(c, sc);
 
@@ -5232,7 +5296,23 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         c->advanced_editlist_autodisabled = 1;
     }
 
-    mov_build_index(c, st);
+    if (cached) {
+        ff_mov_index_cache_restore_index(cached, st);
+        for (unsigned i = 0; i < cached->nb_rfps_dts; i++)
+            ff_rfps_add_frame(c->fc, st, cached->rfps_dts[i]);
+        mov_estimate_video_delay(c, st);
+    } else {
+        unsigned stts_count = sc->stts_count;
+
+        c->nb_rfps_dts = 0;
+        mov_build_index(c, st);
+
+        if (c->index_cache && c->index_cache->eligible &&
+            (sc->open_key_samples_count || sc->iamf ||
+             ff_mov_index_cache_record(c->index_cache, st, stts_count,
+                                       c->rfps_dts, c->nb_rfps_dts) < 0))
+            c->index_cache->eligible = 0;
+    }
 
 #if CONFIG_IAMFDEC
     if (sc->iamf) {
@@ -9529,6 +9609,22 @@ static const MOVParseTableEntry mov_default_parse_table[] = {
 { 0, NULL }
 };
 
+static int mov_index_cache_skip_atom(uint32_t type)
+{
+    switch (type) {
+    case MKTAG('s','t','t','s'):
+    case MKTAG('c','t','t','s'):
+    case MKTAG('s','t','s','z'):
+    case MKTAG('s','t','z','2'):
+    case MKTAG('s','t','c','o'):
+    case MKTAG('c','o','6','4'):
+    case MKTAG('s','t','s','s'):
+    case MKTAG('s','t','p','s'):
+        return 1;
+    }
+    return 0;
+}
+
 static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     int64_t total_size = 0;
@@ -9598,6 +9694,11 @@ static int mov_read_default(MOVContext *c, AVIOContext *pb, MOVAtom atom)
                 break;
             }
 
+        // sample tables of tracks restored from the index cache
+        if (parse && c->trak_index >= 0 && c->index_cache && c->index_cache->hit &&
+            mov_index_cache_skip_atom(a.type))
+            parse = NULL;
+
         // container is user data
         if (!parse && (atom.type == MKTAG('u','d','t','a') ||
                        atom.type == MKTAG('i','l','s','t')))
@@ -10028,6 +10129,7 @@ static int mov_read_close(AVFormatContext *s)
     }
 
     av_freep(&mov->trex_data);
+    ff_mov_index_cache_free(&mov->index_cache);
     av_freep(&mov->bitrates);
 
     for (i = 0; i < mov->frag_index.nb_items; i++) {
@@ -11630,6 +11732,8 @@ static const AVOption mov_options[] = {
         0, 1, FLAGS},
     {"ignore_editlist", "Ignore the edit list atom.", OFFSET(ignore_editlist), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
+    {"index_cache", "Directory of the persistent sample index cache",
+        OFFSET(index_cache_dir), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS},
     {"advanced_editlist",
         "Modify the AVIndex according to the editlists. Use this option to decode in the order specified by the edits.",
         OFFSET(advanced_editlist), AV_OPT_TYPE_BOOL, {.i64 = 1},
@@ -0,0 +1,507 @@
+/*
+ * MOV/MP4 demuxer persistent sample index cache
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * MOV/MP4 demuxer persistent sample index cache.
+ *
+ * An entry is a single file named after the hex cache key. All fields are
+ * little-endian and every record has a fixed size. Entries are read back
+ * sequentially through avio and are only used once every record has been
+ * checked against the demuxed file:
+ *
+ *   header:  "FFMOVIDX", u32 version, u8 key[16], u32 nb_tracks
+ *   track:   scalar fields of MOVIndexCacheTrack (in declaration order),
+ *            u32 nb_rfps,    nb_rfps    x i64 dts
+ *            u32 nb_entries, nb_entries x { i64 pos, i64 timestamp,
+ *                                           u32 size, u32 flags,
+ *                                           i32 min_distance }
+ *            u32 nb_tts,     nb_tts     x { u32 count, u32 duration,
+ *                                           i32 offset }
+ *            u32 nb_ranges,  nb_ranges  x { i64 start, i64 end }
+ *   trailer: "FFMOVEND"
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/md5.h"
+#include "libavutil/random_seed.h"
+
+#include "avio_internal.h"
+#include "internal.h"
+#include "mov_index_cache.h"
+#include "url.h"
+#include "version.h"
+
+#define CACHE_VERSION     1
+#define ENTRY_RECORD_SIZE 28
+#define TTS_RECORD_SIZE   12
+#define RANGE_RECORD_SIZE 16
+
+int ff_mov_index_cache_key(MOVIndexCache *cache, AVIOContext *pb,
+                           int64_t moov_pos, int64_t moov_size,
+                           uint32_t flags)
+{
+    struct AVMD5 *md5;
+    uint8_t buf[4096];
+    int64_t left = moov_size;
+    int64_t file_size = avio_size(pb);
+    int ret = 0;
+
+    if (file_size < 0)
+        return file_size;
+    if (!(md5 = av_md5_alloc()))
+        return AVERROR(ENOMEM);
+
+    av_md5_init(md5);
+    AV_WL64(buf,      file_size);
+    AV_WL64(buf +  8, moov_pos);
+    AV_WL64(buf + 16, moov_size);
+    AV_WL32(buf + 24, LIBAVFORMAT_VERSION_INT);
+    AV_WL32(buf + 28, flags);
+    av_md5_update(md5, buf, 32);
+
+    while (left > 0) {
+        int len = avio_read(pb, buf, FFMIN(left, sizeof(buf)));
+        if (len <= 0) {
+            ret = len < 0 ? len : AVERROR_EOF;
+            break;
+        }
+        av_md5_update(md5, buf, len);
+        left -= len;
+    }
+    av_md5_final(md5, cache->key);
+    av_free(md5);
+
+    if (avio_seek(pb, moov_pos, SEEK_SET) < 0 && ret >= 0)
+        ret = AVERROR(EIO);
+    return ret;
+}
+
+static char *cache_path(const MOVIndexCache *cache, const char *dir,
+                        const char *suffix)
+{
+    char name[2 * sizeof(cache->key) + 32];
+    int pos;
+
+    for (pos = 0; pos < sizeof(cache->key); pos++)
+        snprintf(name + 2 * pos, 3, "%02x", cache->key[pos]);
+    av_strlcat(name, suffix, sizeof(name));
+    return av_append_path_component(dir, name);
+}
+
+static void free_track(MOVIndexCacheTrack *t)
+{
+    av_freep(&t->entries);
+    av_freep(&t->tts);
+    av_freep(&t->ranges);
+}
+
+static void free_tracks(MOVIndexCache *cache)
+{
+    for (unsigned i = 0; i < cache->nb_tracks; i++)
+        free_track(&cache->tracks[i]);
+    av_freep(&cache->tracks);
+    cache->nb_tracks = 0;
+}
+
+void ff_mov_index_cache_free(MOVIndexCache **pcache)
+{
+    if (!*pcache)
+        return;
+    free_tracks(*pcache);
+    av_freep(pcache);
+}
+
+#define SCALAR_FIELDS(X) \
+    X(32, stts_count_parsed)   \
+    X(32, chunk_count)         \
+    X(32, sample_count)        \
+    X(32, stts_count)          \
+    X(32, ctts_count)          \
+    X(32, sample_size)         \
+    X(32, stsz_sample_size)    \
+    X(32, keyframe_count)      \
+    X(32, stps_count)          \
+    X(32, keyframe_absent)     \
+    X(32, dts_shift)           \
+    X(32, min_sample_duration) \
+    X(32, nb_frames_for_fps)   \
+    X(32, start_pad)           \
+    X(32, skip_samples)        \
+    X(32, need_parsing)        \
+    X(32, discard)             \
+    X(64, duration_for_fps)    \
+    X(64, track_end)           \
+    X(64, data_size)           \
+    X(64, time_offset)         \
+    X(64, min_corrected_pts)   \
+    X(64, nb_frames)           \
+    X(64, duration)            \
+    X(64, start_time)          \
+    X(64, bit_rate)
+
+static int read_track(AVIOContext *pb, MOVIndexCacheTrack *t, int64_t size,
+                      int64_t file_size)
+{
+#define READ_FIELD(bits, name) t->name = avio_rl ## bits(pb);
+    SCALAR_FIELDS(READ_FIELD)
+#undef READ_FIELD
+
+    t->nb_rfps_dts = avio_rl32(pb);
+    if (t->nb_rfps_dts > MOV_INDEX_CACHE_MAX_RFPS)
+        return AVERROR_INVALIDDATA;
+    for (unsigned i = 0; i < t->nb_rfps_dts; i++)
+        t->rfps_dts[i] = avio_rl64(pb);
+
+    t->nb_entries = avio_rl32(pb);
+    if ((int64_t)t->nb_entries * ENTRY_RECORD_SIZE > size - avio_tell(pb) ||
+        t->nb_entries > INT_MAX / sizeof(*t->entries))
+        return AVERROR_INVALIDDATA;
+    if (t->nb_entries &&
+        !(t->entries = av_malloc_array(t->nb_entries, sizeof(*t->entries))))
+        return AVERROR(ENOMEM);
+    for (unsigned i = 0; i < t->nb_entries; i++) {
+        AVIndexEntry *e = &t->entries[i];
+        e->pos          = avio_rl64(pb);
+        e->timestamp    = avio_rl64(pb);
+        e->size         = avio_rl32(pb) & 0x3FFFFFFF;
+        e->flags        = avio_rl32(pb) & 3;
+        e->min_distance = avio_rl32(pb);
+        /* the index must be sorted by timestamp and point into the file */
+        if (e->pos < 0 || e->pos > file_size - e->size ||
+            (i && e->timestamp < e[-1].timestamp))
+            return AVERROR_INVALIDDATA;
+    }
+
+    t->nb_tts = avio_rl32(pb);
+    if ((int64_t)t->nb_tts * TTS_RECORD_SIZE > size - avio_tell(pb))
+        return AVERROR_INVALIDDATA;
+    if (t->nb_tts &&
+        !(t->tts = av_malloc_array(t->nb_tts, sizeof(*t->tts))))
+        return AVERROR(ENOMEM);
+    for (unsigned i = 0; i < t->nb_tts; i++) {
+        t->tts[i].count    = avio_rl32(pb);
+        t->tts[i].duration = avio_rl32(pb);
+        t->tts[i].offset   = avio_rl32(pb);
+    }
+
+    t->nb_ranges = avio_rl32(pb);
+    if ((int64_t)t->nb_ranges * RANGE_RECORD_SIZE > size - avio_tell(pb))
+        return AVERROR_INVALIDDATA;
+    if (t->nb_ranges &&
+        !(t->ranges = av_malloc_array(t->nb_ranges, sizeof(*t->ranges))))
+        return AVERROR(ENOMEM);
+    for (unsigned i = 0; i < t->nb_ranges; i++) {
+        t->ranges[i].start = avio_rl64(pb);
+        t->ranges[i].end   = avio_rl64(pb);
+        if (t->ranges[i].start < 0 || t->ranges[i].start > t->ranges[i].end ||
+            t->ranges[i].end > t->nb_entries)
+            return AVERROR_INVALIDDATA;
+    }
+
+    return pb->eof_reached ? AVERROR_INVALIDDATA : 0;
+}
+
+int ff_mov_index_cache_load(AVFormatContext *s, MOVIndexCache *cache,
+                            const char *dir)
+{
+    AVIOContext *pb = NULL;
+    uint8_t tag[16] = { 0 };
+    char *path;
+    int64_t size, file_size = avio_size(s->pb);
+    unsigned nb_tracks;
+    int ret;
+
+    if (!(path = cache_path(cache, dir, ".ffidx")))
+        return AVERROR(ENOMEM);
+    ret = s->io_open(s, &pb, path, AVIO_FLAG_READ, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_DEBUG, "No index cache entry '%s'\n", path);
+        av_free(path);
+        return ret;
+    }
+
+    size = avio_size(pb);
+    ffio_read_size(pb, tag, 8);
+    if (memcmp(tag, "FFMOVIDX", 8) || avio_rl32(pb) != CACHE_VERSION) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    ffio_read_size(pb, tag, sizeof(cache->key));
+    if (memcmp(tag, cache->key, sizeof(cache->key))) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+
+    nb_tracks = avio_rl32(pb);
+    if (!nb_tracks || nb_tracks > INT_MAX / sizeof(*cache->tracks)) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    if (!(cache->tracks = av_calloc(nb_tracks, sizeof(*cache->tracks)))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (cache->nb_tracks = 0; cache->nb_tracks < nb_tracks; ) {
+        ret = read_track(pb, &cache->tracks[cache->nb_tracks++], size,
+                         file_size);
+        if (ret < 0)
+            goto end;
+    }
+
+    ret = ffio_read_size(pb, tag, 8);
+    if (ret >= 0)
+        ret = memcmp(tag, "FFMOVEND", 8) ? AVERROR_INVALIDDATA : 0;
+
+end:
+    ff_format_io_close(s, &pb);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Ignoring invalid index cache entry '%s'\n", path);
+        free_tracks(cache);
+    } else {
+        av_log(s, AV_LOG_VERBOSE, "Loaded index of %u tracks from '%s'\n",
+               cache->nb_tracks, path);
+        cache->hit = 1;
+    }
+    av_free(path);
+    return ret;
+}
+
+static void write_track(AVIOContext *pb, const MOVIndexCacheTrack *t)
+{
+#define WRITE_FIELD(bits, name) avio_wl ## bits(pb, t->name);
+    SCALAR_FIELDS(WRITE_FIELD)
+#undef WRITE_FIELD
+
+    avio_wl32(pb, t->nb_rfps_dts);
+    for (unsigned i = 0; i < t->nb_rfps_dts; i++)
+        avio_wl64(pb, t->rfps_dts[i]);
+
+    avio_wl32(pb, t->nb_entries);
+    for (unsigned i = 0; i < t->nb_entries; i++) {
+        const AVIndexEntry *e = &t->entries[i];
+        avio_wl64(pb, e->pos);
+        avio_wl64(pb, e->timestamp);
+        avio_wl32(pb, e->size);
+        avio_wl32(pb, e->flags);
+        avio_wl32(pb, e->min_distance);
+    }
+
+    avio_wl32(pb, t->nb_tts);
+    for (unsigned i = 0; i < t->nb_tts; i++) {
+        avio_wl32(pb, t->tts[i].count);
+        avio_wl32(pb, t->tts[i].duration);
+        avio_wl32(pb, t->tts[i].offset);
+    }
+
+    avio_wl32(pb, t->nb_ranges);
+    for (unsigned i = 0; i < t->nb_ranges; i++) {
+        avio_wl64(pb, t->ranges[i].start);
+        avio_wl64(pb, t->ranges[i].end);
+    }
+}
+
+int ff_mov_index_cache_save(AVFormatContext *s, MOVIndexCache *cache,
+                            const char *dir)
+{
+    AVIOContext *pb = NULL;
+    char suffix[32];
+    char *path, *tmp_path;
+    int ret;
+
+    snprintf(suffix, sizeof(suffix), ".%08"PRIx32".tmp", av_get_random_seed());
+    path     = cache_path(cache, dir, ".ffidx");
+    tmp_path = cache_path(cache, dir, suffix);
+    if (!path || !tmp_path) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = s->io_open(s, &pb, tmp_path, AVIO_FLAG_WRITE, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not create index cache entry '%s': %s\n",
+               tmp_path, av_err2str(ret));
+        goto end;
+    }
+
+    avio_write(pb, "FFMOVIDX", 8);
+    avio_wl32(pb, CACHE_VERSION);
+    avio_write(pb, cache->key, sizeof(cache->key));
+    avio_wl32(pb, cache->nb_tracks);
+    for (unsigned i = 0; i < cache->nb_tracks; i++)
+        write_track(pb, &cache->tracks[i]);
+    avio_write(pb, "FFMOVEND", 8);
+    avio_flush(pb);
+    ret = pb->error;
+    ff_format_io_close(s, &pb);
+
+    if (ret >= 0)
+        ret = ff_rename(tmp_path, path, s);
+    if (ret < 0)
+        ffurl_delete(tmp_path);
+    else
+        av_log(s, AV_LOG_VERBOSE, "Wrote index of %u tracks to '%s'\n",
+               cache->nb_tracks, path);
+
+end:
+    av_free(tmp_path);
+    av_free(path);
+    return ret;
+}
+
+int ff_mov_index_cache_record(MOVIndexCache *cache, AVStream *st,
+                              unsigned stts_count_parsed,
+                              const int64_t *rfps_dts, unsigned nb_rfps_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+    MOVIndexCacheTrack *t;
+    int ret;
+
+    ret = av_reallocp_array(&cache->tracks, cache->nb_tracks + 1,
+                            sizeof(*cache->tracks));
+    if (ret < 0) {
+        cache->nb_tracks = 0;
+        return ret;
+    }
+    t = &cache->tracks[cache->nb_tracks++];
+    memset(t, 0, sizeof(*t));
+
+    t->stts_count_parsed   = stts_count_parsed;
+    t->chunk_count         = sc->chunk_count;
+    t->sample_count        = sc->sample_count;
+    t->stts_count          = sc->stts_count;
+    t->ctts_count          = sc->ctts_count;
+    t->sample_size         = sc->sample_size;
+    t->stsz_sample_size    = sc->stsz_sample_size;
+    t->keyframe_count      = sc->keyframe_count;
+    t->stps_count          = sc->stps_count;
+    t->keyframe_absent     = sc->keyframe_absent;
+    t->dts_shift           = sc->dts_shift;
+    t->min_sample_duration = sc->min_sample_duration;
+    t->nb_frames_for_fps   = sc->nb_frames_for_fps;
+    t->start_pad           = sc->start_pad;
+    t->skip_samples        = sti->skip_samples;
+    t->need_parsing        = sti->need_parsing;
+    t->discard             = st->discard;
+    t->duration_for_fps    = sc->duration_for_fps;
+    t->track_end           = sc->track_end;
+    t->data_size           = sc->data_size;
+    t->time_offset         = sc->time_offset;
+    t->min_corrected_pts   = sc->min_corrected_pts;
+    t->nb_frames           = st->nb_frames;
+    t->duration            = st->duration;
+    t->start_time          = st->start_time;
+    t->bit_rate            = st->codecpar->bit_rate;
+
+    t->nb_rfps_dts = FFMIN(nb_rfps_dts, MOV_INDEX_CACHE_MAX_RFPS);
+    memcpy(t->rfps_dts, rfps_dts, t->nb_rfps_dts * sizeof(*rfps_dts));
+
+    if (sti->nb_index_entries) {
+        t->entries = av_memdup(sti->index_entries,
+                               sti->nb_index_entries * sizeof(*t->entries));
+        if (!t->entries)
+            return AVERROR(ENOMEM);
+        t->nb_entries = sti->nb_index_entries;
+    }
+    if (sc->tts_count) {
+        t->tts = av_memdup(sc->tts_data, sc->tts_count * sizeof(*t->tts));
+        if (!t->tts)
+            return AVERROR(ENOMEM);
+        t->nb_tts = sc->tts_count;
+    }
+    if (sc->index_ranges) {
+        unsigned nb = 0;
+        while (sc->index_ranges[nb].start || sc->index_ranges[nb].end)
+            nb++;
+        t->ranges = av_memdup(sc->index_ranges, (nb + 1) * sizeof(*t->ranges));
+        if (!t->ranges)
+            return AVERROR(ENOMEM);
+        t->nb_ranges = nb + 1;
+    }
+    return 0;
+}
+
+void ff_mov_index_cache_restore_tables(const MOVIndexCacheTrack *t,
+                                       AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    sc->stts_count   = t->stts_count_parsed;
+    sc->chunk_count  = t->chunk_count;
+    sc->sample_count = t->sample_count;
+}
+
+void ff_mov_index_cache_restore_index(MOVIndexCacheTrack *t, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    FFStream *const sti = ffstream(st);
+
+    sc->stts_count          = t->stts_count;
+    sc->ctts_count          = t->ctts_count;
+    sc->sample_size         = t->sample_size;
+    sc->stsz_sample_size    = t->stsz_sample_size;
+    sc->keyframe_count      = t->keyframe_count;
+    sc->stps_count          = t->stps_count;
+    sc->keyframe_absent     = t->keyframe_absent;
+    sc->dts_shift           = t->dts_shift;
+    sc->min_sample_duration = t->min_sample_duration;
+    sc->nb_frames_for_fps   = t->nb_frames_for_fps;
+    sc->start_pad           = t->start_pad;
+    sti->skip_samples       = t->skip_samples;
+    sti->need_parsing       = t->need_parsing;
+    st->discard             = t->discard;
+    sc->duration_for_fps    = t->duration_for_fps;
+    sc->track_end           = t->track_end;
+    sc->data_size           = t->data_size;
+    sc->time_offset         = t->time_offset;
+    sc->min_corrected_pts   = t->min_corrected_pts;
+    st->nb_frames           = t->nb_frames;
+    st->duration            = t->duration;
+    st->start_time          = t->start_time;
+    st->codecpar->bit_rate  = t->bit_rate;
+
+    if (t->nb_entries) {
+        av_free(sti->index_entries);
+        sti->index_entries = t->entries;
+        sti->nb_index_entries = t->nb_entries;
+        sti->index_entries_allocated_size = t->nb_entries * sizeof(*t->entries);
+        t->entries    = NULL;
+        t->nb_entries = 0;
+    }
+    if (t->nb_tts) {
+        av_free(sc->tts_data);
+        sc->tts_data = t->tts;
+        sc->tts_count = t->nb_tts;
+        sc->tts_allocated_size = t->nb_tts * sizeof(*t->tts);
+        t->tts    = NULL;
+        t->nb_tts = 0;
+    }
+    if (t->nb_ranges) {
+        av_free(sc->index_ranges);
+        sc->index_ranges = t->ranges;
+        sc->current_index_range = sc->index_ranges;
+        sc->current_index = sc->index_ranges[0].start;
+        t->ranges    = NULL;
+        t->nb_ranges = 0;
+    }
+}
@@ -0,0 +1,144 @@
+/*
+ * MOV/MP4 demuxer persistent sample index cache
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Persistent cache of the sample index built from the 'moov' sample tables.
+ *
+ * The cache stores, per 'trak', the AVIndexEntry array, the expanded
+ * time-to-sample table and the edit list index ranges, together with the
+ * stream context fields that mov_build_index() derives from the sample
+ * tables. When a cache entry matches, the demuxer skips the stts, ctts,
+ * stsz, stz2, stco, co64, stss and stps atoms and restores the index
+ * instead of building it.
+ */
+
+#ifndef AVFORMAT_MOV_INDEX_CACHE_H
+#define AVFORMAT_MOV_INDEX_CACHE_H
+
+#include <stdint.h>
+
+#include "avformat.h"
+#include "avio.h"
+#include "isom.h"
+
+typedef struct MOVIndexCacheTrack {
+    /* values as left by the sample table atoms, before mov_build_index() */
+    uint32_t stts_count_parsed;
+    uint32_t chunk_count;
+    uint32_t sample_count;
+
+    /* values after mov_build_index() */
+    uint32_t stts_count;
+    uint32_t ctts_count;
+    uint32_t sample_size;
+    uint32_t stsz_sample_size;
+    uint32_t keyframe_count;
+    uint32_t stps_count;
+    int32_t  keyframe_absent;
+    int32_t  dts_shift;
+    uint32_t min_sample_duration;
+    int32_t  nb_frames_for_fps;
+    int32_t  start_pad;
+    int32_t  skip_samples;
+    int32_t  need_parsing;
+    int32_t  discard;
+    int64_t  duration_for_fps;
+    int64_t  track_end;
+    int64_t  data_size;
+    int64_t  time_offset;
+    int64_t  min_corrected_pts;
+    int64_t  nb_frames;
+    int64_t  duration;
+    int64_t  start_time;
+    int64_t  bit_rate;
+
+    /* timestamps passed to ff_rfps_add_frame() while building the index */
+    int64_t  rfps_dts[MOV_INDEX_CACHE_MAX_RFPS];
+    unsigned nb_rfps_dts;
+
+    AVIndexEntry     *entries;
+    unsigned          nb_entries;
+    MOVTimeToSample  *tts;
+    unsigned          nb_tts;
+    MOVIndexRange    *ranges;     ///< including the zero terminator
+    unsigned          nb_ranges;
+} MOVIndexCacheTrack;
+
+typedef struct MOVIndexCache {
+    uint8_t key[16];
+    MOVIndexCacheTrack *tracks;
+    unsigned nb_tracks;
+    unsigned next_track;   ///< next 'trak' to restore or record
+    int hit;               ///< tracks were loaded from the cache
+    int eligible;          ///< the parsed index may be written back
+} MOVIndexCache;
+
+/**
+ * Compute the cache key of a 'moov' atom from the file size, the atom
+ * position, the atom payload and the demuxer options that affect the index.
+ * The read position of pb is restored.
+ */
+int ff_mov_index_cache_key(MOVIndexCache *cache, AVIOContext *pb,
+                           int64_t moov_pos, int64_t moov_size,
+                           uint32_t flags);
+
+/**
+ * Load the cache entry matching cache->key from dir.
+ *
+ * @return 0 on success, a negative AVERROR code if no usable entry exists
+ */
+int ff_mov_index_cache_load(AVFormatContext *s, MOVIndexCache *cache,
+                            const char *dir);
+
+/**
+ * Write the recorded tracks to dir. The entry is written to a temporary
+ * file which is then renamed, so concurrent readers never see a partial
+ * entry.
+ */
+int ff_mov_index_cache_save(AVFormatContext *s, MOVIndexCache *cache,
+                            const char *dir);
+
+/**
+ * Record the index of a 'trak' for which mov_build_index() just ran.
+ *
+ * @param stts_count_parsed stts entry count before mov_build_index()
+ */
+int ff_mov_index_cache_record(MOVIndexCache *cache, AVStream *st,
+                              unsigned stts_count_parsed,
+                              const int64_t *rfps_dts, unsigned nb_rfps_dts);
+
+/**
+ * Copy the sample table counts of a cached 'trak' to its stream context.
+ * Must be called before ff_mov_index_cache_restore_index().
+ */
+void ff_mov_index_cache_restore_tables(const MOVIndexCacheTrack *t,
+                                       AVStream *st);
+
+/**
+ * Install the cached index of a 'trak' in place of mov_build_index().
+ * The index arrays are moved from t to the stream. The caller is
+ * responsible for replaying ff_rfps_add_frame().
+ */
+void ff_mov_index_cache_restore_index(MOVIndexCacheTrack *t, AVStream *st);
+
+void ff_mov_index_cache_free(MOVIndexCache **cache);
+
+#endif /* AVFORMAT_MOV_INDEX_CACHE_H */
@@ -0,0 +1,468 @@
+/*
+ * Background segment prefetching for the adaptive streaming demuxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <limits.h>
+
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "internal.h"
+#include "prefetch.h"
+#include "url.h"
+
+#if HAVE_THREADS
+
+#define PREFETCH_CHUNK_SIZE 32768
+
+struct FFPrefetch {
+    AVFormatContext *parent;
+    FFPrefetchOpenFunc open;
+    const char *thread_name;
+
+    FFPrefetchSlot *slots;
+    int nb_slots;
+    uint8_t *slot_priv;
+    uint64_t next_order;
+    /* bytes held by all the slots */
+    int64_t buffered;
+
+    pthread_t *threads;
+    int nb_threads;
+    int abort_request;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_worker;
+    pthread_cond_t cond_reader;
+};
+
+/* Must be called with the mutex held. */
+static void slot_reset(FFPrefetch *pf, FFPrefetchSlot *slot)
+{
+    pf->buffered -= slot->data_len;
+    av_freep(&slot->buf);
+    av_freep(&slot->url);
+    av_dict_free(&slot->opts);
+    av_dict_free(&slot->avio_opts);
+    slot->buf_size = 0;
+    slot->data_len = 0;
+    slot->ret      = 0;
+    slot->discard  = 0;
+    slot->state    = FF_PREFETCH_EMPTY;
+}
+
+/* Must be called with the mutex held. */
+static void slot_release(FFPrefetch *pf, FFPrefetchSlot *slot)
+{
+    if (slot->state == FF_PREFETCH_FETCHING)
+        slot->discard = 1;
+    else if (slot->state != FF_PREFETCH_EMPTY)
+        slot_reset(pf, slot);
+}
+
+/* Must be called with the mutex held. */
+static FFPrefetchSlot *slot_find(FFPrefetchSlot *slots, int nb_slots, int64_t seq_no)
+{
+    for (int i = 0; i < nb_slots; i++) {
+        FFPrefetchSlot *slot = &slots[i];
+
+        if (slot->state != FF_PREFETCH_EMPTY && !slot->discard &&
+            slot->seq_no == seq_no)
+            return slot;
+    }
+    return NULL;
+}
+
+/* Wait for the fetching threads to make progress. Must be called with the
+ * mutex held. */
+static int prefetch_wait(FFPrefetch *pf)
+{
+    /* FIXME: using the monotonic clock would be better,
+       but it does not exist on all supported platforms. */
+    int64_t t = av_gettime() + 100000;
+    struct timespec tv = { .tv_sec  =  t / 1000000,
+                           .tv_nsec = (t % 1000000) * 1000 };
+
+    pthread_cond_timedwait(&pf->cond_reader, &pf->mutex, &tv);
+
+    return ff_check_interrupt(&pf->parent->interrupt_callback) ? AVERROR_EXIT : 0;
+}
+
+/* Wait until a segment is downloaded up to pos, or completely. Must be
+ * called with the mutex held. */
+static int prefetch_wait_data(FFPrefetch *pf, FFPrefetchSlot *slot, int64_t pos)
+{
+    int ret = 0;
+
+    while (slot->data_len <= pos && slot->state != FF_PREFETCH_DONE && ret >= 0)
+        ret = prefetch_wait(pf);
+
+    return ret;
+}
+
+static void *prefetch_worker(void *arg)
+{
+    FFPrefetch *pf = arg;
+    AVFormatContext *s = pf->parent;
+    AVIOContext *pb = NULL;
+    uint8_t chunk[PREFETCH_CHUNK_SIZE];
+
+    ff_thread_setname(pf->thread_name);
+
+    pthread_mutex_lock(&pf->mutex);
+    while (!pf->abort_request) {
+        FFPrefetchSlot *slot = NULL;
+        int64_t size = 0;
+        int ret;
+
+        for (int i = 0; i < pf->nb_slots; i++) {
+            FFPrefetchSlot *cur = &pf->slots[i];
+            if (cur->state == FF_PREFETCH_QUEUED &&
+                (!slot || cur->order < slot->order))
+                slot = cur;
+        }
+        if (!slot) {
+            pthread_cond_wait(&pf->cond_worker, &pf->mutex);
+            continue;
+        }
+        slot->state = FF_PREFETCH_FETCHING;
+        pthread_mutex_unlock(&pf->mutex);
+
+        ret = pf->open(s, &pb, slot);
+
+        while (ret >= 0) {
+            int len = sizeof(chunk);
+            uint8_t *buf;
+
+            if (slot->size >= 0) {
+                if (size >= slot->size)
+                    break;
+                len = FFMIN(len, slot->size - size);
+            }
+            len = avio_read(pb, chunk, len);
+            if (len == AVERROR_EOF || !len)
+                break;
+            if (len < 0) {
+                ret = len;
+                break;
+            }
+            size += len;
+
+            pthread_mutex_lock(&pf->mutex);
+            if (pf->abort_request || slot->discard) {
+                ret = AVERROR_EXIT;
+            } else if (len > UINT_MAX - slot->data_len ||
+                       !(buf = av_fast_realloc(slot->buf, &slot->buf_size,
+                                               slot->data_len + len))) {
+                ret = AVERROR(ENOMEM);
+            } else {
+                slot->buf = buf;
+                memcpy(slot->buf + slot->data_len, chunk, len);
+                slot->data_len += len;
+                pf->buffered   += len;
+                pthread_cond_broadcast(&pf->cond_reader);
+            }
+            pthread_mutex_unlock(&pf->mutex);
+        }
+        if (ret < 0 || !slot->keepalive)
+            ff_format_io_close(s, &pb);
+
+        pthread_mutex_lock(&pf->mutex);
+        if (slot->discard) {
+            slot_reset(pf, slot);
+        } else {
+            if (ret < 0 && ret != AVERROR_EXIT)
+                av_log(s, AV_LOG_WARNING, "Failed to prefetch segment '%s': %s\n",
+                       slot->url, av_err2str(ret));
+            slot->ret   = FFMIN(ret, 0);
+            slot->state = FF_PREFETCH_DONE;
+        }
+        pthread_cond_broadcast(&pf->cond_reader);
+    }
+    pthread_mutex_unlock(&pf->mutex);
+
+    ff_format_io_close(s, &pb);
+
+    return NULL;
+}
+
+int ff_prefetch_alloc(FFPrefetch **ppf, AVFormatContext *s,
+                      int nb_slots, int nb_threads, size_t slot_priv_size,
+                      const char *thread_name, FFPrefetchOpenFunc open)
+{
+    FFPrefetch *pf;
+    int ret;
+
+    pf = av_mallocz(sizeof(*pf));
+    if (!pf)
+        return AVERROR(ENOMEM);
+    pf->parent      = s;
+    pf->open        = open;
+    pf->thread_name = thread_name;
+
+    pf->slots   = av_calloc(nb_slots, sizeof(*pf->slots));
+    pf->threads = av_calloc(nb_threads, sizeof(*pf->threads));
+    if (slot_priv_size)
+        pf->slot_priv = av_calloc(nb_slots, slot_priv_size);
+    if (!pf->slots || !pf->threads || (slot_priv_size && !pf->slot_priv)) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    pf->nb_slots = nb_slots;
+    if (slot_priv_size) {
+        for (int i = 0; i < nb_slots; i++)
+            pf->slots[i].priv = pf->slot_priv + i * slot_priv_size;
+    }
+
+    ret = pthread_mutex_init(&pf->mutex, NULL);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto fail;
+    }
+    ret = pthread_cond_init(&pf->cond_worker, NULL);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto fail_mutex;
+    }
+    ret = pthread_cond_init(&pf->cond_reader, NULL);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto fail_cond;
+    }
+
+    *ppf = pf;
+
+    for (int i = 0; i < nb_threads; i++) {
+        ret = pthread_create(&pf->threads[i], NULL, prefetch_worker, pf);
+        if (ret) {
+            av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   av_err2str(AVERROR(ret)));
+            ff_prefetch_free(ppf);
+            return AVERROR(ret);
+        }
+        pf->nb_threads++;
+    }
+
+    return 0;
+
+fail_cond:
+    pthread_cond_destroy(&pf->cond_worker);
+fail_mutex:
+    pthread_mutex_destroy(&pf->mutex);
+fail:
+    av_freep(&pf->slots);
+    av_freep(&pf->slot_priv);
+    av_freep(&pf->threads);
+    av_free(pf);
+    return ret;
+}
+
+void ff_prefetch_free(FFPrefetch **ppf)
+{
+    FFPrefetch *pf = *ppf;
+
+    if (!pf)
+        return;
+
+    pthread_mutex_lock(&pf->mutex);
+    pf->abort_request = 1;
+    pthread_cond_broadcast(&pf->cond_worker);
+    pthread_mutex_unlock(&pf->mutex);
+
+    for (int i = 0; i < pf->nb_threads; i++)
+        pthread_join(pf->threads[i], NULL);
+
+    pthread_cond_destroy(&pf->cond_reader);
+    pthread_cond_destroy(&pf->cond_worker);
+    pthread_mutex_destroy(&pf->mutex);
+
+    for (int i = 0; i < pf->nb_slots; i++)
+        slot_reset(pf, &pf->slots[i]);
+    av_freep(&pf->slots);
+    av_freep(&pf->slot_priv);
+    av_freep(&pf->threads);
+    av_freep(ppf);
+}
+
+FFPrefetchSlot *ff_prefetch_slots(FFPrefetch *pf)
+{
+    return pf->slots;
+}
+
+void ff_prefetch_release(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots,
+                         int64_t start, int64_t end)
+{
+    pthread_mutex_lock(&pf->mutex);
+    for (int i = 0; i < nb_slots; i++) {
+        FFPrefetchSlot *slot = &slots[i];
+        if (slot->seq_no < start || slot->seq_no >= end)
+            slot_release(pf, slot);
+    }
+    pthread_mutex_unlock(&pf->mutex);
+}
+
+void ff_prefetch_flush(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots)
+{
+    pthread_mutex_lock(&pf->mutex);
+    for (int i = 0; i < nb_slots; i++)
+        slot_release(pf, &slots[i]);
+    pthread_mutex_unlock(&pf->mutex);
+}
+
+int ff_prefetch_get_slot(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots,
+                         int64_t seq_no, int64_t max_buffered,
+                         FFPrefetchSlot **slot)
+{
+    int found;
+
+    *slot = NULL;
+
+    pthread_mutex_lock(&pf->mutex);
+    found = !!slot_find(slots, nb_slots, seq_no);
+    if (!found && pf->buffered < max_buffered) {
+        for (int i = 0; i < nb_slots && !*slot; i++)
+            if (slots[i].state == FF_PREFETCH_EMPTY)
+                *slot = &slots[i];
+    }
+    pthread_mutex_unlock(&pf->mutex);
+
+    return found;
+}
+
+void ff_prefetch_queue(FFPrefetch *pf, FFPrefetchSlot *slot)
+{
+    pthread_mutex_lock(&pf->mutex);
+    slot->order = pf->next_order++;
+    slot->state = FF_PREFETCH_QUEUED;
+    pthread_cond_signal(&pf->cond_worker);
+    pthread_mutex_unlock(&pf->mutex);
+}
+
+int ff_prefetch_open(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots,
+                     int64_t seq_no, int (*schedule)(void *opaque),
+                     void *opaque, FFPrefetchSlot **pslot)
+{
+    FFPrefetchSlot *slot;
+    int ret = schedule(opaque);
+
+    if (ret < 0)
+        return ret;
+
+    pthread_mutex_lock(&pf->mutex);
+    while (1) {
+        slot = slot_find(slots, nb_slots, seq_no);
+        if (slot && (slot->data_len || slot->state == FF_PREFETCH_DONE))
+            break;
+        /* all the slots may still be held by released segments */
+        if (!slot) {
+            pthread_mutex_unlock(&pf->mutex);
+            ret = schedule(opaque);
+            pthread_mutex_lock(&pf->mutex);
+            if (ret < 0)
+                break;
+            if (slot_find(slots, nb_slots, seq_no))
+                continue;
+        }
+        ret = prefetch_wait(pf);
+        if (ret < 0)
+            break;
+    }
+    if (ret >= 0 && !slot->data_len && slot->ret < 0) {
+        ret = slot->ret;
+        slot_reset(pf, slot);
+    }
+    pthread_mutex_unlock(&pf->mutex);
+
+    if (ret < 0)
+        return ret;
+
+    *pslot = slot;
+    return 0;
+}
+
+int ff_prefetch_read(FFPrefetch *pf, FFPrefetchSlot *slot, int64_t *pos,
+                     uint8_t *buf, int buf_size)
+{
+    int ret;
+
+    pthread_mutex_lock(&pf->mutex);
+    ret = prefetch_wait_data(pf, slot, *pos);
+    if (ret < 0) {
+        ;
+    } else if (slot->data_len > *pos) {
+        ret = FFMIN(buf_size, slot->data_len - *pos);
+        memcpy(buf, slot->buf + *pos, ret);
+        *pos += ret;
+    } else {
+        ret = slot->ret < 0 ? slot->ret : AVERROR_EOF;
+    }
+    pthread_mutex_unlock(&pf->mutex);
+
+    return ret;
+}
+
+int64_t ff_prefetch_seek(FFPrefetch *pf, FFPrefetchSlot *slot, int64_t *pos,
+                         int64_t offset, int whence)
+{
+    int64_t ret = AVERROR(ENOSYS);
+
+    pthread_mutex_lock(&pf->mutex);
+    if (whence == AVSEEK_SIZE) {
+        if (slot->size >= 0)
+            ret = slot->size;
+        else if (slot->state == FF_PREFETCH_DONE)
+            ret = slot->data_len;
+    } else if (whence == SEEK_SET && offset >= 0) {
+        ret = prefetch_wait_data(pf, slot, offset - 1);
+        if (ret >= 0 && offset <= slot->data_len) {
+            *pos = offset;
+            ret  = offset;
+        } else if (ret >= 0) {
+            ret = AVERROR(EINVAL);
+        }
+    }
+    pthread_mutex_unlock(&pf->mutex);
+
+    return ret;
+}
+
+void ff_prefetch_close(FFPrefetch *pf, FFPrefetchSlot *slot)
+{
+    pthread_mutex_lock(&pf->mutex);
+    slot_reset(pf, slot);
+    pthread_mutex_unlock(&pf->mutex);
+}
+
+#else
+
+int ff_prefetch_alloc(FFPrefetch **ppf, AVFormatContext *s,
+                      int nb_slots, int nb_threads, size_t slot_priv_size,
+                      const char *thread_name, FFPrefetchOpenFunc open)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_prefetch_free(FFPrefetch **ppf)
+{
+}
+
+#endif /* HAVE_THREADS */
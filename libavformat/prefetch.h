@@ -0,0 +1,173 @@
+/*
+ * Background segment prefetching for the adaptive streaming demuxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Background segment prefetching.
+ *
+ * A pool of threads downloads segments into memory, so that several
+ * requests are in flight at once instead of paying a round trip per
+ * segment. The demuxer thread fills empty slots with the segment requests
+ * and queues them, then reads the current segment from memory while it is
+ * still being downloaded. The slots are split between the streams of the
+ * demuxer by the caller, segments being identified by their sequence
+ * number within the slots of a stream.
+ *
+ * Unless stated otherwise, the functions below must only be called from
+ * the demuxer thread, and the caller must not access the fields of a slot
+ * that is not empty, except for the ones documented as constant.
+ */
+
+#ifndef AVFORMAT_PREFETCH_H
+#define AVFORMAT_PREFETCH_H
+
+#include <stdint.h>
+
+#include "libavutil/dict.h"
+#include "avformat.h"
+
+typedef struct FFPrefetch FFPrefetch;
+
+enum FFPrefetchState {
+    FF_PREFETCH_EMPTY,
+    FF_PREFETCH_QUEUED,
+    FF_PREFETCH_FETCHING,
+    FF_PREFETCH_DONE,
+};
+
+typedef struct FFPrefetchSlot {
+    /* Set by the caller before queueing the slot, constant afterwards. */
+    int64_t seq_no;
+    char *url;
+    AVDictionary *opts;         ///< segment specific protocol options
+    AVDictionary *avio_opts;    ///< generic protocol options
+    int64_t url_offset;
+    int64_t size;               ///< -1 if the whole resource is the segment
+    /* the connection can be left open for the next segment, may be updated
+     * by the open callback */
+    int keepalive;
+    /* caller private data, of the size given to ff_prefetch_alloc() */
+    void *priv;
+
+    enum FFPrefetchState state;
+    uint64_t order;             ///< segments are fetched in the order they were queued
+    /* the slot was released while being fetched, the fetching thread
+     * drops the data and empties it */
+    int discard;
+
+    uint8_t *buf;
+    unsigned int buf_size;
+    unsigned int data_len;
+    int ret;                    ///< error code once done, if any
+} FFPrefetchSlot;
+
+/**
+ * Open the resource of a slot in a fetching thread.
+ *
+ * @param pb the connection left open by the previous segment fetched by
+ *           this thread if it was kept alive, or NULL. It may be reused,
+ *           or must be closed otherwise.
+ */
+typedef int (*FFPrefetchOpenFunc)(AVFormatContext *s, AVIOContext **pb,
+                                  FFPrefetchSlot *slot);
+
+/**
+ * Allocate the slots and start the fetching threads.
+ *
+ * @param thread_name name of the fetching threads
+ * @return 0 on success, AVERROR(ENOSYS) if threads are not supported, or
+ *         another negative error code
+ */
+int ff_prefetch_alloc(FFPrefetch **ppf, AVFormatContext *s,
+                      int nb_slots, int nb_threads, size_t slot_priv_size,
+                      const char *thread_name, FFPrefetchOpenFunc open);
+
+/**
+ * Stop the fetching threads and free everything.
+ */
+void ff_prefetch_free(FFPrefetch **ppf);
+
+/**
+ * @return the array of the nb_slots slots
+ */
+FFPrefetchSlot *ff_prefetch_slots(FFPrefetch *pf);
+
+/**
+ * Release the slots holding segments outside of [start, end), so that they
+ * can be reused once their fetching thread stopped.
+ */
+void ff_prefetch_release(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots,
+                         int64_t start, int64_t end);
+
+/**
+ * Release all the slots, e.g. after a seek.
+ */
+void ff_prefetch_flush(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots);
+
+/**
+ * Look for a slot for the segment seq_no.
+ *
+ * @param max_buffered no empty slot is returned if at least this amount of
+ *                     data is held by all the slots
+ * @param slot set to an empty slot, to be filled and queued with
+ *             ff_prefetch_queue(), or NULL if none is available
+ * @return 1 if a slot already holds the segment, 0 otherwise
+ */
+int ff_prefetch_get_slot(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots,
+                         int64_t seq_no, int64_t max_buffered,
+                         FFPrefetchSlot **slot);
+
+/**
+ * Queue a slot filled by the caller for fetching.
+ */
+void ff_prefetch_queue(FFPrefetch *pf, FFPrefetchSlot *slot);
+
+/**
+ * Wait for the segment seq_no to start arriving.
+ *
+ * @param schedule called to queue the segments, again while no slot holds
+ *                 the segment as they may all be held by released segments
+ * @param slot set to the slot holding the segment on success, which stays
+ *             owned by the caller until ff_prefetch_close()
+ */
+int ff_prefetch_open(FFPrefetch *pf, FFPrefetchSlot *slots, int nb_slots,
+                     int64_t seq_no, int (*schedule)(void *opaque),
+                     void *opaque, FFPrefetchSlot **slot);
+
+/**
+ * Read from an opened segment at *pos, waiting for the data if needed, and
+ * update *pos.
+ */
+int ff_prefetch_read(FFPrefetch *pf, FFPrefetchSlot *slot, int64_t *pos,
+                     uint8_t *buf, int buf_size);
+
+/**
+ * Seek in an opened segment, setting *pos, or get its size with
+ * AVSEEK_SIZE.
+ */
+int64_t ff_prefetch_seek(FFPrefetch *pf, FFPrefetchSlot *slot, int64_t *pos,
+                         int64_t offset, int whence);
+
+/**
+ * Release an opened segment once it was read.
+ */
+void ff_prefetch_close(FFPrefetch *pf, FFPrefetchSlot *slot);
+
+#endif /* AVFORMAT_PREFETCH_H */
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
 
 #include "avformat.h"
 #include "libavutil/avassert.h"
@@ -46,6 +47,10 @@
 #include "TargetConditionals.h"
 #endif
 
+#if HAVE_SENDMMSG
+#include <netinet/udp.h>
+#endif
+
 #if HAVE_UDPLITE_H
 #include "udplite.h"
 #else
@@ -78,6 +83,14 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH 1024
+/* Limits for segmentation offload: the whole send must fit in one IPv4
+ * datagram, and the kernel refuses more than 64 segments. */
+#define UDP_MAX_GSO_SIZE 65507
+#define UDP_MAX_GSO_SEGMENTS 64
+/* Without burst_bits, datagrams paced by bitrate are sent in batches
+ * holding up to this duration of data, in microseconds. */
+#define UDP_BATCH_DURATION 1000
 
 typedef struct UDPQueuedPacketHeader {
     int pkt_size;
@@ -126,6 +139,22 @@ typedef struct UDPContext {
     IPSourceFilters filters;
     struct sockaddr_storage last_recv_addr;
     socklen_t last_recv_addr_len;
+
+    /* Batched I/O */
+    int batch_size;
+    int gso;
+    int gso_size;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_storage *msg_addrs;
+    uint8_t *batch_buf;
+    int batch_pkt_size;       /* size of the buffer of each datagram */
+    int batch_truncated;      /* a received datagram did not fit */
+    int batch_nb, batch_idx;  /* datagrams received and returned in the direct read path */
+#endif
+    int64_t nb_datagrams;
+    int64_t nb_syscalls;
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -151,6 +180,8 @@ static const AVOption options[] = {
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Maximum number of datagrams per system call",     OFFSET(batch_size),     AV_OPT_TYPE_INT,    { .i64 = 16 },     1, UDP_MAX_BATCH, .flags = D|E },
+    { "gso",            "Send pkt_size sized datagrams in batches with segmentation offload", OFFSET(gso), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1,     E },
     { NULL }
 };
 
@@ -525,6 +556,109 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static int udp_batch_alloc(URLContext *h, int is_output)
+{
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    UDPContext *s = h->priv_data;
+    int n = s->batch_size;
+    /* larger datagrams are sent on their own, or truncated when received */
+    int pkt_size = is_output ? h->max_packet_size : s->pkt_size;
+
+    if (n < 2)
+        return 0;
+
+    if (pkt_size <= 0 || pkt_size > UDP_MAX_PKT_SIZE)
+        pkt_size = UDP_MAX_PKT_SIZE;
+    s->batch_pkt_size = pkt_size;
+
+    s->msgs      = av_calloc(n, sizeof(*s->msgs));
+    s->iov       = av_calloc(n, sizeof(*s->iov));
+    s->batch_buf = av_malloc_array(n, pkt_size);
+    if (!is_output)
+        s->msg_addrs = av_calloc(n, sizeof(*s->msg_addrs));
+    if (!s->msgs || !s->iov || !s->batch_buf || (!is_output && !s->msg_addrs))
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < n; i++) {
+        struct msghdr *hdr = &s->msgs[i].msg_hdr;
+
+        s->iov[i].iov_base = s->batch_buf + i * pkt_size;
+        s->iov[i].iov_len  = pkt_size;
+        hdr->msg_iov    = &s->iov[i];
+        hdr->msg_iovlen = 1;
+        if (!is_output) {
+            hdr->msg_name = &s->msg_addrs[i];
+        } else if (!s->is_connected) {
+            hdr->msg_name    = &s->dest_addr;
+            hdr->msg_namelen = s->dest_addr_len;
+        }
+    }
+#endif
+    return 0;
+}
+
+static void udp_batch_free(UDPContext *s)
+{
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->msg_addrs);
+    av_freep(&s->batch_buf);
+#endif
+}
+
+#if HAVE_RECVMMSG
+/**
+ * Receive up to batch_size datagrams into the batch buffers.
+ * @return the number of datagrams received, or -1 on error, like recvmmsg()
+ */
+static int udp_recv_batch(URLContext *h, int flags)
+{
+    UDPContext *s = h->priv_data;
+    int n;
+
+    for (int i = 0; i < s->batch_size; i++)
+        s->msgs[i].msg_hdr.msg_namelen = sizeof(s->msg_addrs[i]);
+
+    n = recvmmsg(s->udp_fd, s->msgs, s->batch_size, flags, NULL);
+    if (n > 0) {
+        s->nb_syscalls++;
+        s->nb_datagrams += n;
+    }
+    for (int i = 0; i < n; i++) {
+        if ((s->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) && !s->batch_truncated) {
+            av_log(h, AV_LOG_WARNING, "Received a datagram larger than %d bytes, "
+                   "it was truncated. Increase pkt_size to avoid it.\n",
+                   s->batch_pkt_size);
+            s->batch_truncated = 1;
+        }
+    }
+    return n;
+}
+#endif
+
+#if HAVE_SENDMMSG
+static int udp_send_batch(UDPContext *s, int nb_pkts)
+{
+    struct mmsghdr *msgs = s->msgs;
+
+    while (nb_pkts) {
+        int ret = sendmmsg(s->udp_fd, msgs, nb_pkts, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+            continue;
+        }
+        s->nb_syscalls++;
+        s->nb_datagrams += ret;
+        msgs    += ret;
+        nb_pkts -= ret;
+    }
+    return 0;
+}
+#endif
+
 #if HAVE_PTHREAD_CANCEL
 static void *circular_buffer_task_rx( void *_URLContext)
 {
@@ -543,42 +677,70 @@ static void *circular_buffer_task_rx( void *_URLContext)
     }
     while(1) {
         UDPQueuedPacketHeader pkt_header;
-        pkt_header.addr_len = sizeof(pkt_header.addr);
+        int nb_pkts;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancellation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        pkt_header.pkt_size = recvfrom(s->udp_fd, s->tmp + sizeof(pkt_header), sizeof(s->tmp) - sizeof(pkt_header), 0, (struct sockaddr *)&pkt_header.addr, &pkt_header.addr_len);
+#if HAVE_RECVMMSG
+        if (s->msgs) {
+            /* Block for the first datagram only, then take whatever
+             * else is already queued on the socket. */
+            nb_pkts = udp_recv_batch(h, MSG_WAITFORONE);
+        } else
+#endif
+        {
+            pkt_header.addr_len = sizeof(pkt_header.addr);
+            pkt_header.pkt_size = recvfrom(s->udp_fd, s->tmp, UDP_MAX_PKT_SIZE, 0, (struct sockaddr *)&pkt_header.addr, &pkt_header.addr_len);
+            nb_pkts = pkt_header.pkt_size < 0 ? -1 : 1;
+        }
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
-        if (pkt_header.pkt_size < 0) {
+        if (nb_pkts < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
                 s->circular_buffer_error = ff_neterrno();
                 goto end;
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&pkt_header.addr, &s->filters))
-            continue;
-        memcpy(s->tmp, &pkt_header, sizeof(pkt_header));
 
-        if (av_fifo_can_write(s->rx_fifo) < pkt_header.pkt_size + sizeof(pkt_header)) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        for (int i = 0; i < nb_pkts; i++) {
+            const uint8_t *data = s->tmp;
+
+#if HAVE_RECVMMSG
+            if (s->msgs) {
+                pkt_header.pkt_size = s->msgs[i].msg_len;
+                pkt_header.addr_len = s->msgs[i].msg_hdr.msg_namelen;
+                memcpy(&pkt_header.addr, &s->msg_addrs[i], pkt_header.addr_len);
+                data = s->iov[i].iov_base;
+            } else
+#endif
+            {
+                s->nb_syscalls++;
+                s->nb_datagrams++;
+            }
+            if (ff_ip_check_source_lists(&pkt_header.addr, &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+
+            if (av_fifo_can_write(s->rx_fifo) < pkt_header.pkt_size + sizeof(pkt_header)) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
             }
+            av_fifo_write(s->rx_fifo, &pkt_header, sizeof(pkt_header));
+            av_fifo_write(s->rx_fifo, data, pkt_header.pkt_size);
         }
-        av_fifo_write(s->rx_fifo, s->tmp, pkt_header.pkt_size + sizeof(pkt_header));
         pthread_cond_signal(&s->cond);
     }
 
@@ -597,6 +759,8 @@ static void *circular_buffer_task_tx( void *_URLContext)
     int64_t sent_bits = 0;
     int64_t burst_interval = s->bitrate ? (s->burst_bits * 1000000 / s->bitrate) : 0;
     int64_t max_delay = s->bitrate ?  ((int64_t)h->max_packet_size * 8 * 1000000 / s->bitrate + 1) : 0;
+    int64_t batch_bits = s->burst_bits ? s->burst_bits :
+                         s->bitrate * UDP_BATCH_DURATION / 1000000;
 
     ff_thread_setname("udp-tx");
 
@@ -609,7 +773,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
     }
 
     for(;;) {
-        int len;
+        int len, nb_pkts = 0;
         const uint8_t *p;
         uint8_t tmp[4];
         int64_t timestamp;
@@ -623,13 +787,42 @@ static void *circular_buffer_task_tx( void *_URLContext)
             len = av_fifo_can_read(s->tx_fifo);
         }
 
-        av_fifo_read(s->tx_fifo, tmp, 4);
-        len = AV_RL32(tmp);
+#if HAVE_SENDMMSG
+        if (s->msgs) {
+            av_fifo_peek(s->tx_fifo, tmp, 4, 0);
+            len = AV_RL32(tmp);
+        }
+        if (s->msgs && len <= s->batch_pkt_size) {
+            /* Gather queued packets for a single sendmmsg() call, without
+             * exceeding the allowed burst length. */
+            len = 0;
+            do {
+                int pkt_len;
+
+                av_fifo_peek(s->tx_fifo, tmp, 4, 0);
+                pkt_len = AV_RL32(tmp);
+                if (pkt_len > s->batch_pkt_size ||
+                    (nb_pkts && (len + pkt_len) * 8LL > batch_bits))
+                    break;
+
+                av_assert0(pkt_len >= 0);
+
+                av_fifo_drain2(s->tx_fifo, 4);
+                av_fifo_read(s->tx_fifo, s->iov[nb_pkts].iov_base, pkt_len);
+                s->iov[nb_pkts++].iov_len = pkt_len;
+                len += pkt_len;
+            } while (nb_pkts < s->batch_size && av_fifo_can_read(s->tx_fifo) >= 4);
+        } else
+#endif
+        {
+            av_fifo_read(s->tx_fifo, tmp, 4);
+            len = AV_RL32(tmp);
 
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
+            av_assert0(len >= 0);
+            av_assert0(len <= sizeof(s->tmp));
 
-        av_fifo_read(s->tx_fifo, s->tmp, len);
+            av_fifo_read(s->tx_fifo, s->tmp, len);
+        }
 
         pthread_mutex_unlock(&s->mutex);
 
@@ -653,6 +846,19 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
+#if HAVE_SENDMMSG
+        if (nb_pkts) {
+            int ret = udp_send_batch(s, nb_pkts);
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+            len = 0;
+        }
+#endif
+
         p = s->tmp;
         while (len) {
             int ret;
@@ -666,6 +872,8 @@ static void *circular_buffer_task_tx( void *_URLContext)
             if (ret >= 0) {
                 len -= ret;
                 p   += ret;
+                s->nb_syscalls++;
+                s->nb_datagrams++;
             } else {
                 ret = ff_neterrno();
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
@@ -903,6 +1111,29 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    if (s->gso && is_output) {
+#ifdef UDP_SEGMENT
+        int nb_segs = s->pkt_size > 0 ? FFMIN3(s->batch_size, UDP_MAX_GSO_SEGMENTS,
+                                               UDP_MAX_GSO_SIZE / s->pkt_size) : 0;
+        if (nb_segs > 1) {
+            /* Let the kernel split each write into pkt_size sized datagrams. */
+            if (setsockopt(udp_fd, IPPROTO_UDP, UDP_SEGMENT, &s->pkt_size, sizeof(s->pkt_size)) < 0) {
+                ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(UDP_SEGMENT)");
+            } else {
+                s->gso_size = s->pkt_size;
+                h->max_packet_size = s->pkt_size * nb_segs;
+            }
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "'gso' option was set but it is not supported on this build\n");
+#endif
+    }
+
+#if HAVE_RECVMMSG
+    if (!is_output && (ret = udp_batch_alloc(h, 0)) < 0)
+        goto fail;
+#endif
+
 #if HAVE_PTHREAD_CANCEL
     /*
       Create thread in case of:
@@ -926,6 +1157,10 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             s->tx_fifo = fifo;
         else
             s->rx_fifo = fifo;
+#if HAVE_SENDMMSG
+        if (is_output && (ret = udp_batch_alloc(h, 1)) < 0)
+            goto fail;
+#endif
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -960,6 +1195,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         closesocket(udp_fd);
     av_fifo_freep2(&s->rx_fifo);
     av_fifo_freep2(&s->tx_fifo);
+    udp_batch_free(s);
     ff_ip_reset_filters(&s->filters);
     return ret;
 }
@@ -1027,6 +1263,34 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     }
 #endif
 
+#if HAVE_RECVMMSG
+    if (s->msgs) {
+        int i;
+
+        if (s->batch_idx >= s->batch_nb) {
+            if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+                ret = ff_network_wait_fd(s->udp_fd, 0);
+                if (ret < 0)
+                    return ret;
+            }
+            ret = udp_recv_batch(h, 0);
+            if (ret < 0)
+                return ff_neterrno();
+            s->batch_nb  = ret;
+            s->batch_idx = 0;
+        }
+
+        i   = s->batch_idx++;
+        ret = FFMIN(size, s->msgs[i].msg_len);
+        memcpy(buf, s->iov[i].iov_base, ret);
+        s->last_recv_addr_len = s->msgs[i].msg_hdr.msg_namelen;
+        memcpy(&s->last_recv_addr, &s->msg_addrs[i], s->last_recv_addr_len);
+        if (ff_ip_check_source_lists(&s->last_recv_addr, &s->filters))
+            return AVERROR(EINTR);
+        return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 0);
         if (ret < 0)
@@ -1036,6 +1300,8 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     ret = recvfrom(s->udp_fd, buf, size, 0, (struct sockaddr *)&s->last_recv_addr, &s->last_recv_addr_len);
     if (ret < 0)
         return ff_neterrno();
+    s->nb_syscalls++;
+    s->nb_datagrams++;
     if (ff_ip_check_source_lists(&s->last_recv_addr, &s->filters))
         return AVERROR(EINTR);
     return ret;
@@ -1062,6 +1328,11 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return err;
         }
 
+        if (size > UDP_MAX_PKT_SIZE) {
+            pthread_mutex_unlock(&s->mutex);
+            return AVERROR(EMSGSIZE);
+        }
+
         if (av_fifo_can_write(s->tx_fifo) < size + 4) {
             /* What about a partial packet tx ? */
             pthread_mutex_unlock(&s->mutex);
@@ -1088,7 +1359,12 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     } else
         ret = send(s->udp_fd, buf, size, 0);
 
-    return ret < 0 ? ff_neterrno() : ret;
+    if (ret < 0)
+        return ff_neterrno();
+
+    s->nb_syscalls++;
+    s->nb_datagrams += s->gso_size ? (ret + s->gso_size - 1) / s->gso_size : 1;
+    return ret;
 }
 
 static int udp_close(URLContext *h)
@@ -1130,9 +1406,15 @@ static int udp_close(URLContext *h)
         pthread_cond_destroy(&s->cond);
     }
 #endif
+    if (s->nb_syscalls)
+        av_log(h, AV_LOG_VERBOSE, "%"PRId64" datagrams %s in %"PRId64" system calls (%.2f per call)\n",
+               s->nb_datagrams, h->flags & AVIO_FLAG_READ ? "received" : "sent",
+               s->nb_syscalls, (double)s->nb_datagrams / s->nb_syscalls);
+
     closesocket(s->udp_fd);
     av_fifo_freep2(&s->rx_fifo);
     av_fifo_freep2(&s->tx_fifo);
+    udp_batch_free(s);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
@@ -26,6 +26,7 @@
 
 #include "avio.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -83,6 +84,18 @@ typedef struct URLProtocol {
     int (*url_get_multi_file_handle)(URLContext *h, int **handles,
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
+    /**
+     * Get a read-only buffer holding size bytes of the resource at offset
+     * pos, as used by url_seek(), without reading them, e.g. by mapping
+     * them in memory. The data must be followed by
+     * AV_INPUT_BUFFER_PADDING_SIZE readable bytes, which are zeroed at the
+     * end of the resource and hold its next bytes elsewhere.
+     *
+     * @return 0 on success, AVERROR(ENOSYS) if the range can not be
+     *         provided this way, or another negative error code
+     */
+    int (*url_map)(URLContext *h, int64_t pos, int size,
+                   AVBufferRef **buf, uint8_t **data);
     int (*url_shutdown)(URLContext *h, int flags);
     const AVClass *priv_data_class;
     int priv_data_size;
@@ -23,6 +23,7 @@
 #include <time.h>
 
 #include "config.h"
+#include "config_components.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
@@ -39,6 +40,7 @@
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "internal.h"
 #if CONFIG_NETWORK
 #include "network.h"
@@ -108,6 +110,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
     pkt->pos  = avio_tell(s);
 
+    if (size > 0) {
+        int ret = ffio_read_mapped(s, size, &pkt->buf, &pkt->data);
+        if (ret != AVERROR(ENOSYS)) {
+            if (ret >= 0)
+                pkt->size = ret;
+            return ret;
+        }
+    }
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -573,6 +584,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_close();
+#endif
     ff_network_close();
     ff_tls_deinit();
 #endif
@@ -276,6 +276,9 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->nb_cache_hits, 0);
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++)
+        atomic_init(&pool->cache[i].entry, 0);
 
     return pool;
 }
@@ -295,12 +298,24 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->nb_cache_hits, 0);
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++)
+        atomic_init(&pool->cache[i].entry, 0);
 
     return pool;
 }
 
 static void buffer_pool_flush(AVBufferPool *pool)
 {
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        BufferPoolEntry *buf = (BufferPoolEntry*)atomic_exchange_explicit(&pool->cache[i].entry, 0,
+                                                                          memory_order_acquire);
+        if (buf) {
+            buf->free(buf->opaque, buf->data);
+            av_freep(&buf);
+        }
+    }
+
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
@@ -342,15 +357,39 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
+/*
+ * Index of the first cache slot probed by the calling thread. The stack
+ * address differs between threads, so that concurrent threads mostly start
+ * on different slots.
+ */
+static unsigned pool_cache_start(const void *stack)
+{
+    return ((uint64_t)(uintptr_t)stack * 0x9E3779B97F4A7C15ULL) >> 32;
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
     AVBufferPool *pool = buf->pool;
+    unsigned start = pool_cache_start(&buf);
+    int i;
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    for (i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        atomic_uintptr_t *slot = &pool->cache[(start + i) % BUFFER_POOL_CACHE_SIZE].entry;
+        uintptr_t expected = 0;
+
+        if (atomic_compare_exchange_strong_explicit(slot, &expected, (uintptr_t)buf,
+                                                    memory_order_release,
+                                                    memory_order_relaxed))
+            break;
+    }
+
+    if (i == BUFFER_POOL_CACHE_SIZE) {
+        ff_mutex_lock(&pool->mutex);
+        buf->next = pool->pool;
+        pool->pool = buf;
+        ff_mutex_unlock(&pool->mutex);
+    }
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -387,33 +426,83 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     return ret;
 }
 
-AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
+static AVBufferRef *pool_reuse_buffer(AVBufferPool *pool, BufferPoolEntry *buf)
 {
     AVBufferRef *ret;
+
+    memset(&buf->buffer, 0, sizeof(buf->buffer));
+    ret = buffer_create(&buf->buffer, buf->data, pool->size,
+                        pool_release_buffer, buf, 0);
+    if (ret)
+        buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
+    return ret;
+}
+
+AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
+{
+    AVBufferRef *ret = NULL;
     BufferPoolEntry *buf;
+    unsigned start = pool_cache_start(&buf);
+
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        atomic_uintptr_t *slot = &pool->cache[(start + i) % BUFFER_POOL_CACHE_SIZE].entry;
+
+        if (!atomic_load_explicit(slot, memory_order_relaxed))
+            continue;
+
+        buf = (BufferPoolEntry*)atomic_exchange_explicit(slot, 0, memory_order_acquire);
+        if (buf) {
+            ret = pool_reuse_buffer(pool, buf);
+            if (!ret) {
+                ff_mutex_lock(&pool->mutex);
+                buf->next = pool->pool;
+                pool->pool = buf;
+                ff_mutex_unlock(&pool->mutex);
+                return NULL;
+            }
+            atomic_fetch_add_explicit(&pool->nb_cache_hits, 1, memory_order_relaxed);
+            goto end;
+        }
+    }
 
     ff_mutex_lock(&pool->mutex);
+    pool->nb_cache_misses++;
     buf = pool->pool;
     if (buf) {
-        memset(&buf->buffer, 0, sizeof(buf->buffer));
-        ret = buffer_create(&buf->buffer, buf->data, pool->size,
-                            pool_release_buffer, buf, 0);
+        ret = pool_reuse_buffer(pool, buf);
         if (ret) {
             pool->pool = buf->next;
             buf->next = NULL;
-            buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
         }
     } else {
         ret = pool_alloc_buffer(pool);
+        if (ret)
+            pool->nb_allocs++;
     }
     ff_mutex_unlock(&pool->mutex);
 
+end:
+
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
 
     return ret;
 }
 
+void av_buffer_pool_get_stats(AVBufferPool *pool, uint64_t *nb_hits,
+                              uint64_t *nb_misses, uint64_t *nb_allocs)
+{
+    if (nb_hits)
+        *nb_hits = atomic_load_explicit(&pool->nb_cache_hits, memory_order_relaxed);
+
+    ff_mutex_lock(&pool->mutex);
+    if (nb_misses)
+        *nb_misses = pool->nb_cache_misses;
+    if (nb_allocs)
+        *nb_allocs = pool->nb_allocs;
+    ff_mutex_unlock(&pool->mutex);
+}
+
 void *av_buffer_pool_buffer_get_opaque(const AVBufferRef *ref)
 {
     BufferPoolEntry *buf = ref->buffer->opaque;
@@ -244,7 +244,8 @@ int av_buffer_replace(AVBufferRef **dst, const AVBufferRef *src);
  *
  * Allocating and releasing buffers with this API is thread-safe as long as
  * either the default alloc callback is used, or the user-supplied one is
- * thread-safe.
+ * thread-safe. A small number of released buffers is kept in a lock-free
+ * cache, so that recycling them does not serialize the calling threads.
  */
 
 /**
@@ -302,6 +303,20 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Get statistics about the buffers returned by av_buffer_pool_get() so far.
+ * This function may be called simultaneously with av_buffer_pool_get().
+ *
+ * @param nb_hits if non-NULL, set to the number of buffers reused from the
+ *                lock-free cache of the pool
+ * @param nb_misses if non-NULL, set to the number of calls that found the
+ *                  cache empty and had to lock the pool
+ * @param nb_allocs if non-NULL, set to the number of those calls that had to
+ *                  allocate a new buffer
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, uint64_t *nb_hits,
+                              uint64_t *nb_misses, uint64_t *nb_allocs);
+
 /**
  * Query the original opaque parameter of an allocated buffer in the pool.
  *
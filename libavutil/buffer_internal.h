@@ -23,6 +23,7 @@
 #include <stdint.h>
 
 #include "buffer.h"
+#include "mem_internal.h"
 #include "thread.h"
 
 /**
@@ -35,6 +36,11 @@
  */
 #define BUFFER_FLAG_NO_FREE       (1 << 1)
 
+/**
+ * Number of lock-free slots in front of the locked free list of a pool.
+ */
+#define BUFFER_POOL_CACHE_SIZE 8
+
 struct AVBuffer {
     uint8_t *data; /**< data described by this buffer */
     size_t size; /**< size of data in bytes */
@@ -85,10 +91,35 @@ typedef struct BufferPoolEntry {
     AVBuffer buffer;
 } BufferPoolEntry;
 
+/*
+ * A slot of the lock-free cache of a pool, alone in its cache line, so that
+ * threads using different slots do not keep stealing the line from each
+ * other.
+ */
+typedef struct BufferPoolSlot {
+    DECLARE_ALIGNED_T(64, atomic_uintptr_t, entry);
+} BufferPoolSlot;
+
 struct AVBufferPool {
+    /*
+     * Released entries are first stored in one of these slots, which are
+     * accessed with atomic exchanges only, so that buffers can be recycled
+     * without taking the mutex. The mutex-protected list below is used when
+     * all slots are full on release or empty on get.
+     */
+    BufferPoolSlot cache[BUFFER_POOL_CACHE_SIZE];
+
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Statistics for av_buffer_pool_get_stats(). The miss counters are
+     * protected by mutex.
+     */
+    atomic_uint_least64_t nb_cache_hits;
+    uint64_t nb_cache_misses;
+    uint64_t nb_allocs;
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
@@ -0,0 +1,183 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/macros.h"
+#include "libavutil/thread.h"
+
+#define BUF_SIZE    64
+#define NB_BUFS     11
+#define NB_THREADS  4
+#define NB_ITERS    10000
+#define NB_HELD     2
+
+static void print_stats(AVBufferPool *pool, const char *step)
+{
+    uint64_t hits, misses, allocs;
+
+    av_buffer_pool_get_stats(pool, &hits, &misses, &allocs);
+    printf("%-24s hits %"PRIu64" misses %"PRIu64" allocs %"PRIu64"\n",
+           step, hits, misses, allocs);
+}
+
+static int test_sequential(void)
+{
+    AVBufferRef *bufs[NB_BUFS] = { NULL };
+    AVBufferPool *pool;
+    uint8_t *data;
+    int ret = 1;
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+
+    bufs[0] = av_buffer_pool_get(pool);
+    if (!bufs[0])
+        goto end;
+    data = bufs[0]->data;
+    print_stats(pool, "first get");
+
+    av_buffer_unref(&bufs[0]);
+    bufs[0] = av_buffer_pool_get(pool);
+    if (!bufs[0])
+        goto end;
+    print_stats(pool, "get after release");
+    if (bufs[0]->data != data) {
+        printf("released buffer not reused\n");
+        goto end;
+    }
+
+    for (int i = 1; i < NB_BUFS; i++)
+        if (!(bufs[i] = av_buffer_pool_get(pool)))
+            goto end;
+    print_stats(pool, "get while all held");
+
+    /* more buffers than cache slots, the rest go to the locked list */
+    for (int i = 0; i < NB_BUFS; i++)
+        av_buffer_unref(&bufs[i]);
+    for (int i = 0; i < NB_BUFS; i++)
+        if (!(bufs[i] = av_buffer_pool_get(pool)))
+            goto end;
+    print_stats(pool, "get all after release");
+
+    ret = 0;
+end:
+    for (int i = 0; i < NB_BUFS; i++)
+        av_buffer_unref(&bufs[i]);
+    av_buffer_pool_uninit(&pool);
+    return ret;
+}
+
+typedef struct ThreadContext {
+    AVBufferPool *pool;
+    int id;
+    int ret;
+} ThreadContext;
+
+static void *thread_main(void *arg)
+{
+    ThreadContext *t = arg;
+
+    for (int i = 0; i < NB_ITERS; i++) {
+        AVBufferRef *bufs[NB_HELD];
+        int tag = t->id * NB_ITERS + i;
+
+        for (int j = 0; j < NB_HELD; j++) {
+            bufs[j] = av_buffer_pool_get(t->pool);
+            if (!bufs[j]) {
+                t->ret = 1;
+                return NULL;
+            }
+            memset(bufs[j]->data, 0, BUF_SIZE);
+            memcpy(bufs[j]->data, &tag, sizeof(tag));
+            bufs[j]->data[sizeof(tag)] = j;
+        }
+
+        /* a buffer handed out twice is overwritten by the other owner */
+        for (int j = 0; j < NB_HELD; j++) {
+            int val;
+            memcpy(&val, bufs[j]->data, sizeof(val));
+            if (val != tag || bufs[j]->data[sizeof(tag)] != j)
+                t->ret = 1;
+            av_buffer_unref(&bufs[j]);
+        }
+    }
+
+    return NULL;
+}
+
+static int test_threads(void)
+{
+    ThreadContext t[NB_THREADS];
+    uint64_t hits, misses, allocs;
+    AVBufferPool *pool;
+    int ret = 0;
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+
+    for (int i = 0; i < NB_THREADS; i++)
+        t[i] = (ThreadContext) { .pool = pool, .id = i };
+
+#if HAVE_THREADS
+    {
+        pthread_t threads[NB_THREADS];
+        int nb_threads;
+
+        for (nb_threads = 0; nb_threads < NB_THREADS; nb_threads++) {
+            if (pthread_create(&threads[nb_threads], NULL, thread_main,
+                               &t[nb_threads])) {
+                ret = 1;
+                break;
+            }
+        }
+        for (int i = 0; i < nb_threads; i++)
+            pthread_join(threads[i], NULL);
+    }
+#else
+    for (int i = 0; i < NB_THREADS; i++)
+        thread_main(&t[i]);
+#endif
+
+    for (int i = 0; i < NB_THREADS; i++)
+        ret |= t[i].ret;
+
+    av_buffer_pool_get_stats(pool, &hits, &misses, &allocs);
+    if (hits + misses != (uint64_t)NB_THREADS * NB_ITERS * NB_HELD ||
+        allocs > misses || allocs < NB_HELD)
+        ret = 1;
+
+    printf("concurrent gets: %s\n", ret ? "failed" : "ok");
+
+    av_buffer_pool_uninit(&pool);
+    return ret;
+}
+
+int main(void)
+{
+    if (test_sequential())
+        return 1;
+    if (test_threads())
+        return 1;
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check the real to complex and complex to real DFTs against a naive DFT,
+ * including lengths where the half-length complex FFT has an odd length.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "libavutil/error.h"
+#include "libavutil/lfg.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/tx.h"
+
+static const int lengths[] = {
+    /* the half-length is odd */
+    6, 10, 14, 30, 90, 1022,
+    /* the half-length is even */
+    4, 8, 60, 1024,
+};
+
+/* maximum error relative to the RMS value of the reference */
+#define MAX_ERR_FLOAT  1e-5
+#define MAX_ERR_DOUBLE 1e-12
+
+/**
+ * Compute a forward DFT of len real samples into len / 2 + 1 bins, or an
+ * inverse DFT of len / 2 + 1 bins into len real samples.
+ */
+static void naive_rdft(double *out, const double *in, int len, int inv)
+{
+    if (!inv) {
+        for (int k = 0; k <= len / 2; k++) {
+            double re = 0.0, im = 0.0;
+            for (int n = 0; n < len; n++) {
+                double phi = -2.0 * M_PI * ((int64_t)k * n % len) / len;
+                re += in[n] * cos(phi);
+                im += in[n] * sin(phi);
+            }
+            out[2 * k]     = re;
+            out[2 * k + 1] = im;
+        }
+    } else {
+        for (int n = 0; n < len; n++) {
+            double sum = in[0] + ((n & 1) ? -in[len] : in[len]);
+            for (int k = 1; k < len / 2; k++) {
+                double phi = 2.0 * M_PI * ((int64_t)k * n % len) / len;
+                sum += 2.0 * (in[2 * k] * cos(phi) - in[2 * k + 1] * sin(phi));
+            }
+            out[n] = sum;
+        }
+    }
+}
+
+static double get_error(const double *ref, const double *out, int nb)
+{
+    double sse = 0.0, sum = 0.0;
+
+    for (int i = 0; i < nb; i++) {
+        sse += (out[i] - ref[i]) * (out[i] - ref[i]);
+        sum += ref[i] * ref[i];
+    }
+
+    return sum ? sqrt(sse / sum) : sqrt(sse);
+}
+
+static int run_test(enum AVTXType type, int len, int inv, AVLFG *lfg)
+{
+    const int is_double = type == AV_TX_DOUBLE_RDFT;
+    const size_t el_size = is_double ? sizeof(double) : sizeof(float);
+    /* complex values for the bins, real samples otherwise, both with room
+     * for the len / 2 + 1 bins */
+    const int nb_in  = inv ? len + 2 : len;
+    const int nb_out = inv ? len     : len + 2;
+    const double max_err = is_double ? MAX_ERR_DOUBLE : MAX_ERR_FLOAT;
+    double scale_d = 1.0;
+    float  scale_f = 1.0f;
+    AVTXContext *tx = NULL;
+    av_tx_fn fn;
+    double *ref_in, *ref_out, *out_d;
+    void *in, *out;
+    double err;
+    int ret;
+
+    ref_in  = av_malloc_array(len + 2, sizeof(*ref_in));
+    ref_out = av_malloc_array(len + 2, sizeof(*ref_out));
+    out_d   = av_malloc_array(len + 2, sizeof(*out_d));
+    in      = av_malloc_array(len + 2, el_size);
+    out     = av_malloc_array(len + 2, el_size);
+    if (!ref_in || !ref_out || !out_d || !in || !out) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (int i = 0; i < nb_in; i++)
+        ref_in[i] = av_lfg_get(lfg) / (double)UINT32_MAX * 2.0 - 1.0;
+    if (inv) {
+        /* the imaginary part of the DC and Nyquist bins is ignored */
+        ref_in[1]       = 0.0;
+        ref_in[len + 1] = 0.0;
+    }
+
+    for (int i = 0; i < nb_in; i++) {
+        if (is_double)
+            ((double *)in)[i] = ref_in[i];
+        else
+            ((float *)in)[i] = ref_in[i];
+        /* round the reference input like the tested one */
+        if (!is_double)
+            ref_in[i] = ((float *)in)[i];
+    }
+
+    ret = av_tx_init(&tx, &fn, type, inv, len,
+                     is_double ? (void *)&scale_d : (void *)&scale_f, 0);
+    if (ret < 0)
+        goto end;
+
+    fn(tx, out, in, inv ? 2 * el_size : el_size);
+
+    naive_rdft(ref_out, ref_in, len, inv);
+    for (int i = 0; i < nb_out; i++)
+        out_d[i] = is_double ? ((double *)out)[i] : ((float *)out)[i];
+
+    err = get_error(ref_out, out_d, nb_out);
+
+    printf("%s rdft %d %s: ", is_double ? "double" : "float", len,
+           inv ? "inverse" : "forward");
+    if (err > max_err) {
+        printf("error %g above %g\n", err, max_err);
+        ret = AVERROR_BUG;
+    } else {
+        printf("ok\n");
+    }
+
+end:
+    av_tx_uninit(&tx);
+    av_free(ref_in);
+    av_free(ref_out);
+    av_free(out_d);
+    av_free(in);
+    av_free(out);
+    return ret;
+}
+
+int main(void)
+{
+    static const enum AVTXType types[] = { AV_TX_FLOAT_RDFT, AV_TX_DOUBLE_RDFT };
+    AVLFG lfg;
+    int ret = 0;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    for (int t = 0; t < FF_ARRAY_ELEMS(types); t++) {
+        for (int l = 0; l < FF_ARRAY_ELEMS(lengths); l++) {
+            for (int inv = 0; inv <= 1; inv++) {
+                int err = run_test(types[t], lengths[l], inv, &lfg);
+                if (err < 0 && err != AVERROR_BUG) {
+                    fprintf(stderr, "Error: %s\n", av_err2str(err));
+                    return 1;
+                }
+                if (err < 0)
+                    ret = 1;
+            }
+        }
+    }
+
+    return ret;
+}
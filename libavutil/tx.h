@@ -80,7 +80,7 @@ enum AVTXType {
      * to the spacing between two complex values in bytes.
      *
      * The forward transform performs a real-to-complex DFT of N samples to
-     * N/2+1 complex values.
+     * N/2+1 complex values. N must be even.
      *
      * The inverse transform performs a complex-to-real DFT of N/2+1 complex
      * values to N real samples. The output is not normalized, but can be
@@ -1658,9 +1658,10 @@ static void TX_NAME(ff_tx_rdft_ ##n)(AVTXContext *s, void *_dst,               \
 {                                                                              \
     const int len2 = s->len >> 1;                                              \
     const int len4 = s->len >> 2;                                              \
+    const int odd  = len2 & 1;                                                 \
     const TXSample *fact = (void *)s->exp;                                     \
     const TXSample *tcos = fact + 8;                                           \
-    const TXSample *tsin = tcos + len4;                                        \
+    const TXSample *tsin = tcos + len4 + odd;                                  \
     TXComplex *data = inv ? _src : _dst;                                       \
     TXComplex t[3];                                                            \
                                                                                \
@@ -1670,17 +1671,20 @@ static void TX_NAME(ff_tx_rdft_ ##n)(AVTXContext *s, void *_dst,               \
         data[0].im = data[len2].re;                                            \
                                                                                \
     /* The DC value's both components are real, but we need to change them     \
-     * into complex values. Also, the middle of the array is special-cased.    \
+     * into complex values. Also, the middle of the array is special-cased,    \
+     * unless the half-length is odd, in which case there is no middle.        \
      * These operations can be done before or after the loop. */               \
     t[0].re = data[0].re;                                                      \
     data[0].re = t[0].re + data[0].im;                                         \
     data[0].im = t[0].re - data[0].im;                                         \
     data[   0].re = MULT(fact[0], data[   0].re);                              \
     data[   0].im = MULT(fact[1], data[   0].im);                              \
-    data[len4].re = MULT(fact[2], data[len4].re);                              \
-    data[len4].im = MULT(fact[3], data[len4].im);                              \
+    if (!odd) {                                                                \
+        data[len4].re = MULT(fact[2], data[len4].re);                          \
+        data[len4].im = MULT(fact[3], data[len4].im);                          \
+    }                                                                          \
                                                                                \
-    for (int i = 1; i < len4; i++) {                                           \
+    for (int i = 1; i < len4 + odd; i++) {                                     \
         /* Separate even and odd FFTs */                                       \
         t[0].re = MULT(fact[4], (data[i].re + data[len2 - i].re));             \
         t[0].im = MULT(fact[5], (data[i].im - data[len2 - i].im));             \
@@ -1711,7 +1715,7 @@ static const FFTXCodelet TX_NAME(ff_tx_rdft_ ##n## _def) = {                   \
     .type       = TX_TYPE(RDFT),                                               \
     .flags      = AV_TX_UNALIGNED | AV_TX_INPLACE | FF_TX_OUT_OF_PLACE |       \
                   (inv ? FF_TX_INVERSE_ONLY : FF_TX_FORWARD_ONLY),             \
-    .factors    = { 4, TX_FACTOR_ANY },                                        \
+    .factors    = { 2, TX_FACTOR_ANY },                                        \
     .nb_factors = 2,                                                           \
     .min_len    = 4,                                                           \
     .max_len    = TX_LEN_UNLIMITED,                                            \
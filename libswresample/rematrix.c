@@ -490,6 +490,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
             s->mix_2_1_f = sum2_clip_s16;
             s->mix_any_f = get_mix_any_func_clip_s16(s);
         }
+        s->mix_n_1_f = mix_n_1_s16;
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_FLTP){
         s->native_matrix = av_calloc(nb_in * nb_out, sizeof(float));
         if (!s->native_matrix)
@@ -501,6 +502,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         s->mix_1_1_f = copy_float;
         s->mix_2_1_f = sum2_float;
         s->mix_any_f = get_mix_any_func_float(s);
+        s->mix_n_1_f = mix_n_1_float;
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_DBLP){
         s->native_matrix = av_calloc(nb_in * nb_out, sizeof(double));
         if (!s->native_matrix)
@@ -512,6 +514,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         s->mix_1_1_f = copy_double;
         s->mix_2_1_f = sum2_double;
         s->mix_any_f = get_mix_any_func_double(s);
+        s->mix_n_1_f = mix_n_1_double;
     }else if(s->midbuf.fmt == AV_SAMPLE_FMT_S32P){
         s->native_matrix = av_calloc(nb_in * nb_out, sizeof(int));
         if (!s->native_matrix)
@@ -529,6 +532,7 @@ av_cold int swri_rematrix_init(SwrContext *s){
         s->mix_1_1_f = copy_s32;
         s->mix_2_1_f = sum2_s32;
         s->mix_any_f = get_mix_any_func_s32(s);
+        s->mix_n_1_f = mix_n_1_s32;
     }else
         av_assert0(0);
     //FIXME quantize for integeres
@@ -565,7 +569,7 @@ av_cold void swri_rematrix_free(SwrContext *s){
 }
 
 int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
+    int out_i, in_i;
     int len1 = 0;
     int off = 0;
 
@@ -611,35 +615,17 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
             if(len != len1)
                 s->mix_2_1_f   (out->ch[out_i]+off, in->ch[in_i1]+off, in->ch[in_i2]+off, s->native_matrix, in->ch_count*out_i + in_i1, in->ch_count*out_i + in_i2, len-len1);
             break;}
-        default:
+        default: {
+            const void *coeffp;
             if(s->int_sample_fmt == AV_SAMPLE_FMT_FLTP){
-                for(i=0; i<len; i++){
-                    float v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((float*)in->ch[in_i])[i] * s->matrix_flt[out_i][in_i];
-                    }
-                    ((float*)out->ch[out_i])[i]= v;
-                }
+                coeffp = s->matrix_flt[out_i];
             }else if(s->int_sample_fmt == AV_SAMPLE_FMT_DBLP){
-                for(i=0; i<len; i++){
-                    double v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((double*)in->ch[in_i])[i] * s->matrix[out_i][in_i];
-                    }
-                    ((double*)out->ch[out_i])[i]= v;
-                }
+                coeffp = s->matrix[out_i];
             }else{
-                for(i=0; i<len; i++){
-                    int v=0;
-                    for(j=0; j<s->matrix_ch[out_i][0]; j++){
-                        in_i= s->matrix_ch[out_i][1+j];
-                        v+= ((int16_t*)in->ch[in_i])[i] * s->matrix32[out_i][in_i];
-                    }
-                    ((int16_t*)out->ch[out_i])[i]= (v + 16384)>>15;
-                }
+                coeffp = s->matrix32[out_i];
             }
+            s->mix_n_1_f(out->ch[out_i], (const uint8_t *const *)in->ch, coeffp, s->matrix_ch[out_i], len);
+            break;}
         }
     }
     return 0;
@@ -105,6 +105,67 @@ static void RENAME(mix8to2)(uint8_t *const *out_, const uint8_t *const *in_,
     }
 }
 
+#ifndef TEMPLATE_CLIP
+#define MIX_N_1_BLOCK 256
+
+/**
+ * Mix the in_ch[0] input channels listed in in_ch[1..] into one output
+ * channel, coeffp being indexed by input channel. The sum is built block
+ * by block, adding up to four inputs per pass in the same order as a plain
+ * per-sample loop would.
+ */
+static void RENAME(mix_n_1)(void *out_, const uint8_t *const *in_, const void *coeffp_,
+                            const uint8_t *in_ch, integer len)
+{
+    const SAMPLE *const *const in = (const SAMPLE *const *)in_;
+    const COEFF *coeffp = coeffp_;
+    const int nb_in = in_ch[0];
+    SAMPLE *out = out_;
+    INTER sum[MIX_N_1_BLOCK];
+
+    for (integer pos = 0; pos < len; pos += MIX_N_1_BLOCK) {
+        const int n = FFMIN(MIX_N_1_BLOCK, len - pos);
+        const SAMPLE *in0 = in[in_ch[1]] + pos;
+        const INTER coeff0 = coeffp[in_ch[1]];
+        int j;
+
+        for (int i = 0; i < n; i++)
+            sum[i] = in0[i] * coeff0;
+
+        for (j = 2; j + 3 <= nb_in; j += 4) {
+            const SAMPLE *in1 = in[in_ch[j    ]] + pos;
+            const SAMPLE *in2 = in[in_ch[j + 1]] + pos;
+            const SAMPLE *in3 = in[in_ch[j + 2]] + pos;
+            const SAMPLE *in4 = in[in_ch[j + 3]] + pos;
+            const INTER coeff1 = coeffp[in_ch[j    ]];
+            const INTER coeff2 = coeffp[in_ch[j + 1]];
+            const INTER coeff3 = coeffp[in_ch[j + 2]];
+            const INTER coeff4 = coeffp[in_ch[j + 3]];
+
+            for (int i = 0; i < n; i++) {
+                INTER v = sum[i];
+                v += in1[i] * coeff1;
+                v += in2[i] * coeff2;
+                v += in3[i] * coeff3;
+                v += in4[i] * coeff4;
+                sum[i] = v;
+            }
+        }
+
+        for (; j <= nb_in; j++) {
+            const SAMPLE *in1 = in[in_ch[j]] + pos;
+            const INTER coeff1 = coeffp[in_ch[j]];
+
+            for (int i = 0; i < n; i++)
+                sum[i] += in1[i] * coeff1;
+        }
+
+        for (int i = 0; i < n; i++)
+            out[pos + i] = R(sum[i]);
+    }
+}
+#endif
+
 static mix_any_func_type *RENAME(get_mix_any_func)(const SwrContext *s)
 {
     if (  !av_channel_layout_compare(&s->out_ch_layout, &(AVChannelLayout)AV_CHANNEL_LAYOUT_STEREO)
@@ -57,6 +57,10 @@ typedef struct ResampleContext {
                                const void *src, int n, int update_ctx);
         int (*resample_linear)(struct ResampleContext *c, void *dst,
                                const void *src, int n, int update_ctx);
+        /* optional, processes all channels in one call like resample_common */
+        int (*resample_common_multi)(struct ResampleContext *c, uint8_t * const *dst,
+                                     uint8_t * const *src, int nb_channels,
+                                     int n, int update_ctx);
     } dsp;
 } ResampleContext;
 
@@ -140,6 +140,111 @@ static int RENAME(resample_common)(ResampleContext *c,
     return sample_index;
 }
 
+/**
+ * Same as resample_common(), but for all channels at once. The filter phase
+ * is computed once per output sample and its coefficients are applied to
+ * four channels at a time, which shares the coefficient loads and gives the
+ * CPU several independent accumulation chains to work on.
+ */
+static int RENAME(resample_common_multi)(ResampleContext *c,
+                                         uint8_t * const *dest,
+                                         uint8_t * const *source,
+                                         int nb_channels, int n, int update_ctx)
+{
+    int dst_index;
+    int index= c->index;
+    int frac= c->frac;
+    int sample_index = 0;
+
+    while (index >= c->phase_count) {
+        sample_index++;
+        index -= c->phase_count;
+    }
+
+    for (dst_index = 0; dst_index < n; dst_index++) {
+        FELEM *filter = ((FELEM *) c->filter_bank) + c->filter_alloc * index;
+        int ch = 0;
+
+        for (; ch + 4 <= nb_channels; ch += 4) {
+            const DELEM *src0 = (const DELEM *) source[ch    ] + sample_index;
+            const DELEM *src1 = (const DELEM *) source[ch + 1] + sample_index;
+            const DELEM *src2 = (const DELEM *) source[ch + 2] + sample_index;
+            const DELEM *src3 = (const DELEM *) source[ch + 3] + sample_index;
+            FELEM2 val0 = FOFFSET, val1 = FOFFSET, val2 = FOFFSET, val3 = FOFFSET;
+            FELEM2 odd0 = 0, odd1 = 0, odd2 = 0, odd3 = 0;
+            int i;
+
+            /* keep the even/odd split of resample_common() for identical output */
+            for (i = 0; i + 1 < c->filter_length; i += 2) {
+                FELEM2 f0 = filter[i], f1 = filter[i + 1];
+                val0 += src0[i] * f0;
+                odd0 += src0[i + 1] * f1;
+                val1 += src1[i] * f0;
+                odd1 += src1[i + 1] * f1;
+                val2 += src2[i] * f0;
+                odd2 += src2[i + 1] * f1;
+                val3 += src3[i] * f0;
+                odd3 += src3[i + 1] * f1;
+            }
+            if (i < c->filter_length) {
+                FELEM2 f0 = filter[i];
+                val0 += src0[i] * f0;
+                val1 += src1[i] * f0;
+                val2 += src2[i] * f0;
+                val3 += src3[i] * f0;
+            }
+#ifdef FELEML
+            OUT(((DELEM *) dest[ch    ])[dst_index], val0 + (FELEML)odd0);
+            OUT(((DELEM *) dest[ch + 1])[dst_index], val1 + (FELEML)odd1);
+            OUT(((DELEM *) dest[ch + 2])[dst_index], val2 + (FELEML)odd2);
+            OUT(((DELEM *) dest[ch + 3])[dst_index], val3 + (FELEML)odd3);
+#else
+            OUT(((DELEM *) dest[ch    ])[dst_index], val0 + odd0);
+            OUT(((DELEM *) dest[ch + 1])[dst_index], val1 + odd1);
+            OUT(((DELEM *) dest[ch + 2])[dst_index], val2 + odd2);
+            OUT(((DELEM *) dest[ch + 3])[dst_index], val3 + odd3);
+#endif
+        }
+
+        for (; ch < nb_channels; ch++) {
+            const DELEM *src = (const DELEM *) source[ch] + sample_index;
+            FELEM2 val = FOFFSET;
+            FELEM2 val2= 0;
+            int i;
+            for (i = 0; i + 1 < c->filter_length; i+=2) {
+                val  += src[i    ] * (FELEM2)filter[i    ];
+                val2 += src[i + 1] * (FELEM2)filter[i + 1];
+            }
+            if (i < c->filter_length)
+                val  += src[i    ] * (FELEM2)filter[i    ];
+#ifdef FELEML
+            OUT(((DELEM *) dest[ch])[dst_index], val + (FELEML)val2);
+#else
+            OUT(((DELEM *) dest[ch])[dst_index], val + val2);
+#endif
+        }
+
+        frac  += c->dst_incr_mod;
+        index += c->dst_incr_div;
+        if (frac >= c->src_incr) {
+            frac -= c->src_incr;
+            index++;
+        }
+
+        while (index >= c->phase_count) {
+            sample_index++;
+            index -= c->phase_count;
+        }
+    }
+
+    if(update_ctx){
+        c->frac= frac;
+        c->index= index;
+    }
+
+    return sample_index;
+}
+
 static int RENAME(resample_linear)(ResampleContext *c,
                                    void *dest, const void *source,
                                    int n, int update_ctx)
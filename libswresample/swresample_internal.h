@@ -42,6 +42,8 @@ typedef void (mix_2_1_func_type)(void *out, const void *in1, const void *in2, co
 
 typedef void (mix_any_func_type)(uint8_t *const *out, const uint8_t *const *in1, const void *coeffp, integer len);
 
+typedef void (mix_n_1_func_type)(void *out, const uint8_t *const *in, const void *coeffp, const uint8_t *in_ch, integer len);
+
 typedef struct AudioData{
     uint8_t *ch[SWR_CH_MAX];    ///< samples buffer per channel
     uint8_t *data;              ///< samples buffer
@@ -193,6 +195,8 @@ struct SwrContext {
 
     mix_any_func_type *mix_any_f;
 
+    mix_n_1_func_type *mix_n_1_f;                   ///< mix the inputs listed in matrix_ch into one output
+
     /* TODO: callbacks for ASM optimizations */
 };
 
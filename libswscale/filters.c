@@ -0,0 +1,371 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/refstruct.h"
+
+#include "filters.h"
+#include "swscale.h"
+
+/* Edge taps are dropped for as long as their summed magnitude stays below
+ * this, the same as SWS_MAX_REDUCE_CUTOFF in the legacy scaler */
+#define WEIGHT_CUTOFF 0.002
+
+typedef struct FilterKernel {
+    const char *name;
+    double radius;  /* support of the kernel, before stretching */
+    bool widen;     /* stretch the kernel when downscaling */
+    double p[2];
+    double (*eval)(const struct FilterKernel *k, double x); /* x >= 0 */
+} FilterKernel;
+
+static double eval_point(const FilterKernel *k, double x)
+{
+    return 1.0;
+}
+
+static double eval_bilinear(const FilterKernel *k, double x)
+{
+    return FFMAX(1.0 - x, 0.0);
+}
+
+/* Mitchell-Netravali family of cubics, B = p[0], C = p[1] */
+static double eval_bicubic(const FilterKernel *k, double x)
+{
+    const double B = k->p[0], C = k->p[1];
+    if (x < 1.0) {
+        return ((12 - 9 * B - 6 * C) * x * x * x +
+                (-18 + 12 * B + 6 * C) * x * x +
+                (6 - 2 * B)) / 6;
+    } else if (x < 2.0) {
+        return ((-B - 6 * C) * x * x * x +
+                (6 * B + 30 * C) * x * x +
+                (-12 * B - 48 * C) * x +
+                (8 * B + 24 * C)) / 6;
+    }
+    return 0.0;
+}
+
+static double eval_gauss(const FilterKernel *k, double x)
+{
+    return exp2(-k->p[0] * x * x);
+}
+
+static double sinc(double x)
+{
+    return x ? sin(x * M_PI) / (x * M_PI) : 1.0;
+}
+
+static double eval_sinc(const FilterKernel *k, double x)
+{
+    return sinc(x);
+}
+
+static double eval_lanczos(const FilterKernel *k, double x)
+{
+    return x < k->p[0] ? sinc(x) * sinc(x / k->p[0]) : 0.0;
+}
+
+static double spline_coeff(double a, double b, double c, double d, double x)
+{
+    if (x <= 1.0)
+        return ((d * x + c) * x + b) * x + a;
+    return spline_coeff(0.0, b + 2.0 * c + 3.0 * d, c + 3.0 * d,
+                        -b - 3.0 * c - 6.0 * d, x - 1.0);
+}
+
+static double eval_spline(const FilterKernel *k, double x)
+{
+    const double p = -2.196152422706632;
+    return spline_coeff(1.0, 0.0, p, -p - 1.0, x);
+}
+
+/* Mirrors the scaler selection and default parameters of initFilter() */
+static int kernel_init(FilterKernel *k, unsigned flags, const double params[2])
+{
+#define PARAM(i, def) (params[i] != SWS_PARAM_DEFAULT ? params[i] : (def))
+    if (flags & SWS_POINT) {
+        *k = (FilterKernel) { "point", 0.5, false, {0}, eval_point };
+    } else if (flags & SWS_FAST_BILINEAR) {
+        *k = (FilterKernel) { "bilinear", 1.0, true, {0}, eval_bilinear };
+    } else if (flags & SWS_AREA) {
+        return AVERROR(ENOTSUP);
+    } else if (flags & SWS_BICUBIC) {
+        *k = (FilterKernel) { "bicubic", 2.0, true, { PARAM(0, 0.0), PARAM(1, 0.6) },
+                              eval_bicubic };
+    } else if (flags & SWS_BILINEAR) {
+        *k = (FilterKernel) { "bilinear", 1.0, true, {0}, eval_bilinear };
+    } else if (flags & SWS_GAUSS) {
+        *k = (FilterKernel) { "gauss", 4.0, true, { PARAM(0, 3.0) }, eval_gauss };
+    } else if (flags & SWS_LANCZOS) {
+        const double p = PARAM(0, 3.0);
+        if (p <= 0.0 || p > 25.0)
+            return AVERROR(EINVAL);
+        *k = (FilterKernel) { "lanczos", p, true, { p }, eval_lanczos };
+    } else if (flags & SWS_SINC) {
+        *k = (FilterKernel) { "sinc", 10.0, true, {0}, eval_sinc };
+    } else if (flags & SWS_SPLINE) {
+        *k = (FilterKernel) { "spline", 10.0, true, {0}, eval_spline };
+    } else {
+        /* SWS_X, SWS_BICUBLIN */
+        return AVERROR(ENOTSUP);
+    }
+#undef PARAM
+
+    return 0;
+}
+
+static void free_weights(AVRefStructOpaque opaque, void *obj)
+{
+    SwsFilterWeights *filter = obj;
+    av_freep(&filter->offsets);
+    av_freep(&filter->weights);
+}
+
+int ff_sws_filter_generate(void *log_ctx, unsigned flags, const double params[2],
+                           int src_size, int dst_size, SwsFilterWeights **out)
+{
+    SwsFilterWeights *filter;
+    FilterKernel kernel;
+    double *tmp = NULL;
+    int *window = NULL;
+    int ret, taps, size, num_weights = 1;
+
+    if (src_size <= 0 || dst_size <= 0)
+        return AVERROR(EINVAL);
+
+    ret = kernel_init(&kernel, flags, params);
+    if (ret < 0)
+        return ret;
+
+    const double ratio   = (double) src_size / dst_size;
+    const double stretch = kernel.widen ? FFMAX(ratio, 1.0) : 1.0;
+    const double radius  = kernel.radius * stretch;
+    taps = FFMAX((int) ceil(2.0 * radius), 1);
+    size = FFMIN(taps, src_size);
+    if (taps > 1024)
+        return AVERROR(EINVAL);
+
+    filter = av_refstruct_alloc_ext(sizeof(*filter), 0, NULL, free_weights);
+    if (!filter)
+        return AVERROR(ENOMEM);
+
+    av_strlcpy(filter->name, kernel.name, sizeof(filter->name));
+    filter->src_size = src_size;
+    filter->dst_size = dst_size;
+    filter->offsets  = av_malloc_array(dst_size, sizeof(*filter->offsets));
+    window = av_malloc_array(dst_size, sizeof(*window));
+    tmp = av_calloc((size_t) dst_size * size, sizeof(*tmp));
+    if (!filter->offsets || !window || !tmp) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (int i = 0; i < dst_size; i++) {
+        const double center = (i + 0.5) * ratio - 0.5;
+        const int start  = (int) floor(center - radius) + 1;
+        const int offset = av_clip(start, 0, src_size - size);
+        double *w = &tmp[i * size];
+        double sum = 0.0, cut;
+        int first, last;
+
+        /* Taps outside the image are folded into the edge sample */
+        for (int j = 0; j < taps; j++) {
+            const int idx = start + j;
+            const double x = fabs(idx - center) / stretch;
+            w[av_clip(idx, 0, src_size - 1) - offset] += kernel.eval(&kernel, x);
+        }
+
+        for (int j = 0; j < size; j++)
+            sum += w[j];
+        if (fabs(sum) < 1e-9) {
+            /* Degenerate kernel; fall back to nearest neighbour */
+            memset(w, 0, size * sizeof(*w));
+            w[av_clip(lrint(center), offset, offset + size - 1) - offset] = sum = 1.0;
+        }
+
+        for (int j = 0; j < size; j++)
+            w[j] /= sum;
+
+        cut = 0.0;
+        for (first = 0; first < size - 1; first++) {
+            cut += fabs(w[first]);
+            if (cut > WEIGHT_CUTOFF)
+                break;
+            w[first] = 0.0;
+        }
+
+        cut = 0.0;
+        for (last = size - 1; last > first; last--) {
+            cut += fabs(w[last]);
+            if (cut > WEIGHT_CUTOFF)
+                break;
+            w[last] = 0.0;
+        }
+
+        window[i] = offset;
+        filter->offsets[i] = offset + first;
+        num_weights = FFMAX(num_weights, last - first + 1);
+    }
+
+    filter->num_weights = num_weights;
+    filter->weights = av_calloc((size_t) dst_size * num_weights,
+                                sizeof(*filter->weights));
+    if (!filter->weights) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    /* Compact the filter down to the significant taps and renormalize */
+    for (int i = 0; i < dst_size; i++) {
+        const double *w = &tmp[i * size];
+        const int base   = window[i];
+        const int offset = FFMIN(filter->offsets[i], src_size - num_weights);
+        float *out = &filter->weights[i * num_weights];
+        double sum = 0.0;
+
+        for (int j = 0; j < num_weights; j++) {
+            const int k = offset + j - base;
+            if (k >= 0 && k < size)
+                sum += w[k];
+        }
+
+        for (int j = 0; j < num_weights; j++) {
+            const int k = offset + j - base;
+            if (k >= 0 && k < size)
+                out[j] = w[k] / sum;
+        }
+
+        filter->offsets[i] = offset;
+    }
+
+    av_log(log_ctx, AV_LOG_DEBUG, "Generated %s filter for %d -> %d, %d taps\n",
+           filter->name, src_size, dst_size, num_weights);
+
+    av_free(window);
+    av_free(tmp);
+    *out = filter;
+    return 0;
+
+fail:
+    av_free(window);
+    av_free(tmp);
+    av_refstruct_unref(&filter);
+    return ret;
+}
+
+static av_always_inline void
+filter_h(float *restrict dst, const float *restrict src,
+         const SwsFilterWeights *filter, const int num_weights)
+{
+    const float *weights = filter->weights;
+    const int *offsets = filter->offsets;
+
+    for (int x = 0; x < filter->dst_size; x++) {
+        const float *s = &src[offsets[x]];
+        const float *w = &weights[x * num_weights];
+        float sum = w[0] * s[0];
+        for (int j = 1; j < num_weights; j++)
+            sum += w[j] * s[j];
+        dst[x] = sum;
+    }
+}
+
+#define DECL_FILTER_H(N)                                                        \
+static void filter_h_##N(float *restrict dst, const float *restrict src,       \
+                         const SwsFilterWeights *filter)                       \
+{                                                                               \
+    filter_h(dst, src, filter, N);                                              \
+}
+
+DECL_FILTER_H(1)
+DECL_FILTER_H(2)
+DECL_FILTER_H(3)
+DECL_FILTER_H(4)
+DECL_FILTER_H(5)
+DECL_FILTER_H(6)
+DECL_FILTER_H(7)
+DECL_FILTER_H(8)
+
+void ff_sws_filter_h_f32(float *dst, const float *src,
+                         const SwsFilterWeights *filter)
+{
+    /* Dispatch to unrolled versions for the common filter sizes */
+    switch (filter->num_weights) {
+    case 1: filter_h_1(dst, src, filter); return;
+    case 2: filter_h_2(dst, src, filter); return;
+    case 3: filter_h_3(dst, src, filter); return;
+    case 4: filter_h_4(dst, src, filter); return;
+    case 5: filter_h_5(dst, src, filter); return;
+    case 6: filter_h_6(dst, src, filter); return;
+    case 7: filter_h_7(dst, src, filter); return;
+    case 8: filter_h_8(dst, src, filter); return;
+    }
+
+    filter_h(dst, src, filter, filter->num_weights);
+}
+
+void ff_sws_filter_v_f32(float *restrict dst, const float *src, ptrdiff_t src_stride,
+                         int width, int y, const SwsFilterWeights *filter)
+{
+    const int num_weights = filter->num_weights;
+    const float *w = &filter->weights[y * num_weights];
+    const uint8_t *row = (const uint8_t *) src + filter->offsets[y] * src_stride;
+    int j = 0;
+
+#define ROW(n) ((const float *restrict) (row + (n) * src_stride))
+
+    /* Accumulate up to four input rows per sweep over the output row */
+    if (num_weights >= 4) {
+        const float *restrict s0 = ROW(0), *restrict s1 = ROW(1);
+        const float *restrict s2 = ROW(2), *restrict s3 = ROW(3);
+        for (int x = 0; x < width; x++)
+            dst[x] = w[0] * s0[x] + w[1] * s1[x] + w[2] * s2[x] + w[3] * s3[x];
+        j = 4;
+    } else {
+        const float *restrict s0 = ROW(0);
+        for (int x = 0; x < width; x++)
+            dst[x] = w[0] * s0[x];
+        j = 1;
+    }
+
+    for (; j + 4 <= num_weights; j += 4) {
+        const float *restrict s0 = ROW(j + 0), *restrict s1 = ROW(j + 1);
+        const float *restrict s2 = ROW(j + 2), *restrict s3 = ROW(j + 3);
+        for (int x = 0; x < width; x++)
+            dst[x] += w[j] * s0[x] + w[j + 1] * s1[x] + w[j + 2] * s2[x] + w[j + 3] * s3[x];
+    }
+
+    for (; j < num_weights; j++) {
+        const float *restrict s0 = ROW(j);
+        for (int x = 0; x < width; x++)
+            dst[x] += w[j] * s0[x];
+    }
+
+#undef ROW
+}
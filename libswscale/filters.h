@@ -0,0 +1,70 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SWSCALE_FILTERS_H
+#define SWSCALE_FILTERS_H
+
+#include <stddef.h>
+
+/**
+ * Precomputed weights for resampling one dimension of an image from
+ * `src_size` to `dst_size` samples. Output sample `i` is computed as:
+ *
+ *   out[i] = sum_{j < num_weights} weights[i * num_weights + j] *
+ *                                  in[offsets[i] + j]
+ *
+ * Filter taps are always fully contained within [0, src_size), i.e. any
+ * edge clamping is already folded into the weights. The weights of every
+ * output sample sum to one.
+ */
+typedef struct SwsFilterWeights {
+    char name[16];      /* name of the filter kernel, informative */
+    int src_size;
+    int dst_size;
+    int num_weights;    /* filter taps per output sample */
+    int *offsets;       /* first input sample for each output sample */
+    float *weights;     /* dst_size * num_weights coefficients */
+} SwsFilterWeights;
+
+/**
+ * Generate filter weights for the scaler selected by `flags` (a set of
+ * SwsFlags) and `params` (see SwsContext.scaler_params).
+ *
+ * @param out  set to a newly allocated refstruct on success
+ * @return 0 on success, AVERROR(ENOTSUP) if the scaler is not supported,
+ *         or another negative error code
+ */
+int ff_sws_filter_generate(void *log_ctx, unsigned flags, const double params[2],
+                           int src_size, int dst_size, SwsFilterWeights **out);
+
+/**
+ * Filter one row of `filter->src_size` floats horizontally into
+ * `filter->dst_size` floats.
+ */
+void ff_sws_filter_h_f32(float *dst, const float *src,
+                         const SwsFilterWeights *filter);
+
+/**
+ * Compute output row `y` of a vertical filter. `src` points to the first row
+ * of the input plane, separated by `src_stride` bytes. Each row contains
+ * `width` floats.
+ */
+void ff_sws_filter_v_f32(float *dst, const float *src, ptrdiff_t src_stride,
+                         int width, int y, const SwsFilterWeights *filter);
+
+#endif /* SWSCALE_FILTERS_H */
@@ -323,6 +323,7 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws,
             sws_free_context(&sws);
             return ret;
         }
+        input->rowwise = true;
     }
 
     if (c->srcXYZ && !(c->dstXYZ && unscaled)) {
@@ -331,6 +332,7 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws,
             sws_free_context(&sws);
             return ret;
         }
+        input->rowwise = true;
     }
 
     pass = ff_sws_graph_add_pass(graph, sws->dst_format, dst_w, dst_h, input, align, sws,
@@ -389,6 +391,7 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws,
         ret = pass_append(graph, AV_PIX_FMT_RGB48, dst_w, dst_h, &pass, 1, c, run_rgb2xyz);
         if (ret < 0)
             return ret;
+        pass->rowwise = true;
     }
 
     *output = pass;
@@ -466,6 +469,67 @@ static int add_legacy_sws_pass(SwsGraph *graph, SwsFormat src, SwsFormat dst,
  *********************/
 
 #if CONFIG_UNSTABLE
+static int add_filter_op(SwsGraph *graph, SwsOpList *ops, int index,
+                         SwsOpType type, int src_size, int dst_size)
+{
+    SwsContext *ctx = graph->ctx;
+    SwsFilterWeights *kernel;
+    int ret;
+
+    ret = ff_sws_filter_generate(ctx, ctx->flags, ctx->scaler_params,
+                                 src_size, dst_size, &kernel);
+    if (ret < 0)
+        return ret;
+
+    return ff_sws_op_list_insert_at(ops, index, &(SwsOp) {
+        .op            = type,
+        .type          = SWS_PIXEL_F32,
+        .filter.kernel = kernel,
+    });
+}
+
+/**
+ * Insert the resampling filters right after the conversion to floating
+ * point, i.e. operating on the raw pixel values like the legacy scaler does.
+ */
+static int add_filter_ops(SwsGraph *graph, SwsOpList *ops,
+                          SwsFormat src, SwsFormat dst)
+{
+    const bool scale_h = src.width  != dst.width;
+    const bool scale_v = src.height != dst.height;
+    int index, ret;
+
+    for (index = 0; index < ops->num_ops; index++) {
+        const SwsOp *op = &ops->ops[index];
+        if (op->op == SWS_OP_CONVERT && op->convert.to == SWS_PIXEL_F32)
+            break;
+    }
+    if (index++ == ops->num_ops)
+        return AVERROR(ENOTSUP);
+
+    /* Filter vertically first if that results in a smaller intermediate */
+    if (scale_h && scale_v &&
+        (int64_t) src.width * dst.height < (int64_t) dst.width * src.height)
+    {
+        ret = add_filter_op(graph, ops, index, SWS_OP_FILTER_H, src.width, dst.width);
+        if (ret < 0)
+            return ret;
+        return add_filter_op(graph, ops, index, SWS_OP_FILTER_V, src.height, dst.height);
+    }
+
+    if (scale_h) {
+        ret = add_filter_op(graph, ops, index++, SWS_OP_FILTER_H, src.width, dst.width);
+        if (ret < 0)
+            return ret;
+    }
+    if (scale_v) {
+        ret = add_filter_op(graph, ops, index, SWS_OP_FILTER_V, src.height, dst.height);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
 static int add_convert_pass(SwsGraph *graph, SwsFormat src, SwsFormat dst,
                             SwsPass *input, SwsPass **output)
 {
@@ -479,9 +543,8 @@ static int add_convert_pass(SwsGraph *graph, SwsFormat src, SwsFormat dst,
     if (!(ctx->flags & SWS_UNSTABLE))
         goto fail;
 
-    /* The new format conversion layer cannot scale for now */
-    if (src.width != dst.width || src.height != dst.height ||
-        src.desc->log2_chroma_h || src.desc->log2_chroma_w ||
+    /* The new format conversion layer cannot handle subsampling for now */
+    if (src.desc->log2_chroma_h || src.desc->log2_chroma_w ||
         dst.desc->log2_chroma_h || dst.desc->log2_chroma_w)
         goto fail;
 
@@ -508,9 +571,15 @@ static int add_convert_pass(SwsGraph *graph, SwsFormat src, SwsFormat dst,
     ret = ff_sws_encode_pixfmt(ops, dst.format);
     if (ret < 0)
         goto fail;
+    if (src.width != dst.width || src.height != dst.height) {
+        ret = add_filter_ops(graph, ops, src, dst);
+        if (ret < 0)
+            goto fail;
+    }
 
-    av_log(ctx, AV_LOG_VERBOSE, "Conversion pass for %s -> %s:\n",
-           av_get_pix_fmt_name(src.format), av_get_pix_fmt_name(dst.format));
+    av_log(ctx, AV_LOG_VERBOSE, "Conversion pass for %s %dx%d -> %s %dx%d:\n",
+           av_get_pix_fmt_name(src.format), src.width, src.height,
+           av_get_pix_fmt_name(dst.format), dst.width, dst.height);
 
     av_log(ctx, AV_LOG_DEBUG, "Unoptimized operation list:\n");
     ff_sws_op_list_print(ctx, AV_LOG_DEBUG, ops);
@@ -632,6 +701,7 @@ static int adapt_colors(SwsGraph *graph, SwsFormat src, SwsFormat dst,
     }
     pass->setup = setup_lut3d;
     pass->free = free_lut3d;
+    pass->rowwise = true;
 
     *output = pass;
     return 0;
@@ -674,11 +744,163 @@ static int init_passes(SwsGraph *graph)
     return 0;
 }
 
+/**
+ * Amount of image data, summed over all passes of a fused group, that a
+ * single strip should touch. Chosen to fit into the L2 cache of one core.
+ */
+#define STRIP_SIZE (256 << 10)
+
+static int pass_vshift(const SwsPass *pass)
+{
+    const int vshift_in = pass->input ? ff_fmt_vshift(pass->input->format, 1)
+                                      : ff_fmt_vshift(pass->graph->src.format, 1);
+    return FFMAX(ff_fmt_vshift(pass->format, 1), vshift_in);
+}
+
+static int pass_row_size(const SwsPass *pass)
+{
+    int linesize[4], size = 0;
+    if (av_image_fill_linesizes(linesize, pass->format, pass->width) < 0)
+        return 0;
+    for (int i = 0; i < 4; i++)
+        size += linesize[i] >> ff_fmt_vshift(pass->format, i);
+    return size;
+}
+
+static int init_group(SwsGraph *graph, SwsPassGroup *group)
+{
+    const SwsPass *first = graph->passes[group->first];
+    int align = 1, row_size = 0;
+
+    if (group->num == 1) {
+        group->slice_h    = first->slice_h;
+        group->num_slices = first->num_slices;
+        return 0;
+    }
+
+    for (int i = 0; i < group->num; i++) {
+        const SwsPass *pass = graph->passes[group->first + i];
+        align     = FFMAX(align, 1 << pass_vshift(pass));
+        row_size += pass_row_size(pass);
+    }
+    row_size += first->input ? pass_row_size(first->input)
+                             : first->width * av_get_padded_bits_per_pixel(
+                                   graph->src.desc) / 8;
+
+    group->slice_h    = (first->height + graph->num_threads - 1) / graph->num_threads;
+    group->slice_h    = FFALIGN(group->slice_h, align);
+    group->num_slices = (first->height + group->slice_h - 1) / group->slice_h;
+    group->strip_h    = STRIP_SIZE / FFMAX(row_size, 1);
+    group->strip_h    = av_clip(group->strip_h / align * align, align, group->slice_h);
+
+    group->num_strips = graph->num_threads * (group->num - 1);
+    group->strips = av_calloc(group->num_strips, sizeof(*group->strips));
+    if (!group->strips)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < group->num_strips; i++) {
+        SwsPass *pass = graph->passes[group->first + i % (group->num - 1)];
+        SwsImg *strip = &group->strips[i];
+        int ret;
+
+        /* The extra rows cover the overread of the last row of a strip;
+         * the linesize matches that of a full-size output buffer. */
+        strip->fmt = pass->format;
+        ret = av_image_alloc(strip->data, strip->linesize, pass->width,
+                             group->strip_h + align, pass->format, 64);
+        if (ret < 0) {
+            strip->fmt = AV_PIX_FMT_NONE;
+            return ret;
+        }
+
+        /* Intermediate images of the group only live in the strips */
+        if (pass->output.fmt != AV_PIX_FMT_NONE) {
+            av_freep(&pass->output.data[0]);
+            memset(pass->output.data, 0, sizeof(pass->output.data));
+        }
+    }
+
+    av_log(graph->ctx, AV_LOG_DEBUG, "Fused %d passes, running in strips of "
+           "%d lines\n", group->num, group->strip_h);
+    return 0;
+}
+
+/* Partition the passes into groups, fusing runs of row-wise passes */
+static int init_groups(SwsGraph *graph)
+{
+    int ret;
+
+    graph->groups = av_calloc(graph->num_passes, sizeof(*graph->groups));
+    if (!graph->groups)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < graph->num_passes;) {
+        SwsPassGroup *group = &graph->groups[graph->num_groups++];
+        const SwsPass *first = graph->passes[i];
+        group->first = i;
+        group->num   = 1;
+
+        while (first->rowwise && i + group->num < graph->num_passes) {
+            const SwsPass *next = graph->passes[i + group->num];
+            const SwsPass *prev = graph->passes[i + group->num - 1];
+            if (!next->rowwise || next->input != prev ||
+                next->width  != first->width ||
+                next->height != first->height)
+                break;
+            group->num++;
+        }
+
+        ret = init_group(graph, group);
+        if (ret < 0)
+            return ret;
+        i += group->num;
+    }
+
+    return 0;
+}
+
+/* Image whose rows starting at `y` are backed by `strip` */
+static SwsImg strip_img(const SwsImg *strip, int y)
+{
+    SwsImg img = *strip;
+    for (int i = 0; i < 4 && img.data[i]; i++)
+        img.data[i] -= (y >> ff_fmt_vshift(img.fmt, i)) * img.linesize[i];
+    return img;
+}
+
+static void run_fused(SwsGraph *graph, const SwsPassGroup *group,
+                      int jobnr, int threadnr)
+{
+    const SwsPass *first = graph->passes[group->first];
+    const SwsPass *last  = graph->passes[group->first + group->num - 1];
+    const SwsImg *strips = &group->strips[threadnr * (group->num - 1)];
+    const SwsImg *input  = first->input ? &first->input->output : &graph->exec.input;
+    const SwsImg *output = last->output.fmt != AV_PIX_FMT_NONE ? &last->output : &graph->exec.output;
+    const int slice_y   = jobnr * group->slice_h;
+    const int slice_end = FFMIN(slice_y + group->slice_h, first->height);
+
+    for (int y = slice_y; y < slice_end; y += group->strip_h) {
+        const int h = FFMIN(group->strip_h, slice_end - y);
+        SwsImg in = *input, out;
+
+        for (int i = 0; i < group->num; i++) {
+            const SwsPass *pass = graph->passes[group->first + i];
+            out = pass == last ? *output : strip_img(&strips[i], y);
+            pass->run(&out, &in, y, h, pass);
+            in = out;
+        }
+    }
+}
+
 static void sws_graph_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
                              int nb_threads)
 {
     SwsGraph *graph = priv;
     const SwsPass *pass = graph->exec.pass;
+    if (graph->exec.group) {
+        run_fused(graph, graph->exec.group, jobnr, threadnr);
+        return;
+    }
     const SwsImg *input  = pass->input ? &pass->input->output : &graph->exec.input;
     const SwsImg *output = pass->output.fmt != AV_PIX_FMT_NONE ? &pass->output : &graph->exec.output;
     const int slice_y = jobnr * pass->slice_h;
@@ -717,6 +939,10 @@ int ff_sws_graph_create(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *
     if (ret < 0)
         goto error;
 
+    ret = init_groups(graph);
+    if (ret < 0)
+        goto error;
+
     *out_graph = graph;
     return 0;
 
@@ -743,6 +969,14 @@ void ff_sws_graph_free(SwsGraph **pgraph)
     }
     av_free(graph->passes);
 
+    for (int i = 0; i < graph->num_groups; i++) {
+        SwsPassGroup *group = &graph->groups[i];
+        for (int j = 0; j < group->num_strips; j++)
+            av_free(group->strips[j].data[0]);
+        av_free(group->strips);
+    }
+    av_free(graph->groups);
+
     av_free(graph);
     *pgraph = NULL;
 }
@@ -800,13 +1034,23 @@ void ff_sws_graph_run(SwsGraph *graph, uint8_t *const out_data[4],
     memcpy(in->data,      in_data,      sizeof(in->data));
     memcpy(in->linesize,  in_linesize,  sizeof(in->linesize));
 
-    for (int i = 0; i < graph->num_passes; i++) {
-        const SwsPass *pass = graph->passes[i];
-        graph->exec.pass = pass;
-        if (pass->setup) {
-            pass->setup(pass->output.fmt != AV_PIX_FMT_NONE ? &pass->output : out,
-                        pass->input ? &pass->input->output : in, pass);
+    for (int i = 0; i < graph->num_groups; i++) {
+        const SwsPassGroup *group = &graph->groups[i];
+        const SwsImg *pass_in = NULL;
+
+        for (int j = 0; j < group->num; j++) {
+            const SwsPass *pass = graph->passes[group->first + j];
+            const SwsImg *pass_out = j + 1 < group->num ? &group->strips[j] :
+                pass->output.fmt != AV_PIX_FMT_NONE ? &pass->output : out;
+            if (!j)
+                pass_in = pass->input ? &pass->input->output : in;
+            if (pass->setup)
+                pass->setup(pass_out, pass_in, pass);
+            pass_in = pass_out;
         }
-        avpriv_slicethread_execute(graph->slicethread, pass->num_slices, 0);
+
+        graph->exec.pass  = graph->passes[group->first];
+        graph->exec.group = group->num > 1 ? group : NULL;
+        avpriv_slicethread_execute(graph->slicethread, group->num_slices, 0);
     }
 }
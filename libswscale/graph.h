@@ -79,6 +79,13 @@ struct SwsPass {
     int slice_h;       /* filter granularity */
     int num_slices;
 
+    /**
+     * Set if each output row only depends on the input row at the same
+     * position, and `run` may be called on any range of rows. Consecutive
+     * row-wise passes are fused and run together on cache-sized strips.
+     */
+    bool rowwise;
+
     /**
      * Filter input. This pass's output will be resolved to form this pass's.
      * input. If NULL, the original input image is used.
@@ -102,6 +109,23 @@ struct SwsPass {
     void *priv;
 };
 
+/**
+ * Sequence of consecutive passes dispatched together. If it contains more
+ * than one pass, all passes are row-wise and each job runs the whole
+ * sequence strip by strip, keeping the intermediate images in small
+ * per-thread buffers instead of full-size ones.
+ */
+typedef struct SwsPassGroup {
+    int first, num;     /* range of passes in SwsGraph.passes */
+    int slice_h;        /* rows per job */
+    int num_slices;
+    int strip_h;        /* rows per strip within a job */
+
+    /* Intermediate strip buffers, (num - 1) for every thread */
+    SwsImg *strips;
+    int num_strips;
+} SwsPassGroup;
+
 /**
  * Filter graph, which represents a 'baked' pixel format conversion.
  */
@@ -116,6 +140,10 @@ typedef struct SwsGraph {
     SwsPass **passes;
     int num_passes;
 
+    /** Passes partitioned into dispatch groups, in execution order */
+    SwsPassGroup *groups;
+    int num_groups;
+
     /**
      * Cached copy of the public options that were used to construct this
      * SwsGraph. Used only to detect when the graph needs to be reinitialized.
@@ -131,6 +159,7 @@ typedef struct SwsGraph {
     /** Temporary execution state inside ff_sws_graph_run */
     struct {
         const SwsPass *pass; /* current filter pass */
+        const SwsPassGroup *group; /* current group, if fused */
         SwsImg input;
         SwsImg output;
     } exec;
@@ -28,6 +28,7 @@
 #include "ops_internal.h"
 
 extern const SwsOpBackend backend_c;
+extern const SwsOpBackend backend_fused;
 extern const SwsOpBackend backend_murder;
 extern const SwsOpBackend backend_x86;
 
@@ -36,6 +37,7 @@ const SwsOpBackend * const ff_sws_op_backends[] = {
 #if ARCH_X86_64 && HAVE_X86ASM
     &backend_x86,
 #endif
+    &backend_fused,
     &backend_c,
     NULL
 };
@@ -46,6 +48,12 @@ const SwsOpBackend * const ff_sws_op_backends[] = {
             return ret;                                                        \
     } while (0)
 
+#define RET_FAIL(x)                                                            \
+    do {                                                                       \
+        if ((ret = (x)) < 0)                                                   \
+            goto fail;                                                         \
+    } while (0)
+
 const char *ff_sws_pixel_type_name(SwsPixelType type)
 {
     switch (type) {
@@ -206,6 +214,11 @@ void ff_sws_apply_op_q(const SwsOp *op, AVRational x[4])
         for (int i = 0; i < 4; i++)
             x[i] = x[i].den ? av_mul_q(x[i], op->c.q) : x[i];
         return;
+    case SWS_OP_FILTER_H:
+    case SWS_OP_FILTER_V:
+        /* Filter weights are normalized, so constants are preserved */
+        av_assert1(!ff_sws_pixel_type_is_int(op->type));
+        return;
     }
 
     av_unreachable("Invalid operation type!");
@@ -237,6 +250,8 @@ void ff_sws_op_list_update_comps(SwsOpList *ops)
         case SWS_OP_LINEAR:
         case SWS_OP_SWAP_BYTES:
         case SWS_OP_UNPACK:
+        case SWS_OP_FILTER_H:
+        case SWS_OP_FILTER_V:
             break; /* special cases, handled below */
         default:
             memcpy(op->comps.min, prev.min, sizeof(prev.min));
@@ -366,6 +381,15 @@ void ff_sws_op_list_update_comps(SwsOpList *ops)
                     FFSWAP(AVRational, op->comps.min[i], op->comps.max[i]);
             }
             break;
+        case SWS_OP_FILTER_H:
+        case SWS_OP_FILTER_V:
+            /* Filtered values are fractional, and may overshoot the range */
+            for (int i = 0; i < 4; i++) {
+                op->comps.flags[i] = prev.flags[i] & ~SWS_COMP_EXACT;
+                op->comps.min[i]   = (AVRational) {0, 0};
+                op->comps.max[i]   = (AVRational) {0, 0};
+            }
+            break;
 
         case SWS_OP_INVALID:
         case SWS_OP_TYPE_NB:
@@ -395,6 +419,8 @@ void ff_sws_op_list_update_comps(SwsOpList *ops)
         case SWS_OP_MIN:
         case SWS_OP_MAX:
         case SWS_OP_SCALE:
+        case SWS_OP_FILTER_H:
+        case SWS_OP_FILTER_V:
             for (int i = 0; i < 4; i++)
                 op->comps.unused[i] = next.unused[i];
             break;
@@ -454,6 +480,10 @@ static void op_uninit(SwsOp *op)
     case SWS_OP_DITHER:
         av_refstruct_unref(&op->dither.matrix);
         break;
+    case SWS_OP_FILTER_H:
+    case SWS_OP_FILTER_V:
+        av_refstruct_unref(&op->filter.kernel);
+        break;
     }
 
     *op = (SwsOp) {0};
@@ -507,6 +537,10 @@ SwsOpList *ff_sws_op_list_duplicate(const SwsOpList *ops)
         case SWS_OP_DITHER:
             av_refstruct_ref(copy->ops[i].dither.matrix);
             break;
+        case SWS_OP_FILTER_H:
+        case SWS_OP_FILTER_V:
+            av_refstruct_ref(copy->ops[i].filter.kernel);
+            break;
         }
     }
 
@@ -739,6 +773,14 @@ void ff_sws_op_list_print(void *log, int lev, const SwsOpList *ops)
             av_log(log, lev, "%-20s: * %s\n", "SWS_OP_SCALE",
                    PRINTQ(op->c.q));
             break;
+        case SWS_OP_FILTER_H:
+        case SWS_OP_FILTER_V:
+            av_log(log, lev, "%-20s: %s %d -> %d (%d taps)\n",
+                   op->op == SWS_OP_FILTER_H ? "SWS_OP_FILTER_H"
+                                             : "SWS_OP_FILTER_V",
+                   op->filter.kernel->name, op->filter.kernel->src_size,
+                   op->filter.kernel->dst_size, op->filter.kernel->num_weights);
+            break;
         case SWS_OP_TYPE_NB:
             break;
         }
@@ -1030,32 +1072,17 @@ static int rw_pixel_bits(const SwsOp *op)
     return elems * size * bits;
 }
 
-int ff_sws_compile_pass(SwsGraph *graph, SwsOpList *ops, int flags, SwsFormat dst,
-                        SwsPass *input, SwsPass **output)
+static int compile_op_pass(SwsGraph *graph, const SwsOpList *ops,
+                           enum AVPixelFormat fmt, int width, int height,
+                           SwsPass *input, SwsPass **output)
 {
     SwsContext *ctx = graph->ctx;
-    SwsOpPass *p = NULL;
     const SwsOp *read = &ops->ops[0];
     const SwsOp *write = &ops->ops[ops->num_ops - 1];
+    SwsOpPass *p = NULL;
     SwsPass *pass;
     int ret;
 
-    if (ops->num_ops < 2) {
-        av_log(ctx, AV_LOG_ERROR, "Need at least two operations.\n");
-        return AVERROR(EINVAL);
-    }
-
-    if (read->op != SWS_OP_READ || write->op != SWS_OP_WRITE) {
-        av_log(ctx, AV_LOG_ERROR, "First and last operations must be a read "
-               "and write, respectively.\n");
-        return AVERROR(EINVAL);
-    }
-
-    if (flags & SWS_OP_FLAG_OPTIMIZE)
-        RET(ff_sws_op_list_optimize(ops));
-    else
-        ff_sws_op_list_update_comps(ops);
-
     p = av_mallocz(sizeof(*p));
     if (!p)
         return AVERROR(ENOMEM);
@@ -1069,13 +1096,13 @@ int ff_sws_compile_pass(SwsGraph *graph, SwsOpList *ops, int flags, SwsFormat ds
     p->pixel_bits_in  = rw_pixel_bits(read);
     p->pixel_bits_out = rw_pixel_bits(write);
     p->exec_base = (SwsOpExec) {
-        .width  = dst.width,
-        .height = dst.height,
+        .width  = width,
+        .height = height,
         .block_size_in  = p->comp.block_size * p->pixel_bits_in  >> 3,
         .block_size_out = p->comp.block_size * p->pixel_bits_out >> 3,
     };
 
-    pass = ff_sws_graph_add_pass(graph, dst.format, dst.width, dst.height, input,
+    pass = ff_sws_graph_add_pass(graph, fmt, width, height, input,
                                  1, p, op_pass_run);
     if (!pass) {
         ret = AVERROR(ENOMEM);
@@ -1083,6 +1110,7 @@ int ff_sws_compile_pass(SwsGraph *graph, SwsOpList *ops, int flags, SwsFormat ds
     }
     pass->setup = op_pass_setup;
     pass->free  = op_pass_free;
+    pass->rowwise = true;
 
     *output = pass;
     return 0;
@@ -1091,3 +1119,253 @@ fail:
     op_pass_free(p);
     return ret;
 }
+
+typedef struct SwsFilterPass {
+    SwsFilterWeights *kernel;
+    int planes;
+} SwsFilterPass;
+
+static void filter_pass_free(void *ptr)
+{
+    SwsFilterPass *p = ptr;
+    av_refstruct_unref(&p->kernel);
+    av_free(p);
+}
+
+static void filter_pass_run_h(const SwsImg *out_base, const SwsImg *in_base,
+                              const int y, const int h, const SwsPass *pass)
+{
+    const SwsFilterPass *p = pass->priv;
+    const SwsImg in  = ff_sws_img_shift(in_base,  y);
+    const SwsImg out = ff_sws_img_shift(out_base, y);
+
+    for (int i = 0; i < p->planes; i++) {
+        for (int row = 0; row < h; row++) {
+            ff_sws_filter_h_f32((float *) (out.data[i] + row * out.linesize[i]),
+                                (const float *) (in.data[i] + row * in.linesize[i]),
+                                p->kernel);
+        }
+    }
+}
+
+static void filter_pass_run_v(const SwsImg *out_base, const SwsImg *in,
+                              const int y, const int h, const SwsPass *pass)
+{
+    const SwsFilterPass *p = pass->priv;
+    const SwsImg out = ff_sws_img_shift(out_base, y);
+
+    /* Each output row may depend on any row of the input */
+    for (int i = 0; i < p->planes; i++) {
+        for (int row = 0; row < h; row++) {
+            ff_sws_filter_v_f32((float *) (out.data[i] + row * out.linesize[i]),
+                                (const float *) in->data[i], in->linesize[i],
+                                pass->width, y + row, p->kernel);
+        }
+    }
+}
+
+static enum AVPixelFormat planar_f32_format(int planes)
+{
+    return planes > 3 ? AV_PIX_FMT_GBRAPF32 :
+           planes > 1 ? AV_PIX_FMT_GBRPF32  :
+                        AV_PIX_FMT_GRAYF32;
+}
+
+static int add_filter_pass(SwsGraph *graph, const SwsOp *op, int planes,
+                           int width, int height, SwsPass *input,
+                           SwsPass **output)
+{
+    const bool horiz = op->op == SWS_OP_FILTER_H;
+    SwsFilterPass *p;
+    SwsPass *pass;
+
+    av_assert0(op->type == SWS_PIXEL_F32);
+    av_assert0(op->filter.kernel->src_size == (horiz ? width : height));
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->kernel = av_refstruct_ref(op->filter.kernel);
+    p->planes = planes;
+
+    if (horiz)
+        width = p->kernel->dst_size;
+    else
+        height = p->kernel->dst_size;
+
+    pass = ff_sws_graph_add_pass(graph, planar_f32_format(planes), width, height,
+                                 input, 1, p, horiz ? filter_pass_run_h
+                                                    : filter_pass_run_v);
+    if (!pass) {
+        filter_pass_free(p);
+        return AVERROR(ENOMEM);
+    }
+    pass->free = filter_pass_free;
+    pass->rowwise = horiz;
+
+    *output = pass;
+    return 0;
+}
+
+static bool op_is_filter(const SwsOp *op)
+{
+    return op->op == SWS_OP_FILTER_H || op->op == SWS_OP_FILTER_V;
+}
+
+/**
+ * Split an operation list around each filter. Every chunk of operations
+ * in between is compiled into a separate pass, with the filters reading from
+ * and writing to planar floating point images.
+ */
+static int compile_filtered(SwsGraph *graph, const SwsOpList *ops,
+                            SwsFormat dst, SwsPass *input, SwsPass **output)
+{
+    SwsOp read = ops->ops[0];
+    SwsSwizzleOp unpack = SWS_SWIZZLE(0, 1, 2, 3);
+    bool swizzled = false;
+    SwsOpList *seg = NULL;
+    int width = dst.width, height = dst.height;
+    int ret;
+
+    /* Work backwards to the dimensions of the input image */
+    for (int n = ops->num_ops - 1; n >= 0; n--) {
+        const SwsOp *op = &ops->ops[n];
+        if (op->op == SWS_OP_FILTER_H)
+            width = op->filter.kernel->src_size;
+        else if (op->op == SWS_OP_FILTER_V)
+            height = op->filter.kernel->src_size;
+    }
+
+    for (int n = 1; n < ops->num_ops;) {
+        int end = n, planes = 0;
+        while (end < ops->num_ops && !op_is_filter(&ops->ops[end]))
+            end++;
+
+        seg = ff_sws_op_list_alloc();
+        if (!seg)
+            return AVERROR(ENOMEM);
+
+        RET_FAIL(ff_sws_op_list_append(seg, &read));
+        if (swizzled) {
+            RET_FAIL(ff_sws_op_list_append(seg, &(SwsOp) {
+                .op      = SWS_OP_SWIZZLE,
+                .type    = SWS_PIXEL_F32,
+                .swizzle = unpack,
+            }));
+        }
+        for (int i = n; i < end; i++) {
+            SwsOp op = ops->ops[i];
+            if (op.op == SWS_OP_DITHER)
+                av_refstruct_ref(op.dither.matrix);
+            RET_FAIL(ff_sws_op_list_append(seg, &op));
+        }
+
+        if (end < ops->num_ops) {
+            /* Only the components used after the filter are filtered. Pack
+             * them into the first planes of the intermediate, so that unused
+             * components are neither written nor allocated */
+            const SwsOp *filter = &ops->ops[end];
+            SwsSwizzleOp pack = SWS_SWIZZLE(0, 1, 2, 3);
+            int nb_unused = 0;
+
+            unpack   = SWS_SWIZZLE(0, 0, 0, 0);
+            swizzled = false;
+            for (int i = 0; i < 4; i++) {
+                if (filter->comps.unused[i])
+                    continue;
+                swizzled |= i != planes;
+                unpack.in[i]     = planes;
+                pack.in[planes++] = i;
+            }
+            for (int i = 0; i < 4; i++) {
+                if (filter->comps.unused[i])
+                    pack.in[planes + nb_unused++] = i;
+            }
+            planes = FFMAX(planes, 1);
+
+            if (swizzled) {
+                RET_FAIL(ff_sws_op_list_append(seg, &(SwsOp) {
+                    .op      = SWS_OP_SWIZZLE,
+                    .type    = SWS_PIXEL_F32,
+                    .swizzle = pack,
+                }));
+            }
+
+            RET_FAIL(ff_sws_op_list_append(seg, &(SwsOp) {
+                .op       = SWS_OP_WRITE,
+                .type     = SWS_PIXEL_F32,
+                .rw.elems = planes,
+            }));
+        }
+
+        RET_FAIL(ff_sws_op_list_optimize(seg));
+        if (seg->num_ops) {
+            av_log(graph->ctx, AV_LOG_DEBUG, "Sub-pass %dx%d:\n", width, height);
+            ff_sws_op_list_print(graph->ctx, AV_LOG_DEBUG, seg);
+            RET_FAIL(compile_op_pass(graph, seg, end < ops->num_ops ?
+                                     planar_f32_format(planes) : dst.format,
+                                     width, height, input, &input));
+        } else if (end == ops->num_ops) {
+            /* The last filter already produced the output layout */
+            input->format = dst.format;
+        }
+        ff_sws_op_list_free(&seg);
+
+        if (end == ops->num_ops)
+            break;
+
+        RET(add_filter_pass(graph, &ops->ops[end], planes, width, height,
+                            input, &input));
+        if (ops->ops[end].op == SWS_OP_FILTER_H)
+            width = ops->ops[end].filter.kernel->dst_size;
+        else
+            height = ops->ops[end].filter.kernel->dst_size;
+
+        read = (SwsOp) {
+            .op       = SWS_OP_READ,
+            .type     = SWS_PIXEL_F32,
+            .rw.elems = planes,
+        };
+        n = end + 1;
+    }
+
+    *output = input;
+    return 0;
+
+fail:
+    ff_sws_op_list_free(&seg);
+    return ret;
+}
+
+int ff_sws_compile_pass(SwsGraph *graph, SwsOpList *ops, int flags, SwsFormat dst,
+                        SwsPass *input, SwsPass **output)
+{
+    SwsContext *ctx = graph->ctx;
+    const SwsOp *read = &ops->ops[0];
+    const SwsOp *write = &ops->ops[ops->num_ops - 1];
+    int ret;
+
+    if (ops->num_ops < 2) {
+        av_log(ctx, AV_LOG_ERROR, "Need at least two operations.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (read->op != SWS_OP_READ || write->op != SWS_OP_WRITE) {
+        av_log(ctx, AV_LOG_ERROR, "First and last operations must be a read "
+               "and write, respectively.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (flags & SWS_OP_FLAG_OPTIMIZE)
+        RET(ff_sws_op_list_optimize(ops));
+    else
+        ff_sws_op_list_update_comps(ops);
+
+    for (int n = 0; n < ops->num_ops; n++) {
+        if (op_is_filter(&ops->ops[n]))
+            return compile_filtered(graph, ops, dst, input, output);
+    }
+
+    return compile_op_pass(graph, ops, dst.format, dst.width, dst.height,
+                           input, output);
+}
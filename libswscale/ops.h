@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include <stdalign.h>
 
+#include "filters.h"
 #include "graph.h"
 
 typedef enum SwsPixelType {
@@ -66,6 +67,11 @@ typedef enum SwsOpType {
     SWS_OP_LINEAR,          /* generalized linear affine transform */
     SWS_OP_DITHER,          /* add dithering noise */
 
+    /* Resampling operations, floating-point only. These change the image
+     * dimensions, and are executed as separate passes by the compiler */
+    SWS_OP_FILTER_H,        /* horizontal resampling filter */
+    SWS_OP_FILTER_V,        /* vertical resampling filter */
+
     SWS_OP_TYPE_NB,
 } SwsOpType;
 
@@ -142,6 +148,15 @@ typedef struct SwsDitherOp {
     uint8_t y_offset[4]; /* row offset for each component */
 } SwsDitherOp;
 
+typedef struct SwsFilterOp {
+    /**
+     * Separable resampling filter, applied identically to all components.
+     * Output values are not clamped, so filters with negative lobes may
+     * overshoot the input value range.
+     */
+    SwsFilterWeights *kernel; /* refstruct */
+} SwsFilterOp;
+
 typedef struct SwsLinearOp {
     /**
      * Generalized 5x5 affine transformation:
@@ -193,6 +208,7 @@ typedef struct SwsOp {
         SwsSwizzleOp    swizzle;
         SwsConvertOp    convert;
         SwsDitherOp     dither;
+        SwsFilterOp     filter;
         SwsConst        c;
     };
 
@@ -281,6 +297,9 @@ enum SwsOpCompileFlags {
  * Resolves an operation list to a graph pass. The first and last operations
  * must be a read/write respectively. `flags` is a list of SwsOpCompileFlags.
  *
+ * If the list contains any resampling filters, it is split into multiple
+ * passes around each of them, which exchange planar floating point images.
+ *
  * Note: `ops` may be modified by this function.
  */
 int ff_sws_compile_pass(SwsGraph *graph, SwsOpList *ops, int flags, SwsFormat dst,
@@ -0,0 +1,463 @@
+/**
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ops_backend.h"
+
+#if AV_GCC_VERSION_AT_LEAST(4, 4)
+#pragma GCC optimize ("finite-math-only")
+#endif
+
+/**
+ * Library of fully fused kernels for the most common operation lists.
+ *
+ * Every kernel implements an entire read -> process -> write chain in a
+ * single loop, without intermediate block stores or per-op dispatch. The
+ * kernels are instantiated at compile time from FUSED_KERNELS() below, and
+ * selected by matching a 32-bit signature derived from the structure of the
+ * optimized op list. All remaining parameters (swizzle masks, coefficients,
+ * dither matrices, clear values) are passed in FusedPriv.
+ *
+ * The arithmetic is kept in the same order as in the C backend, so the
+ * results are bit-exact with it.
+ */
+
+#ifndef SWS_BLOCK_SIZE
+#  define SWS_BLOCK_SIZE 32
+#endif
+
+enum {
+    FUSED_FLOAT  = 1 << 0, /* convert to f32 and back */
+    FUSED_SCALE  = 1 << 1,
+    FUSED_LINEAR = 1 << 2,
+    FUSED_DITHER = 1 << 3,
+    FUSED_MAX    = 1 << 4,
+    FUSED_MIN    = 1 << 5,
+    FUSED_EXPAND = 1 << 6, /* integer u8 -> u16 expansion */
+    FUSED_LSHIFT = 1 << 7,
+    FUSED_RSHIFT = 1 << 8,
+};
+
+/**
+ * Signature of an op list:
+ *   IN, OUT: size of the read and written pixel type, in bytes
+ *   NI, NO:  number of elements read and written
+ *   PI, PO:  whether the input / output is packed
+ *   NC:      number of input components used by the linear transform
+ *   CLEAR:   mask of output elements set to a constant
+ *   FLAGS:   operations present, see FUSED_*
+ */
+#define FUSED_KEY(IN, NI, PI, NC, FLAGS, CLEAR, OUT, NO, PO)                    \
+    ((uint32_t) (IN) <<  0 | (uint32_t) (NI)    <<  3 | (uint32_t) (PI) <<  6 | \
+     (uint32_t) (OUT) << 7 | (uint32_t) (NO)    << 10 | (uint32_t) (PO) << 13 | \
+     (uint32_t) (CLEAR) << 14 | (uint32_t) (NC) << 18 |                         \
+     (uint32_t) (FLAGS) << 21)
+
+typedef struct FusedPriv {
+    /**
+     * Source element of each component. For linear kernels, this is indexed
+     * by the input component of the matrix, otherwise by output element.
+     * Refers to the plane for planar input, and to the offset inside the
+     * pixel for packed input.
+     */
+    int src[4];
+
+    /* All of the following are indexed by output element */
+    float m[4][4];
+    float k[4];
+    float min[4];
+    float max[4];
+    uint8_t dither_y[4];
+    uint32_t clear[4];
+
+    float scale;
+    uint8_t shift;
+
+    const float *dither; /* size x size matrix, or points to `half` */
+    int dither_mask;     /* size - 1 */
+    int dither_size_log2;
+    float half;
+} FusedPriv;
+
+#define FUSED_LOAD(SIZE, PTR, IDX)                                              \
+    ((SIZE) == 1 ? ((const uint8_t *) (PTR))[IDX] : ((const uint16_t *) (PTR))[IDX])
+
+static av_always_inline void
+fused_kernel(const SwsOpExec *exec, const FusedPriv *restrict p,
+             const int bx_start, const int y_start, const int bx_end,
+             const int y_end, const int in_size, const int ni, const int pi,
+             const int nc, const int flags, const int clear,
+             const int out_size, const int no, const int po)
+{
+    const int x0 = bx_start * SWS_BLOCK_SIZE;
+    const int num = (bx_end - bx_start) * SWS_BLOCK_SIZE;
+    const int in_step  = pi ? ni : 1;
+    const int out_step = po ? no : 1;
+    const int nsrc = (flags & FUSED_LINEAR) ? nc : no;
+    const int dmask = p->dither_mask;
+
+    for (int y = y_start; y < y_end; y++) {
+        const int line = y - y_start;
+        const uint8_t *src[4];
+        uint8_t *dst[4];
+        const float *drow[4];
+
+        for (int c = 0; c < nsrc; c++) {
+            const int idx = p->src[c];
+            if (pi) {
+                src[c] = exec->in[0] + line * exec->in_stride[0] + idx * in_size;
+            } else {
+                src[c] = exec->in[idx] + line * exec->in_stride[idx];
+            }
+        }
+
+        for (int j = 0; j < no; j++) {
+            if (po) {
+                dst[j] = exec->out[0] + line * exec->out_stride[0] + j * out_size;
+            } else {
+                dst[j] = exec->out[j] + line * exec->out_stride[j];
+            }
+            drow[j] = &p->dither[((y + p->dither_y[j]) & dmask) << p->dither_size_log2];
+        }
+
+        SWS_LOOP
+        for (int i = 0; i < num; i++) {
+            float c[4];
+            if (flags & FUSED_LINEAR) {
+                for (int n = 0; n < nc; n++)
+                    c[n] = FUSED_LOAD(in_size, src[n], in_step * i);
+            }
+
+            for (int j = 0; j < no; j++) {
+                uint32_t v;
+                if (clear & (1 << j)) {
+                    v = p->clear[j];
+                } else if (flags & FUSED_FLOAT) {
+                    float f;
+                    if (flags & FUSED_LINEAR) {
+                        f = p->k[j];
+                        for (int n = 0; n < nc; n++)
+                            f += p->m[j][n] * c[n];
+                    } else {
+                        f = FUSED_LOAD(in_size, src[j], in_step * i);
+                        if (flags & FUSED_SCALE)
+                            f *= p->scale;
+                    }
+                    if (flags & FUSED_DITHER)
+                        f += drow[j][(x0 + i) & dmask];
+                    if (flags & FUSED_MAX)
+                        f = FFMAX(f, p->max[j]);
+                    if (flags & FUSED_MIN)
+                        f = FFMIN(f, p->min[j]);
+                    v = out_size == 1 ? (uint8_t) f : (uint16_t) f;
+                } else {
+                    v = FUSED_LOAD(in_size, src[j], in_step * i);
+                    if (flags & FUSED_EXPAND)
+                        v = v << 8 | v;
+                    v = out_size == 1 ? (uint8_t) v : (uint16_t) v;
+                    if (flags & FUSED_LSHIFT)
+                        v <<= p->shift;
+                    if (flags & FUSED_RSHIFT)
+                        v >>= p->shift;
+                }
+
+                if (out_size == 1)
+                    ((uint8_t *) dst[j])[out_step * i] = v;
+                else
+                    ((uint16_t *) dst[j])[out_step * i] = v;
+            }
+        }
+    }
+}
+
+/* Common combinations of arithmetic ops */
+#define F_RGB    (FUSED_FLOAT | FUSED_LINEAR | FUSED_DITHER | FUSED_MAX | FUSED_MIN)
+#define F_RGB_HI (FUSED_FLOAT | FUSED_LINEAR | FUSED_MAX | FUSED_MIN)
+#define F_YUV    (FUSED_FLOAT | FUSED_LINEAR | FUSED_DITHER)
+#define F_YUV_HI (FUSED_FLOAT | FUSED_LINEAR)
+#define F_LUMA   (FUSED_FLOAT | FUSED_LINEAR | FUSED_DITHER | FUSED_MIN)
+#define F_DOWN   (FUSED_FLOAT | FUSED_SCALE | FUSED_DITHER | FUSED_MIN)
+
+/**
+ * List of kernels, named after a representative conversion. Most of these
+ * also cover several other format pairs with the same structure, e.g.
+ * rgba_bgra also handles argb -> abgr and all other permutations.
+ *
+ *   NAME                  IN NI PI NC FLAGS         CLEAR OUT NO PO
+ */
+#define FUSED_KERNELS(X)                                                        \
+    /* Integer only */                                                          \
+    X(rgba_bgra,            1, 4, 1, 0, 0,            0x0, 1, 4, 1)             \
+    X(argb_rgb0,            1, 4, 1, 0, 0,            0x8, 1, 4, 1)             \
+    X(rgba_0rgb,            1, 4, 1, 0, 0,            0x1, 1, 4, 1)             \
+    X(rgba_rgb24,           1, 4, 1, 0, 0,            0x0, 1, 3, 1)             \
+    X(rgba_gbrp,            1, 4, 1, 0, 0,            0x0, 1, 3, 0)             \
+    X(rgba_gbrap,           1, 4, 1, 0, 0,            0x0, 1, 4, 0)             \
+    X(gbrap_rgba,           1, 4, 0, 0, 0,            0x0, 1, 4, 1)             \
+    X(rgb24_rgba,           1, 3, 1, 0, 0,            0x8, 1, 4, 1)             \
+    X(rgb24_argb,           1, 3, 1, 0, 0,            0x1, 1, 4, 1)             \
+    X(rgb24_bgr24,          1, 3, 1, 0, 0,            0x0, 1, 3, 1)             \
+    X(rgb24_gbrp,           1, 3, 1, 0, 0,            0x0, 1, 3, 0)             \
+    X(gbrp_rgba,            1, 3, 0, 0, 0,            0x8, 1, 4, 1)             \
+    X(gbrp_argb,            1, 3, 0, 0, 0,            0x1, 1, 4, 1)             \
+    X(gbrp_rgb24,           1, 3, 0, 0, 0,            0x0, 1, 3, 1)             \
+    X(gray_rgba,            1, 1, 0, 0, 0,            0x8, 1, 4, 1)             \
+    X(gray_rgb24,           1, 1, 0, 0, 0,            0x0, 1, 3, 1)             \
+    X(gray_gray16,          1, 1, 0, 0, FUSED_EXPAND, 0x0, 2, 1, 0)             \
+    X(rgba_rgb48,           1, 4, 1, 0, FUSED_EXPAND, 0x0, 2, 3, 1)             \
+    X(rgb24_rgb48,          1, 3, 1, 0, FUSED_EXPAND, 0x0, 2, 3, 1)             \
+    X(rgba_gbrp16,          1, 4, 1, 0, FUSED_EXPAND, 0x0, 2, 3, 0)             \
+    X(yuv444p_yuv444p10,    1, 3, 0, 0, FUSED_LSHIFT, 0x0, 2, 3, 0)             \
+    X(yuv444p10_yuv444p12,  2, 3, 0, 0, FUSED_LSHIFT, 0x0, 2, 3, 0)             \
+    /* YUV -> RGB */                                                            \
+    X(yuv444p_rgb24,        1, 3, 0, 3, F_RGB,        0x0, 1, 3, 1)             \
+    X(yuv444p_rgba,         1, 3, 0, 3, F_RGB,        0x8, 1, 4, 1)             \
+    X(yuv444p_argb,         1, 3, 0, 3, F_RGB,        0x1, 1, 4, 1)             \
+    X(yuv444p_gbrp,         1, 3, 0, 3, F_RGB,        0x0, 1, 3, 0)             \
+    X(yuv444p_rgb48,        1, 3, 0, 3, F_RGB_HI,     0x0, 2, 3, 1)             \
+    X(yuva444p_rgba,        1, 4, 0, 4, F_RGB,        0x0, 1, 4, 1)             \
+    X(yuv444p10_rgb24,      2, 3, 0, 3, F_RGB,        0x0, 1, 3, 1)             \
+    X(yuv444p10_rgba,       2, 3, 0, 3, F_RGB,        0x8, 1, 4, 1)             \
+    X(yuv444p10_argb,       2, 3, 0, 3, F_RGB,        0x1, 1, 4, 1)             \
+    X(yuv444p10_gbrp,       2, 3, 0, 3, F_RGB,        0x0, 1, 3, 0)             \
+    X(yuv444p10_gbrp10,     2, 3, 0, 3, F_RGB,        0x0, 2, 3, 0)             \
+    X(yuv444p10_rgb48,      2, 3, 0, 3, F_RGB_HI,     0x0, 2, 3, 1)             \
+    X(yuv444p10_gbrp16,     2, 3, 0, 3, F_RGB_HI,     0x0, 2, 3, 0)             \
+    X(yuv444p10_gray,       2, 1, 0, 1, F_RGB,        0x0, 1, 1, 0)             \
+    /* RGB -> YUV */                                                            \
+    X(rgb24_yuv444p,        1, 3, 1, 3, F_YUV,        0x0, 1, 3, 0)             \
+    X(rgba_yuv444p,         1, 4, 1, 3, F_YUV,        0x0, 1, 3, 0)             \
+    X(gbrp_yuv444p,         1, 3, 0, 3, F_YUV,        0x0, 1, 3, 0)             \
+    X(rgb24_yuv444p10,      1, 3, 1, 3, F_YUV,        0x0, 2, 3, 0)             \
+    X(rgba_yuv444p10,       1, 4, 1, 3, F_YUV,        0x0, 2, 3, 0)             \
+    X(rgba_yuv444p16,       1, 4, 1, 3, F_YUV_HI,     0x0, 2, 3, 0)             \
+    X(rgb24_gray,           1, 3, 1, 3, F_LUMA,       0x0, 1, 1, 0)             \
+    X(rgba_gray,            1, 4, 1, 3, F_LUMA,       0x0, 1, 1, 0)             \
+    /* Bit depth reduction */                                                   \
+    X(yuv444p10_yuv444p,    2, 3, 0, 0, F_DOWN,       0x0, 1, 3, 0)             \
+    X(gray10_gray,          2, 1, 0, 0, F_DOWN,       0x0, 1, 1, 0)             \
+    X(gbrp10_rgb24,         2, 3, 0, 0, F_DOWN,       0x0, 1, 3, 1)             \
+    X(gbrp10_rgba,          2, 3, 0, 0, F_DOWN,       0x8, 1, 4, 1)             \
+    X(gray10_rgba,          2, 1, 0, 0, F_DOWN,       0x8, 1, 4, 1)             \
+    X(rgb48_rgba,           2, 3, 1, 0, F_DOWN,       0x8, 1, 4, 1)
+
+#define DECL_KERNEL(NAME, IN, NI, PI, NC, FLAGS, CLEAR, OUT, NO, PO)            \
+static SWS_FUNC void fused_##NAME(const SwsOpExec *exec, const void *priv,      \
+                                  int bx_start, int y_start,                    \
+                                  int bx_end, int y_end)                        \
+{                                                                               \
+    fused_kernel(exec, priv, bx_start, y_start, bx_end, y_end,                  \
+                 IN, NI, PI, NC, FLAGS, CLEAR, OUT, NO, PO);                    \
+}
+
+FUSED_KERNELS(DECL_KERNEL)
+
+typedef struct FusedKernel {
+    uint32_t key;
+    SwsOpFunc func;
+} FusedKernel;
+
+#define REF_KERNEL(NAME, IN, NI, PI, NC, FLAGS, CLEAR, OUT, NO, PO)             \
+    { FUSED_KEY(IN, NI, PI, NC, FLAGS, CLEAR, OUT, NO, PO), fused_##NAME },
+
+static const FusedKernel kernels[] = {
+    FUSED_KERNELS(REF_KERNEL)
+};
+
+#define q2pixel(type, q) ((q).den ? (type) (q).num / (q).den : 0)
+
+static int is_rw_type(SwsPixelType type)
+{
+    return type == SWS_PIXEL_U8 || type == SWS_PIXEL_U16;
+}
+
+static void fused_free(void *ptr)
+{
+    FusedPriv *p = ptr;
+    if (p && p->dither != &p->half)
+        av_free((void *) p->dither);
+    av_free(p);
+}
+
+static int compile(SwsContext *ctx, SwsOpList *ops, SwsCompiledOp *out)
+{
+    const SwsOp *read, *write, *op;
+    const SwsOp *lin = NULL, *dither = NULL, *clear = NULL;
+    const SwsOp *min = NULL, *max = NULL;
+    SwsSwizzleOp pre  = SWS_SWIZZLE(0, 1, 2, 3);
+    SwsSwizzleOp post = SWS_SWIZZLE(0, 1, 2, 3);
+    FusedPriv p = {0};
+    SwsOpFunc func = NULL;
+    int flags = 0, clear_mask = 0, nc = 0, ni, no;
+    int n = 0;
+
+#define NEXT(TYPE) (n < ops->num_ops && ops->ops[n].op == (TYPE))
+
+    /* Match the op list against the kernel structure */
+    read = &ops->ops[n++];
+    if (read->op != SWS_OP_READ || read->rw.frac || !is_rw_type(read->type))
+        return AVERROR(ENOTSUP);
+    if (NEXT(SWS_OP_SWIZZLE))
+        pre = ops->ops[n++].swizzle;
+
+    if (NEXT(SWS_OP_CONVERT) && ops->ops[n].convert.to == SWS_PIXEL_F32) {
+        flags |= FUSED_FLOAT;
+        n++;
+        if (NEXT(SWS_OP_SCALE)) {
+            flags |= FUSED_SCALE;
+            p.scale = q2pixel(float, ops->ops[n].c.q);
+            n++;
+        } else if (NEXT(SWS_OP_LINEAR)) {
+            flags |= FUSED_LINEAR;
+            lin = &ops->ops[n++];
+        }
+        if (NEXT(SWS_OP_DITHER)) {
+            flags |= FUSED_DITHER;
+            dither = &ops->ops[n++];
+        }
+        if (NEXT(SWS_OP_MAX)) {
+            flags |= FUSED_MAX;
+            max = &ops->ops[n++];
+        }
+        if (NEXT(SWS_OP_MIN)) {
+            flags |= FUSED_MIN;
+            min = &ops->ops[n++];
+        }
+        if (!NEXT(SWS_OP_CONVERT) || !is_rw_type(ops->ops[n].convert.to))
+            return AVERROR(ENOTSUP);
+        n++;
+    } else {
+        if (NEXT(SWS_OP_CONVERT)) {
+            op = &ops->ops[n++];
+            if (!is_rw_type(op->convert.to))
+                return AVERROR(ENOTSUP);
+            if (op->convert.expand) {
+                if (op->type != SWS_PIXEL_U8 || op->convert.to != SWS_PIXEL_U16)
+                    return AVERROR(ENOTSUP);
+                flags |= FUSED_EXPAND;
+            }
+        }
+        if (NEXT(SWS_OP_LSHIFT) || NEXT(SWS_OP_RSHIFT)) {
+            op = &ops->ops[n++];
+            flags |= op->op == SWS_OP_LSHIFT ? FUSED_LSHIFT : FUSED_RSHIFT;
+            p.shift = op->c.u;
+        }
+    }
+
+    if (NEXT(SWS_OP_SWIZZLE))
+        post = ops->ops[n++].swizzle;
+    if (NEXT(SWS_OP_CLEAR))
+        clear = &ops->ops[n++];
+    if (!NEXT(SWS_OP_WRITE))
+        return AVERROR(ENOTSUP);
+    write = &ops->ops[n++];
+    if (n != ops->num_ops || write->rw.frac || !is_rw_type(write->type))
+        return AVERROR(ENOTSUP);
+
+    ni = read->rw.elems;
+    no = write->rw.elems;
+
+    /* Fold both swizzles into the per-element parameters */
+    for (int j = 0; j < no; j++) {
+        const int r = post.in[j];
+        if (clear && clear->c.q4[j].den) {
+            clear_mask |= 1 << j;
+            switch (write->type) {
+            case SWS_PIXEL_U8:  p.clear[j] = q2pixel(uint8_t,  clear->c.q4[j]); break;
+            case SWS_PIXEL_U16: p.clear[j] = q2pixel(uint16_t, clear->c.q4[j]); break;
+            }
+            continue;
+        }
+
+        if (lin) {
+            for (int c = 0; c < 4; c++) {
+                if (lin->lin.m[r][c].num)
+                    nc = FFMAX(nc, c + 1);
+                p.m[j][c] = q2pixel(float, lin->lin.m[r][c]);
+            }
+            p.k[j] = q2pixel(float, lin->lin.m[r][4]);
+        } else {
+            p.src[j] = pre.in[r];
+            if (p.src[j] >= ni)
+                return AVERROR(ENOTSUP);
+        }
+
+        if (dither)
+            p.dither_y[j] = dither->dither.y_offset[r];
+        if (max)
+            p.max[j] = q2pixel(float, max->c.q4[r]);
+        if (min)
+            p.min[j] = q2pixel(float, min->c.q4[r]);
+    }
+
+    if (lin) {
+        nc = FFMAX(nc, 1);
+        for (int c = 0; c < nc; c++) {
+            p.src[c] = pre.in[c];
+            if (p.src[c] >= ni)
+                return AVERROR(ENOTSUP);
+        }
+    }
+
+    const uint32_t key = FUSED_KEY(ff_sws_pixel_type_size(read->type), ni,
+                                   read->rw.packed, nc, flags, clear_mask,
+                                   ff_sws_pixel_type_size(write->type), no,
+                                   write->rw.packed);
+    for (int i = 0; i < FF_ARRAY_ELEMS(kernels); i++) {
+        if (kernels[i].key == key) {
+            func = kernels[i].func;
+            break;
+        }
+    }
+    if (!func)
+        return AVERROR(ENOTSUP);
+
+    const int size_log2 = dither ? dither->dither.size_log2 : 0;
+    const int size = 1 << size_log2;
+
+    FusedPriv *priv = av_memdup(&p, sizeof(p));
+    if (!priv)
+        return AVERROR(ENOMEM);
+    priv->half   = 0.5f;
+    priv->dither = &priv->half;
+
+    if (size > 1) {
+        float *matrix = av_malloc_array(size * size, sizeof(*matrix));
+        if (!matrix) {
+            av_free(priv);
+            return AVERROR(ENOMEM);
+        }
+        for (int i = 0; i < size * size; i++)
+            matrix[i] = q2pixel(float, dither->dither.matrix[i]);
+        priv->dither = matrix;
+        priv->dither_mask = size - 1;
+        priv->dither_size_log2 = size_log2;
+    }
+
+    *out = (SwsCompiledOp) {
+        .func       = func,
+        .block_size = SWS_BLOCK_SIZE,
+        .priv       = priv,
+        .free       = fused_free,
+    };
+    return 0;
+}
+
+const SwsOpBackend backend_fused = {
+    .name    = "fused",
+    .compile = compile,
+};
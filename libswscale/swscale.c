@@ -30,6 +30,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "config.h"
 #include "swscale_internal.h"
@@ -1505,6 +1506,244 @@ int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
     return 0;
 }
 
+static int inherit_options(SwsContext *child, const SwsContext *sws)
+{
+    child->opaque = sws->opaque;
+    return av_opt_copy(child, sws);
+}
+
+static int get_output_contexts(SwsContext *sws, int nb_dst)
+{
+    SwsInternal *c = sws_internal(sws);
+    int ret;
+
+    if (nb_dst > c->nb_outputs) {
+        SwsContext **outputs = av_realloc_array(c->outputs, nb_dst, sizeof(*outputs));
+        if (!outputs)
+            return AVERROR(ENOMEM);
+        c->outputs = outputs;
+
+        while (c->nb_outputs < nb_dst) {
+            outputs[c->nb_outputs] = sws_alloc_context();
+            if (!outputs[c->nb_outputs])
+                return AVERROR(ENOMEM);
+            c->nb_outputs++;
+        }
+    }
+
+    /* The graphs of the outputs are only rebuilt if the options or frame
+     * properties changed */
+    for (int i = 0; i < nb_dst; i++) {
+        if ((ret = inherit_options(c->outputs[i], sws)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * Returns whether all outputs can be produced from a single conversion of
+ * the source to the output format and colorspace, done at source resolution.
+ */
+static int can_share_conversion(AVFrame *const *dst, int nb_dst,
+                                const AVFrame *src)
+{
+    SwsFormat src_fmt, dst_fmt;
+
+    if (nb_dst < 2 || (src->flags & AV_FRAME_FLAG_INTERLACED))
+        return 0;
+
+    src_fmt = ff_fmt_from_frame(src, 0);
+    dst_fmt = ff_fmt_from_frame(dst[0], 0);
+    if (ff_props_equal(&src_fmt, &dst_fmt))
+        return 0; /* nothing to share besides the input itself */
+
+    for (int i = 1; i < nb_dst; i++) {
+        SwsFormat fmt = ff_fmt_from_frame(dst[i], 0);
+        if (!ff_props_equal(&fmt, &dst_fmt))
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Returns the format holding the components of fmt at the same depth and
+ * subsampling in separate planes, into which a packed or semi-planar fmt
+ * can be unpacked losslessly, or AV_PIX_FMT_NONE.
+ */
+static enum AVPixelFormat unpacked_format(enum AVPixelFormat fmt)
+{
+    const uint64_t model = AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_ALPHA |
+                           AV_PIX_FMT_FLAG_FLOAT | AV_PIX_FMT_FLAG_XYZ |
+                           AV_PIX_FMT_FLAG_BAYER;
+    const uint64_t unsupported = AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL |
+                                 AV_PIX_FMT_FLAG_BITSTREAM;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt), *d = NULL;
+
+    if (!desc || desc->flags & (unsupported | AV_PIX_FMT_FLAG_BAYER) ||
+        av_pix_fmt_count_planes(fmt) == desc->nb_components)
+        return AV_PIX_FMT_NONE;
+
+    while ((d = av_pix_fmt_desc_next(d))) {
+        enum AVPixelFormat planar = av_pix_fmt_desc_get_id(d);
+        int same_depth = 1;
+
+        if (d->flags & unsupported || (d->flags ^ desc->flags) & model ||
+            d->nb_components != desc->nb_components ||
+            d->log2_chroma_w != desc->log2_chroma_w ||
+            d->log2_chroma_h != desc->log2_chroma_h ||
+            av_pix_fmt_count_planes(planar) != d->nb_components ||
+            av_pix_fmt_swap_endianness(planar) != AV_PIX_FMT_NONE &&
+            !(d->flags & AV_PIX_FMT_FLAG_BE) == HAVE_BIGENDIAN)
+            continue;
+
+        for (int i = 0; i < d->nb_components; i++)
+            same_depth &= d->comp[i].depth == desc->comp[i].depth;
+        if (same_depth && sws_test_format(planar, 0) && sws_test_format(planar, 1))
+            return planar;
+    }
+
+    return AV_PIX_FMT_NONE;
+}
+
+/**
+ * Prepare the intermediate *ptmp, at source resolution in the given format
+ * and with the other properties of props.
+ */
+static int setup_shared_frame(AVFrame **ptmp, enum AVPixelFormat format,
+                              const AVFrame *src, const AVFrame *props)
+{
+    AVFrame *tmp = *ptmp;
+
+    if (!tmp) {
+        tmp = *ptmp = av_frame_alloc();
+        if (!tmp)
+            return AVERROR(ENOMEM);
+    }
+
+    /* Drop the buffers if the geometry changed, or if a previous output
+     * still holds a reference to them */
+    if (tmp->format != format || tmp->width != src->width ||
+        tmp->height != src->height || (tmp->buf[0] && !av_frame_is_writable(tmp)))
+        av_frame_unref(tmp);
+
+    av_frame_side_data_free(&tmp->side_data, &tmp->nb_side_data);
+    av_dict_free(&tmp->metadata);
+
+    tmp->format = format;
+    tmp->width  = src->width;
+    tmp->height = src->height;
+    return av_frame_copy_props(tmp, props);
+}
+
+static int is_resized(const AVFrame *dst, const AVFrame *src)
+{
+    return dst->width != src->width || dst->height != src->height;
+}
+
+/**
+ * Convert the source once for all outputs, if that saves work.
+ *
+ * @param input set to the frame to scale the resized outputs from
+ */
+static int convert_shared(SwsContext *sws, AVFrame *const *dst, int nb_dst,
+                          const AVFrame *src, const AVFrame **input)
+{
+    SwsInternal *c = sws_internal(sws);
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src->format);
+    enum AVPixelFormat unpacked;
+    int nb_resized = 0, ret;
+
+    if (can_share_conversion(dst, nb_dst, src)) {
+        ret = setup_shared_frame(&c->frame_shared, dst[0]->format, src, dst[0]);
+        if (ret < 0)
+            return ret;
+        ret = sws_frame_setup(sws, c->frame_shared, src);
+        if (ret < 0)
+            return ret;
+
+        /* A single pass means that the scaler can convert the input as part
+         * of resizing it. Only share the whole conversion if it requires
+         * extra passes at source resolution, e.g. for color mapping. */
+        if (c->graph[FIELD_TOP]->num_passes > 1) {
+            ret = sws_scale_frame(sws, c->frame_shared, src);
+            if (ret < 0)
+                return ret;
+            *input = c->frame_shared;
+            return 0;
+        }
+    }
+
+    /* Otherwise, every resized output would unpack a packed or semi-planar
+     * source on its own while reading it. Unpack it once instead. The
+     * outputs at source resolution keep converting the source directly,
+     * which may use dedicated unscaled conversions. RGB sources are left
+     * alone, as the matrixing that each output still does on its own
+     * outweighs the unpacking. */
+    for (int i = 0; i < nb_dst; i++)
+        nb_resized += is_resized(dst[i], src);
+    if (nb_resized < 2 || (src->flags & AV_FRAME_FLAG_INTERLACED) ||
+        !desc || desc->flags & AV_PIX_FMT_FLAG_RGB)
+        return 0;
+    unpacked = unpacked_format(src->format);
+    if (unpacked == AV_PIX_FMT_NONE)
+        return 0;
+
+    if (!c->unpack && !(c->unpack = sws_alloc_context()))
+        return AVERROR(ENOMEM);
+    if ((ret = inherit_options(c->unpack, sws)) < 0)
+        return ret;
+    ret = setup_shared_frame(&c->frame_unpacked, unpacked, src, src);
+    if (ret < 0)
+        return ret;
+    ret = sws_scale_frame(c->unpack, c->frame_unpacked, src);
+    if (ret < 0)
+        return ret;
+    *input = c->frame_unpacked;
+    return 0;
+}
+
+int sws_scale_frames(SwsContext *sws, AVFrame *const *dst, int nb_dst,
+                     const AVFrame *src)
+{
+    SwsInternal *c = sws_internal(sws);
+    const AVFrame *input = src;
+    int ret;
+
+    if (!src || !dst || nb_dst <= 0)
+        return AVERROR(EINVAL);
+    for (int i = 0; i < nb_dst; i++) {
+        if (!dst[i])
+            return AVERROR(EINVAL);
+    }
+
+    if (c->frame_src) {
+        /* Legacy contexts are bound to a single output size */
+        if (nb_dst > 1)
+            return AVERROR(EINVAL);
+        return sws_scale_frame(sws, dst[0], src);
+    }
+
+    if ((ret = validate_params(sws)) < 0)
+        return ret;
+    if ((ret = get_output_contexts(sws, nb_dst)) < 0)
+        return ret;
+
+    if ((ret = convert_shared(sws, dst, nb_dst, src, &input)) < 0)
+        return ret;
+
+    for (int i = 0; i < nb_dst; i++) {
+        const AVFrame *in = input == c->frame_unpacked &&
+                            !is_resized(dst[i], src) ? src : input;
+        ret = sws_scale_frame(c->outputs[i], dst[i], in);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
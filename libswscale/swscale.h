@@ -364,6 +364,37 @@ int sws_is_noop(const AVFrame *dst, const AVFrame *src);
  */
 int sws_scale_frame(SwsContext *c, AVFrame *dst, const AVFrame *src);
 
+/**
+ * Scale source data from `src` to several destination frames at once.
+ *
+ * This behaves like calling `sws_scale_frame()` once for every entry of `dst`,
+ * but allows the scaler to share work between the outputs. In particular, if
+ * all destination frames have the same pixel format and colorspace, and the
+ * conversion to them cannot be folded into resizing (e.g. because it involves
+ * color mapping), the source is converted only once, at source resolution,
+ * and the result is then resized to each of the outputs. Otherwise, a packed
+ * or semi-planar YUV source is unpacked losslessly into planes once for all
+ * resized outputs, instead of by each of them. The scaling state
+ * for every output is kept across calls, so the destinations may all have
+ * different dimensions without forcing reinitialization.
+ *
+ * This function may only be used on contexts that have not been explicitly
+ * initialized (unless `nb_dst` is 1).
+ *
+ * @note Because the shared conversion happens before resizing, the output
+ *       may differ slightly from that of separate `sws_scale_frame()` calls.
+ *
+ * @param ctx    The scaling context.
+ * @param dst    Array of `nb_dst` destination frames. Each frame follows the
+ *               same rules as the `dst` argument of `sws_scale_frame()`.
+ * @param nb_dst Number of destination frames, must be at least 1.
+ * @param src    The source frame. If the data buffers are set to NULL, then
+ *               this function only sets up the scaler for all outputs.
+ * @return >= 0 on success, a negative AVERROR code on failure.
+ */
+int sws_scale_frames(SwsContext *ctx, AVFrame *const *dst, int nb_dst,
+                     const AVFrame *src);
+
 /*************************
  * Legacy (stateful) API *
  *************************/
@@ -701,6 +701,13 @@ struct SwsInternal {
     int          color_conversion_warned;
 
     Half2FloatTables *h2f_tables;
+
+    /* Per-output contexts and shared intermediates for sws_scale_frames() */
+    SwsContext **outputs;
+    int       nb_outputs;
+    AVFrame    *frame_shared;
+    SwsContext  *unpack;
+    AVFrame     *frame_unpacked;
 };
 //FIXME check init (where 0)
 
@@ -0,0 +1,234 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Compare scaling with the SWS_OP_FILTER_H / SWS_OP_FILTER_V operations
+ * against the legacy scaler, which is used as the reference.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+/* minimum PSNR of each plane against the legacy scaler, in dB */
+#define MIN_PSNR 45.0
+
+#define SRC_W 96
+#define SRC_H 64
+#define MAX_W 160
+
+static const struct {
+    enum AVPixelFormat src, dst;
+} formats[] = {
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_YUV444P     },
+    { AV_PIX_FMT_GBRP,        AV_PIX_FMT_GBRP        },
+    { AV_PIX_FMT_YUV444P10LE, AV_PIX_FMT_YUV444P10LE },
+    { AV_PIX_FMT_GRAY16LE,    AV_PIX_FMT_GRAY16LE    },
+    /* luma and alpha, expanded into an alpha format after filtering */
+    { AV_PIX_FMT_YA8,         AV_PIX_FMT_ARGB        },
+    { AV_PIX_FMT_YA8,         AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_YA16LE,      AV_PIX_FMT_RGBA64LE    },
+    { AV_PIX_FMT_YA16BE,      AV_PIX_FMT_GBRAP16LE   },
+};
+
+static const struct {
+    const char *name;
+    unsigned flags;
+} scalers[] = {
+    { "bilinear", SWS_BILINEAR },
+    { "bicubic",  SWS_BICUBIC  },
+    { "gauss",    SWS_GAUSS    },
+    { "lanczos",  SWS_LANCZOS  },
+    { "spline",   SWS_SPLINE   },
+};
+
+static const struct {
+    int w, h;
+} sizes[] = {
+    { 160, 112 }, /* upscale */
+    {  64,  48 }, /* downscale */
+    { 144,  64 }, /* horizontal only */
+    {  96,  40 }, /* vertical only */
+    { 128,  36 }, /* up and down, the vertical filter runs first */
+};
+
+static int nb_new_passes;
+
+static void log_cb(void *avcl, int level, const char *fmt, va_list vl)
+{
+    /* count the scaling passes not delegated to the legacy scaler */
+    if (!strncmp(fmt, "Conversion pass for", 19))
+        nb_new_passes++;
+    if (level <= AV_LOG_ERROR)
+        av_log_default_callback(avcl, level, fmt, vl);
+}
+
+/* A smooth pattern with some noise, away from the limits of the range. */
+static void fill_frame(AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    uint16_t line[MAX_W];
+    AVLFG lfg;
+
+    /* av_write_image_line2() merges the components into the existing data */
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        memset(frame->buf[i]->data, 0, frame->buf[i]->size);
+
+    av_lfg_init(&lfg, 1);
+    for (int c = 0; c < desc->nb_components; c++) {
+        const int max = (1 << desc->comp[c].depth) - 1;
+        for (int y = 0; y < frame->height; y++) {
+            for (int x = 0; x < frame->width; x++) {
+                double v = 0.5 + 0.2 * sin(x * (0.11 + 0.03 * c)) * cos(y * 0.17) +
+                           0.1 * x / frame->width +
+                           0.05 * ((av_lfg_get(&lfg) & 0xFF) / 255.0 - 0.5);
+                line[x] = lrint(v * max);
+            }
+            av_write_image_line2(line, frame->data, frame->linesize, desc,
+                                 0, y, c, frame->width, 2);
+        }
+    }
+}
+
+static double get_psnr(const AVFrame *a, const AVFrame *b, int c)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    const double max = (1 << desc->comp[c].depth) - 1;
+    uint16_t la[MAX_W], lb[MAX_W];
+    double sse = 0;
+
+    for (int y = 0; y < a->height; y++) {
+        av_read_image_line2(la, (const uint8_t **)a->data, a->linesize, desc,
+                            0, y, c, a->width, 0, 2);
+        av_read_image_line2(lb, (const uint8_t **)b->data, b->linesize, desc,
+                            0, y, c, b->width, 0, 2);
+        for (int x = 0; x < a->width; x++) {
+            int d = la[x] - lb[x];
+            sse += d * d;
+        }
+    }
+    if (!sse)
+        return INFINITY;
+    return 10 * log10(max * max * a->width * a->height / sse);
+}
+
+static int scale(AVFrame *dst, const AVFrame *src, unsigned flags)
+{
+    SwsContext *sws = sws_alloc_context();
+    int ret;
+
+    if (!sws)
+        return AVERROR(ENOMEM);
+    sws->flags   = flags;
+    sws->threads = 1;
+    ret = sws_scale_frame(sws, dst, src);
+    sws_free_context(&sws);
+    return ret;
+}
+
+static int run_test(enum AVPixelFormat src_fmt, enum AVPixelFormat dst_fmt,
+                    int s, int w, int h)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(dst_fmt);
+    AVFrame *src = av_frame_alloc();
+    AVFrame *ref = av_frame_alloc();
+    AVFrame *out = av_frame_alloc();
+    double psnr = INFINITY;
+    int ret;
+
+    if (!src || !ref || !out) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    src->format = src_fmt;
+    src->width  = SRC_W;
+    src->height = SRC_H;
+    ret = av_frame_get_buffer(src, 0);
+    if (ret < 0)
+        goto end;
+    fill_frame(src);
+
+    ref->format = out->format = dst_fmt;
+    ref->width  = out->width  = w;
+    ref->height = out->height = h;
+
+    ret = scale(ref, src, scalers[s].flags | SWS_ACCURATE_RND);
+    if (ret < 0)
+        goto end;
+
+    nb_new_passes = 0;
+    ret = scale(out, src, scalers[s].flags | SWS_UNSTABLE);
+    if (ret < 0)
+        goto end;
+
+    for (int p = 0; p < desc->nb_components; p++)
+        psnr = FFMIN(psnr, get_psnr(ref, out, p));
+
+    printf("%s %dx%d -> ", av_get_pix_fmt_name(src_fmt), SRC_W, SRC_H);
+    if (dst_fmt != src_fmt)
+        printf("%s ", av_get_pix_fmt_name(dst_fmt));
+    printf("%dx%d %s: ", w, h, scalers[s].name);
+    if (!nb_new_passes) {
+        printf("not using the filter operations\n");
+        ret = AVERROR_BUG;
+    } else if (psnr < MIN_PSNR) {
+        printf("PSNR %.2f dB below %.0f dB\n", psnr, MIN_PSNR);
+        ret = AVERROR_BUG;
+    } else {
+        printf("ok\n");
+    }
+
+end:
+    av_frame_free(&src);
+    av_frame_free(&ref);
+    av_frame_free(&out);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+
+    av_log_set_callback(log_cb);
+
+    for (int f = 0; f < FF_ARRAY_ELEMS(formats); f++) {
+        for (int s = 0; s < FF_ARRAY_ELEMS(scalers); s++) {
+            for (int i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+                int err = run_test(formats[f].src, formats[f].dst, s,
+                                   sizes[i].w, sizes[i].h);
+                if (err < 0 && err != AVERROR_BUG) {
+                    fprintf(stderr, "Error: %s\n", av_err2str(err));
+                    return 1;
+                }
+                if (err < 0)
+                    ret = 1;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -2262,6 +2262,13 @@ void sws_freeContext(SwsContext *sws)
     for (i = 0; i < FF_ARRAY_ELEMS(c->graph); i++)
         ff_sws_graph_free(&c->graph[i]);
 
+    for (i = 0; i < c->nb_outputs; i++)
+        sws_freeContext(c->outputs[i]);
+    av_freep(&c->outputs);
+    av_frame_free(&c->frame_shared);
+    sws_freeContext(c->unpack);
+    av_frame_free(&c->frame_unpacked);
+
     for (i = 0; i < c->nb_slice_ctx; i++)
         sws_freeContext(c->slice_ctx[i]);
     av_freep(&c->slice_ctx);
@@ -21,9 +21,12 @@
 #include <string.h>
 
 #include "libavutil/avassert.h"
+#include "libavutil/frame.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/pixdesc.h"
 #include "libavutil/refstruct.h"
 
+#include "libswscale/format.h"
 #include "libswscale/ops.h"
 #include "libswscale/ops_internal.h"
 
@@ -103,8 +106,43 @@ static void fill8(uint8_t *line, int num, unsigned range)
     }
 }
 
-static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
-                      const SwsOp *ops)
+/**
+ * Don't use check_func() with the compiled function because the actual
+ * function pointer may be a wrapper shared by multiple implementations.
+ * Instead, take a hash of both the backend pointer and its CPU flags.
+ */
+static void *backend_id(const SwsOpBackend *backend, int cpu_flags)
+{
+    uintptr_t id = (uintptr_t) backend;
+    id ^= (id << 6) + (id >> 2) + 0x9e3779b97f4a7c15 + cpu_flags;
+    return (void *) id;
+}
+
+static const SwsOpBackend *find_backend(const char *name)
+{
+    for (int n = 0; ff_sws_op_backends[n]; n++)
+        if (!strcmp(ff_sws_op_backends[n]->name, name))
+            return ff_sws_op_backends[n];
+    return NULL;
+}
+
+/**
+ * Report a failure of `report` that happened before anything could be
+ * compared, e.g. because the requested backend can not compile the ops.
+ */
+static void fail_backend(const SwsOpBackend *backend, const char *report)
+{
+    if (checkasm_check_func(backend_id(backend, 0), "%s", report))
+        fail();
+}
+
+/**
+ * Compare `ops` compiled with the named backend, or the first non-reference
+ * backend supporting them if `backend_name` is NULL, against the C backend.
+ * Failing to compile with the named backend is an error.
+ */
+static void check_ops_backend(const char *report, const unsigned ranges[NB_PLANES],
+                              const SwsOp *ops, const char *backend_name)
 {
     SwsContext *ctx = sws_alloc_context();
     SwsCompiledOp comp_ref = {0}, comp_new = {0};
@@ -122,6 +160,16 @@ static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
     DECLARE_ALIGNED_64(char, dst0)[NB_PLANES][LINES][PIXELS * sizeof(uint32_t[4])];
     DECLARE_ALIGNED_64(char, dst1)[NB_PLANES][LINES][PIXELS * sizeof(uint32_t[4])];
 
+    if (backend_name) {
+        backend_new = find_backend(backend_name);
+        av_assert0(backend_new);
+        /* checkasm ignores failures in the C pass, so check named backends
+         * in the passes with CPU flags. The id of CPU independent backends
+         * does not change between those, so they are checked only once. */
+        if (!av_get_cpu_flags())
+            return;
+    }
+
     if (!ctx)
         return;
     ctx->flags = SWS_BITEXACT;
@@ -151,15 +199,20 @@ static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
     for (int n = 0; ff_sws_op_backends[n]; n++) {
         const SwsOpBackend *backend = ff_sws_op_backends[n];
         const bool is_ref = !strcmp(backend->name, "c");
+        if (!is_ref && backend_name && strcmp(backend->name, backend_name))
+            continue;
         if (is_ref || !comp_new.func) {
             SwsCompiledOp comp;
             int ret = ff_sws_ops_compile_backend(ctx, backend, &oplist, &comp);
-            if (ret == AVERROR(ENOTSUP))
+            if (ret == AVERROR(ENOTSUP) && (is_ref || !backend_name))
                 continue;
-            else if (ret < 0)
-                fail();
-            else if (PIXELS % comp.block_size != 0)
-                fail();
+            else if (ret < 0 || PIXELS % comp.block_size != 0) {
+                if (ret >= 0 && comp.free)
+                    comp.free(comp.priv);
+                if (!backend_name || is_ref)
+                    fail();
+                continue;
+            }
 
             if (is_ref)
                 comp_ref = comp;
@@ -170,7 +223,15 @@ static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
         }
     }
 
-    av_assert0(comp_ref.func && comp_new.func);
+    av_assert0(comp_ref.func);
+    if (!comp_new.func || (backend_name && comp_new.func == comp_ref.func)) {
+        if (backend_name)
+            fail_backend(backend_new, report);
+        if (comp_ref.free)
+            comp_ref.free(comp_ref.priv);
+        sws_free_context(&ctx);
+        return;
+    }
 
     SwsOpExec exec = {0};
     exec.width = PIXELS;
@@ -182,16 +243,8 @@ static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
         exec.out_bump[i] = exec.out_stride[i] - write_size;
     }
 
-    /**
-     * Don't use check_func() because the actual function pointer may be a
-     * wrapper shared by multiple implementations. Instead, take a hash of both
-     * the backend pointer and the active CPU flags.
-     */
-    uintptr_t id = (uintptr_t) backend_new;
-    id ^= (id << 6) + (id >> 2) + 0x9e3779b97f4a7c15 + comp_new.cpu_flags;
-
     checkasm_save_context();
-    if (checkasm_check_func((void *) id, "%s", report)) {
+    if (checkasm_check_func(backend_id(backend_new, comp_new.cpu_flags), "%s", report)) {
         func_new = comp_new.func;
         func_ref = comp_ref.func;
 
@@ -252,6 +305,12 @@ static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
     sws_free_context(&ctx);
 }
 
+static void check_ops(const char *report, const unsigned ranges[NB_PLANES],
+                      const SwsOp *ops)
+{
+    check_ops_backend(report, ranges, ops, NULL);
+}
+
 #define CHECK_RANGES(NAME, RANGES, N_IN, N_OUT, IN, OUT, ...)                   \
   do {                                                                          \
       check_ops(NAME, RANGES, (SwsOp[]) {                                       \
@@ -751,6 +810,127 @@ static void check_scale(void)
     }
 }
 
+static const struct {
+    enum AVPixelFormat src, dst;
+} fused_pairs[] = {
+    /* Integer only */
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_BGRA        },
+    { AV_PIX_FMT_ARGB,        AV_PIX_FMT_RGB0        },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_0RGB        },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_GBRP        },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_GBRAP       },
+    { AV_PIX_FMT_GBRAP,       AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_ARGB        },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_BGR24       },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_GBRP        },
+    { AV_PIX_FMT_GBRP,        AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_GBRP,        AV_PIX_FMT_ARGB        },
+    { AV_PIX_FMT_GBRP,        AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_GRAY8,       AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_GRAY8,       AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_GRAY8,       AV_PIX_FMT_GRAY16      },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_RGB48       },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_RGB48       },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_GBRP16      },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_YUV444P10   },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_YUV444P12   },
+    /* YUV -> RGB */
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_ARGB        },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_GBRP        },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_RGB48       },
+    { AV_PIX_FMT_YUVA444P,    AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_ARGB        },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_GBRP        },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_GBRP10      },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_RGB48       },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_GBRP16      },
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_GRAY8       },
+    /* RGB -> YUV */
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_YUV444P     },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_YUV444P     },
+    { AV_PIX_FMT_GBRP,        AV_PIX_FMT_YUV444P     },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_YUV444P10   },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_YUV444P10   },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_YUV444P16   },
+    { AV_PIX_FMT_RGB24,       AV_PIX_FMT_GRAY8       },
+    { AV_PIX_FMT_RGBA,        AV_PIX_FMT_GRAY8       },
+    /* Bit depth reduction */
+    { AV_PIX_FMT_YUV444P10,   AV_PIX_FMT_YUV444P     },
+    { AV_PIX_FMT_GRAY10,      AV_PIX_FMT_GRAY8       },
+    { AV_PIX_FMT_GBRP10,      AV_PIX_FMT_RGB24       },
+    { AV_PIX_FMT_GBRP10,      AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_GRAY10,      AV_PIX_FMT_RGBA        },
+    { AV_PIX_FMT_RGB48,       AV_PIX_FMT_RGBA        },
+};
+
+static void check_fused(void)
+{
+    const SwsOpBackend *fused = find_backend("fused");
+    SwsContext *ctx;
+    AVFrame *frame;
+
+    /* see check_ops_backend() */
+    if (!av_get_cpu_flags())
+        return;
+
+    ctx   = sws_alloc_context();
+    frame = av_frame_alloc();
+    if (!ctx || !frame)
+        goto fail;
+
+    for (int n = 0; n < FF_ARRAY_ELEMS(fused_pairs); n++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fused_pairs[n].src);
+        const char *src_name = av_get_pix_fmt_name(fused_pairs[n].src);
+        const char *dst_name = av_get_pix_fmt_name(fused_pairs[n].dst);
+        const unsigned range = (1u << desc->comp[0].depth) - 1;
+        const char *report = FMT("fused_%s_%s", src_name, dst_name);
+        SwsOpList *ops = ff_sws_op_list_alloc();
+        SwsOp *list = NULL;
+        if (!ops)
+            goto fail;
+
+        /* Generate the full op list, the same way as the graph does */
+        frame->format = fused_pairs[n].src;
+        ops->src = ff_fmt_from_frame(frame, 0);
+        frame->format = fused_pairs[n].dst;
+        ops->dst = ff_fmt_from_frame(frame, 0);
+        bool incomplete = ff_infer_colors(&ops->src.color, &ops->dst.color);
+
+        if (ff_sws_decode_pixfmt(ops, ops->src.format) < 0 ||
+            ff_sws_decode_colors(ctx, SWS_PIXEL_F32, ops, ops->src, &incomplete) < 0 ||
+            ff_sws_encode_colors(ctx, SWS_PIXEL_F32, ops, ops->src, ops->dst, &incomplete) < 0 ||
+            ff_sws_encode_pixfmt(ops, ops->dst.format) < 0 ||
+            ff_sws_op_list_optimize(ops) < 0) {
+            fail_backend(fused, report);
+            goto next;
+        }
+
+        /* check_ops() expects a zero-terminated list */
+        list = av_calloc(ops->num_ops + 1, sizeof(*list));
+        if (!list) {
+            fail_backend(fused, report);
+            goto next;
+        }
+        memcpy(list, ops->ops, ops->num_ops * sizeof(*list));
+
+        check_ops_backend(report, MK_RANGES(range), list, "fused");
+
+    next:
+        av_free(list);
+        ff_sws_op_list_free(&ops);
+    }
+
+fail:
+    av_frame_free(&frame);
+    sws_free_context(&ctx);
+}
+
 void checkasm_check_sw_ops(void)
 {
     check_read_write();
@@ -775,4 +955,6 @@ void checkasm_check_sw_ops(void)
     report("linear");
     check_scale();
     report("scale");
+    check_fused();
+    report("fused");
 }
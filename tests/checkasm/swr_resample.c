@@ -0,0 +1,160 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/mem_internal.h"
+#include "libavutil/samplefmt.h"
+#include "libswresample/resample.h"
+
+#include "checkasm.h"
+
+#define SRC_LEN     512
+#define DST_LEN     256
+#define NB_CH       6
+#define IN_RATE     48000
+#define OUT_RATE    44100
+#define FILTER_SIZE 32
+
+static void randomize_samples(uint8_t *buf, enum AVSampleFormat fmt, int len)
+{
+    for (int i = 0; i < len; i++) {
+        switch (fmt) {
+        case AV_SAMPLE_FMT_S16P: ((int16_t *)buf)[i] = rnd();                          break;
+        case AV_SAMPLE_FMT_S32P: ((int32_t *)buf)[i] = rnd();                          break;
+        case AV_SAMPLE_FMT_FLTP: ((float   *)buf)[i] = (int32_t)rnd() / (float)INT32_MAX;  break;
+        case AV_SAMPLE_FMT_DBLP: ((double  *)buf)[i] = (int32_t)rnd() / (double)INT32_MAX; break;
+        }
+    }
+}
+
+static int compare_samples(const uint8_t *a, const uint8_t *b,
+                           enum AVSampleFormat fmt, int len)
+{
+    switch (fmt) {
+    case AV_SAMPLE_FMT_FLTP:
+        return !float_near_abs_eps_array((const float *)a, (const float *)b,
+                                         1e-5, len);
+    case AV_SAMPLE_FMT_DBLP:
+        return !double_near_abs_eps_array((const double *)a, (const double *)b,
+                                          1e-12, len);
+    default:
+        return memcmp(a, b, len * av_get_bytes_per_sample(fmt));
+    }
+}
+
+static ResampleContext *init_resampler(enum AVSampleFormat fmt)
+{
+    return swri_resampler.init(NULL, OUT_RATE, IN_RATE, FILTER_SIZE, 10, 0, 0.0,
+                               fmt, SWR_FILTER_TYPE_KAISER, 9.0, 0.0, 0, 0);
+}
+
+static void check_resample_common(enum AVSampleFormat fmt, const char *name,
+                                  uint8_t * const *src)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_LEN * sizeof(double)]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_LEN * sizeof(double)]);
+    ResampleContext *c = init_resampler(fmt);
+    ResampleContext ref, new;
+    int ret0, ret1;
+
+    declare_func(int, ResampleContext *c, void *dst, const void *src,
+                 int n, int update_ctx);
+
+    if (!c)
+        return;
+
+    if (check_func(c->dsp.resample_common, "resample_common_%s", name)) {
+        memset(dst0, 0, DST_LEN * sizeof(double));
+        memset(dst1, 0, DST_LEN * sizeof(double));
+        ref = new = *c;
+        ret0 = call_ref(&ref, dst0, src[0], DST_LEN, 1);
+        ret1 = call_new(&new, dst1, src[0], DST_LEN, 1);
+        if (ret0 != ret1 || ref.index != new.index || ref.frac != new.frac ||
+            compare_samples(dst0, dst1, fmt, DST_LEN))
+            fail();
+        bench_new(c, dst1, src[0], DST_LEN, 0);
+    }
+
+    swri_resampler.free(&c);
+}
+
+static void check_resample_common_multi(enum AVSampleFormat fmt, const char *name,
+                                        uint8_t * const *src)
+{
+    LOCAL_ALIGNED_32(uint8_t, ref_buf, [NB_CH * DST_LEN * sizeof(double)]);
+    LOCAL_ALIGNED_32(uint8_t, new_buf, [NB_CH * DST_LEN * sizeof(double)]);
+    const int stride = DST_LEN * av_get_bytes_per_sample(fmt);
+    ResampleContext *c = init_resampler(fmt);
+    uint8_t *dst0[NB_CH], *dst1[NB_CH];
+    ResampleContext ref, new;
+    int ret0, ret1;
+
+    declare_func(int, ResampleContext *c, uint8_t * const *dst,
+                 uint8_t * const *src, int nb_channels, int n, int update_ctx);
+
+    if (!c)
+        return;
+
+    for (int ch = 0; ch < NB_CH; ch++) {
+        dst0[ch] = ref_buf + ch * stride;
+        dst1[ch] = new_buf + ch * stride;
+    }
+
+    if (check_func(c->dsp.resample_common_multi, "resample_common_multi_%s", name)) {
+        memset(ref_buf, 0, NB_CH * stride);
+        memset(new_buf, 0, NB_CH * stride);
+        ref = new = *c;
+        ret0 = call_ref(&ref, dst0, src, NB_CH, DST_LEN, 1);
+        ret1 = call_new(&new, dst1, src, NB_CH, DST_LEN, 1);
+        if (ret0 != ret1 || ref.index != new.index || ref.frac != new.frac ||
+            compare_samples(ref_buf, new_buf, fmt, NB_CH * DST_LEN))
+            fail();
+        bench_new(c, dst1, src, NB_CH, DST_LEN, 0);
+    }
+
+    swri_resampler.free(&c);
+}
+
+void checkasm_check_swr_resample(void)
+{
+    static const struct {
+        enum AVSampleFormat fmt;
+        const char *name;
+    } formats[] = {
+        { AV_SAMPLE_FMT_S16P, "int16"  },
+        { AV_SAMPLE_FMT_S32P, "int32"  },
+        { AV_SAMPLE_FMT_FLTP, "float"  },
+        { AV_SAMPLE_FMT_DBLP, "double" },
+    };
+    LOCAL_ALIGNED_32(uint8_t, src_buf, [NB_CH * SRC_LEN * sizeof(double)]);
+    uint8_t *src[NB_CH];
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(formats); i++) {
+        const int stride = SRC_LEN * av_get_bytes_per_sample(formats[i].fmt);
+
+        for (int ch = 0; ch < NB_CH; ch++) {
+            src[ch] = src_buf + ch * stride;
+            randomize_samples(src[ch], formats[i].fmt, SRC_LEN);
+        }
+
+        check_resample_common(formats[i].fmt, formats[i].name, src);
+        check_resample_common_multi(formats[i].fmt, formats[i].name, src);
+    }
+    report("resample_common");
+}
@@ -182,6 +182,84 @@ framemd5(){
     ffmpeg "$@" -bitexact -f framemd5 -
 }
 
+# Write each of the filtergraph outputs [out0]...[outN-1] to its own framecrc
+# file, using the same output options for all of them, and print them all.
+framecrc_outputs(){
+    nb_outputs=$1
+    output_opts=$2
+    shift 2
+    outputs=
+    i=0
+    while [ $i -lt $nb_outputs ]; do
+        crcfile="${outdir}/${test}.${i}.crc"
+        cleanfiles="$cleanfiles $crcfile"
+        outputs="$outputs -map [out$i] $output_opts -bitexact -f framecrc -y $(target_path $crcfile)"
+        i=$((i + 1))
+    done
+    ffmpeg "$@" $outputs || return
+    cat_outputs $nb_outputs
+}
+
+# Filter the first video stream of the input with the same simple
+# filtergraph for each of nb_outputs framecrc files, and print them all.
+framecrc_vf_outputs(){
+    nb_outputs=$1
+    vf=$2
+    shift 2
+    outputs=
+    i=0
+    while [ $i -lt $nb_outputs ]; do
+        crcfile="${outdir}/${test}.${i}.crc"
+        cleanfiles="$cleanfiles $crcfile"
+        outputs="$outputs -map 0:v -vf $vf -c:v rawvideo -bitexact -f framecrc -y $(target_path $crcfile)"
+        i=$((i + 1))
+    done
+    ffmpeg "$@" $outputs || return
+    cat_outputs $nb_outputs
+}
+
+cat_outputs(){
+    i=0
+    while [ $i -lt $1 ]; do
+        echo "#output $i"
+        cat "${outdir}/${test}.${i}.crc"
+        i=$((i + 1))
+    done
+}
+
+# Mux the given input into a mov file, demux it without the index cache,
+# while writing the cache and while reading it back, with and without a
+# seek, and check that all runs see the same packets.
+mov_index_cache(){
+    movfile="${outdir}/${test}.mov"
+    cachedir="${outdir}/${test}.cache"
+    logfile="${outdir}/${test}.log"
+    cleanfiles="$cleanfiles $movfile $logfile"
+    tmovfile=$(target_path $movfile)
+    tcachedir=$(target_path $cachedir)
+    rm -rf "$cachedir" && mkdir -p "$cachedir" || return
+    ffmpeg "$@" -bitexact -f mov -y $tmovfile || return
+    for seek in "" "-ss 1"; do
+        for pass in nocache write read; do
+            crcfile="${outdir}/${test}.${pass}.crc"
+            cleanfiles="$cleanfiles $crcfile"
+            cache_opts=
+            test $pass = nocache || cache_opts="-index_cache $tcachedir"
+            framecrc -v verbose $cache_opts $seek -i $tmovfile -c copy \
+                > "$crcfile" 2> "$logfile" || return
+            if [ $pass = read ]; then
+                grep -q "Loaded index" "$logfile" ||
+                    { echo "index cache entry was not used"; return 1; }
+            fi
+        done
+        cmp "${outdir}/${test}.nocache.crc" "${outdir}/${test}.write.crc" &&
+        cmp "${outdir}/${test}.nocache.crc" "${outdir}/${test}.read.crc" || return
+        echo "#seek ${seek:-none}"
+        cat "${outdir}/${test}.read.crc"
+    done
+    rm -rf "$cachedir"
+}
+
 crc(){
     ffmpeg "$@" -f crc -
 }
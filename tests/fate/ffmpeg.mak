@@ -88,6 +88,13 @@ fate-unknown_layout-pcm: $(AREF)
 fate-unknown_layout-pcm: CMD = md5 \
   -guess_layout_max 0 -f s16le -ac 1 -ar 44100 -i $(TARGET_PATH)/$(AREF) -f s16le
 
+# read a file whose size is not a multiple of the block size in advance
+FATE_FFMPEG-$(call ALLYES, FILE_PROTOCOL PCM_S16LE_DEMUXER PCM_S16LE_MUXER) += fate-file-readahead-direct
+fate-file-readahead-direct: $(AREF)
+fate-file-readahead-direct: CMD = md5 \
+  -readahead 2 -readahead_size 4096 -direct 1 \
+  -f s16le -ac 1 -ar 44100 -i $(TARGET_PATH)/$(AREF) -c copy -f s16le
+
 FATE_FFMPEG-$(call FILTERDEMDECENCMUX, ARESAMPLE, PCM_S32LE, PCM_S32LE, AC3_FIXED, AC3) += fate-unknown_layout-ac3
 fate-unknown_layout-ac3: $(AREF)
 fate-unknown_layout-ac3: CMD = md5 -auto_conversion_filters \
@@ -267,6 +274,55 @@ fate-ffmpeg-streamcopy-t: CMD = ffmpeg
     -c copy -f null -t 1 -
 FATE_FFMPEG-$(call REMUX, RAWVIDEO, NULL_MUXER) += fate-ffmpeg-streamcopy-t
 
+# Test that limiting the number of active tasks does not change the output of
+# an invocation with many outputs, nor deadlock it.
+FATE_FFMPEG_MAX_ACTIVE_TASKS = fate-ffmpeg-max_active_tasks-0 \
+                               fate-ffmpeg-max_active_tasks-1 \
+                               fate-ffmpeg-max_active_tasks-3
+$(FATE_FFMPEG_MAX_ACTIVE_TASKS): tests/data/vsynth1.yuv
+$(FATE_FFMPEG_MAX_ACTIVE_TASKS): CMD = framecrc_outputs 8 "-c:v rawvideo"                                      \
+    -max_active_tasks $(@:fate-ffmpeg-max_active_tasks-%=%)                                                  \
+    -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv                            \
+    -filter_complex split=8[out0][out1][out2][out3][out4][out5][out6][out7]
+$(FATE_FFMPEG_MAX_ACTIVE_TASKS): REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-max_active_tasks
+FATE_FFMPEG-$(call FRAMECRC, RAWVIDEO, RAWVIDEO, SPLIT_FILTER) += $(FATE_FFMPEG_MAX_ACTIVE_TASKS)
+
+# Test that activating independent filters concurrently does not change the
+# output of a filtergraph compared to running it on a single thread.
+FATE_FFMPEG_FILTER_THREAD_TYPE = fate-ffmpeg-filter_thread_type-serial \
+                                 fate-ffmpeg-filter_thread_type-graph  \
+                                 fate-ffmpeg-filter_thread_type-graph_slice
+fate-ffmpeg-filter_thread_type-serial:      FILTER_THREAD_OPTS = -filter_complex_threads 1
+fate-ffmpeg-filter_thread_type-graph:       FILTER_THREAD_OPTS = -filter_complex_threads 4 -filter_thread_type graph
+fate-ffmpeg-filter_thread_type-graph_slice: FILTER_THREAD_OPTS = -filter_complex_threads 4 -filter_thread_type graph+slice
+$(FATE_FFMPEG_FILTER_THREAD_TYPE): tests/data/vsynth1.yuv
+$(FATE_FFMPEG_FILTER_THREAD_TYPE): CMD = framecrc_outputs 4 "-c:v rawvideo" $(FILTER_THREAD_OPTS) \
+    -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv              \
+    -filter_complex "split=4[a][b][c][d];[a]hflip[out0];[b]vflip[out1];[c]transpose[out2];[d]gblur[out3]"
+$(FATE_FFMPEG_FILTER_THREAD_TYPE): REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-filter_thread_type
+FATE_FFMPEG-$(call FRAMECRC, RAWVIDEO, RAWVIDEO, SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER TRANSPOSE_FILTER GBLUR_FILTER) += $(FATE_FFMPEG_FILTER_THREAD_TYPE)
+
+# Test that outputs sharing the frames of an identical simple filtergraph
+# match the ones filtered separately.
+FATE_FFMPEG_SHARE_FILTERGRAPHS = fate-ffmpeg-share_filtergraphs-0 \
+                                 fate-ffmpeg-share_filtergraphs-1
+fate-ffmpeg-share_filtergraphs-0: SHARE_OPTS = -noshare_filtergraphs
+fate-ffmpeg-share_filtergraphs-1: SHARE_OPTS = -share_filtergraphs
+$(FATE_FFMPEG_SHARE_FILTERGRAPHS): tests/data/vsynth1.yuv
+$(FATE_FFMPEG_SHARE_FILTERGRAPHS): CMD = framecrc_vf_outputs 3 hflip,gblur $(SHARE_OPTS) \
+    -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv
+$(FATE_FFMPEG_SHARE_FILTERGRAPHS): REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-share_filtergraphs
+FATE_FFMPEG-$(call FRAMECRC, RAWVIDEO, RAWVIDEO, HFLIP_FILTER GBLUR_FILTER) += $(FATE_FFMPEG_SHARE_FILTERGRAPHS)
+
+# Test that packets referencing the mapped input file match the copied ones.
+fate-ffmpeg-mmap fate-ffmpeg-mmap-copy: tests/data/vsynth1.yuv
+fate-ffmpeg-mmap: CMD = framecrc -mmap 1 \
+    -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -c copy
+fate-ffmpeg-mmap-copy: CMD = framecrc -mmap 0 \
+    -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -c copy
+fate-ffmpeg-mmap-copy: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-mmap
+FATE_FFMPEG-$(call REMUX, RAWVIDEO) += fate-ffmpeg-mmap fate-ffmpeg-mmap-copy
+
 # Test loopback decoding and passing the output to a complex graph.
 fate-ffmpeg-loopback-decoding: tests/data/vsynth1.yuv
 fate-ffmpeg-loopback-decoding: CMD = transcode \
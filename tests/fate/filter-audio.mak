@@ -238,6 +238,33 @@ FATE_AFILTER-$(call FILTERDEMDECENCMUX, ARESAMPLE AEVALSRC ASETPTS, HLS MPEGTS,
 fate-filter-hls-append: tests/data/hls-list-append.m3u8
 fate-filter-hls-append: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/hls-list-append.m3u8 -af asetpts=N*23,aresample
 
+# the same playlists with the segments downloaded by background threads
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, ARESAMPLE AEVALSRC, HLS MPEGTS, MP2 PCM_F64LE, MP2FIXED, SEGMENT MPEGTS, LAVFI_INDEV) += fate-filter-hls-prefetch
+fate-filter-hls-prefetch: tests/data/hls-list.m3u8
+fate-filter-hls-prefetch: CMD = framecrc -flags +bitexact -prefetch_segments 4 -i $(TARGET_PATH)/tests/data/hls-list.m3u8 -af aresample
+fate-filter-hls-prefetch: REF = $(SRC_PATH)/tests/ref/fate/filter-hls
+
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, ARESAMPLE AEVALSRC ASETPTS, HLS MPEGTS, PCM_F64LE MP2, MP2FIXED, SEGMENT HLS MPEGTS, LAVFI_INDEV) += fate-filter-hls-append-prefetch
+fate-filter-hls-append-prefetch: tests/data/hls-list-append.m3u8
+fate-filter-hls-append-prefetch: CMD = framecrc -flags +bitexact -prefetch_segments 4 -i $(TARGET_PATH)/tests/data/hls-list-append.m3u8 -af asetpts=N*23,aresample
+fate-filter-hls-append-prefetch: REF = $(SRC_PATH)/tests/ref/fate/filter-hls-append
+
+tests/data/dash-list.mpd: TAG = GEN
+tests/data/dash-list.mpd: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -f dash -seg_duration 4 -map 0 -map 0 -flags +bitexact \
+        -codec:a mp2fixed -b:a:0 128k -b:a:1 64k -init_seg_name 'dash-list-init-$$RepresentationID$$.m4s' \
+        -media_seg_name 'dash-list-$$RepresentationID$$-$$Number%05d$$.m4s' -y $(TARGET_PATH)/$@ 2>/dev/null
+
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, ARESAMPLE AEVALSRC, DASH MOV, MP2 PCM_F64LE, MP2FIXED, DASH MP4, LAVFI_INDEV) += fate-filter-dash
+fate-filter-dash: tests/data/dash-list.mpd
+fate-filter-dash: CMD = framecrc -flags +bitexact -i $(TARGET_PATH)/tests/data/dash-list.mpd -map 0 -af aresample
+
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, ARESAMPLE AEVALSRC, DASH MOV, MP2 PCM_F64LE, MP2FIXED, DASH MP4, LAVFI_INDEV) += fate-filter-dash-prefetch
+fate-filter-dash-prefetch: tests/data/dash-list.mpd
+fate-filter-dash-prefetch: CMD = framecrc -flags +bitexact -prefetch_segments 4 -i $(TARGET_PATH)/tests/data/dash-list.mpd -map 0 -af aresample
+fate-filter-dash-prefetch: REF = $(SRC_PATH)/tests/ref/fate/filter-dash
+
 FATE_AMIX += fate-filter-amix-simple
 fate-filter-amix-simple: CMD = ffmpeg -auto_conversion_filters -filter_complex amix -max_size 4096 -i $(SRC) -ss 3 -max_size 4096 -i $(SRC1) -f f32le -
 fate-filter-amix-simple: REF = $(SAMPLES)/filter/amix_simple.pcm
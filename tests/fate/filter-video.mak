@@ -511,6 +511,28 @@ FATE_FILTER_VSYNTH-$(call FILTERDEMDEC, SCALE, RAWVIDEO, RAWVIDEO) += fate-filte
 fate-filter-scalechroma: tests/data/vsynth1.yuv
 fate-filter-scalechroma: CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv444p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -pix_fmt yuv420p -sws_flags +bitexact -vf scale=out_chroma_loc=bottomleft
 
+# scale=sizes must match one scale filter per output, and the conversion
+# shared between the outputs must match converting then scaling each output,
+# as must unpacking a packed source once for all outputs
+SCALE_SIZES_FLAGS = flags=bicubic+accurate_rnd+bitexact
+SCALE_SIZES_COLOR = in_primaries=bt709:in_transfer=bt709:out_primaries=bt2020:out_transfer=smpte2084
+SCALE_SIZES_SPLIT = split=3[x][y][z];[x]scale=176x144:$(SCALE_SIZES_FLAGS)[a];[y]scale=128x96:$(SCALE_SIZES_FLAGS)[b];[z]scale=352x288:$(SCALE_SIZES_FLAGS)[c]
+FATE_FILTER_SCALE_SIZES = fate-filter-scale-sizes fate-filter-scale-sizes-split \
+                          fate-filter-scale-sizes-shared fate-filter-scale-sizes-shared-split \
+                          fate-filter-scale-sizes-unpack fate-filter-scale-sizes-unpack-split
+FATE_FILTER_VSYNTH-$(call FILTERDEMDEC, FORMAT SCALE SPLIT, RAWVIDEO, RAWVIDEO) += $(FATE_FILTER_SCALE_SIZES)
+$(FATE_FILTER_SCALE_SIZES): tests/data/vsynth1.yuv
+$(FATE_FILTER_SCALE_SIZES): CMD = framecrc -flags bitexact -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -frames:v 10 -filter_complex "$(SCALE_SIZES_GRAPH)" -map "[a]" -map "[b]" -map "[c]"
+fate-filter-scale-sizes:              SCALE_SIZES_GRAPH = scale=sizes=176x144|128x96|352x288:$(SCALE_SIZES_FLAGS)[a][b][c]
+fate-filter-scale-sizes-split:        SCALE_SIZES_GRAPH = $(SCALE_SIZES_SPLIT)
+fate-filter-scale-sizes-split:        REF = $(SRC_PATH)/tests/ref/fate/filter-scale-sizes
+fate-filter-scale-sizes-shared:       SCALE_SIZES_GRAPH = scale=sizes=176x144|128x96|352x288:$(SCALE_SIZES_FLAGS):$(SCALE_SIZES_COLOR)[a][b][c]
+fate-filter-scale-sizes-shared-split: SCALE_SIZES_GRAPH = scale=$(SCALE_SIZES_FLAGS):$(SCALE_SIZES_COLOR),$(SCALE_SIZES_SPLIT)
+fate-filter-scale-sizes-shared-split: REF = $(SRC_PATH)/tests/ref/fate/filter-scale-sizes-shared
+fate-filter-scale-sizes-unpack:       SCALE_SIZES_GRAPH = scale=$(SCALE_SIZES_FLAGS),format=yuyv422,scale=sizes=176x144|128x96|352x288:$(SCALE_SIZES_FLAGS)[a][b][c]
+fate-filter-scale-sizes-unpack-split: SCALE_SIZES_GRAPH = scale=$(SCALE_SIZES_FLAGS),format=yuyv422,$(SCALE_SIZES_SPLIT)
+fate-filter-scale-sizes-unpack-split: REF = $(SRC_PATH)/tests/ref/fate/filter-scale-sizes-unpack
+
 FATE_FILTER_VSYNTH_VIDEO_FILTER-$(CONFIG_VFLIP_FILTER) += fate-filter-vflip
 fate-filter-vflip: CMD = video_filter "vflip"
 
@@ -202,6 +202,14 @@ FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
 
 FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER SCALE_FILTER) += $(FATE_H264_REINIT_TESTS:%=fate-h264-reinit-%)
 FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER) += $(FATE_H264)
+
+# deblocking in a separate thread must not change the output, covering
+# CAVLC with multiple slices, CABAC, MBAFF, PAFF and 8x8 transforms
+FATE_H264_DEBLOCK_THREAD := ba1_ft_c caba1_sony_d camp_mot_mbaff_l30     \
+                            cvpa1_toshiba_b frext-hpcv_brcm_a
+FATE_H264_DEBLOCK_THREAD := $(FATE_H264_DEBLOCK_THREAD:%=fate-h264-deblock-thread-%)
+FATE_H264-$(call FRAMECRC, H264, H264, H264_PARSER) += $(FATE_H264_DEBLOCK_THREAD)
+$(FATE_H264_DEBLOCK_THREAD): REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-h264-deblock-thread-%=h264-conformance-%)
 FATE_H264-$(call FRAMEMD5, H264, H264, H264_PARSER) += fate-h264-extreme-plane-pred
 FATE_H264-$(call FRAMEMD5, MOV,  H264) += fate-h264-crop-to-container
 FATE_H264-$(call DEMDEC,   H264, H264, H264_PARSER)   += fate-h264-encparams
@@ -442,6 +450,12 @@ fate-h264-conformance-sva_nl1_b:                  CMD = framecrc -i $(TARGET_SAM
 fate-h264-conformance-sva_nl2_e:                  CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SVA_NL2_E.264
 fate-h264-conformance-slice2_field_aurora4:       CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/slice2_field_aurora4.264
 
+fate-h264-deblock-thread-ba1_ft_c:                CMD = framecrc -deblock_thread 1 -framerate 19 -i $(TARGET_SAMPLES)/h264-conformance/BA1_FT_C.264
+fate-h264-deblock-thread-caba1_sony_d:            CMD = framecrc -deblock_thread 1 -i $(TARGET_SAMPLES)/h264-conformance/CABA1_Sony_D.jsv
+fate-h264-deblock-thread-camp_mot_mbaff_l30:      CMD = framecrc -deblock_thread 1 -i $(TARGET_SAMPLES)/h264-conformance/CAMP_MOT_MBAFF_L30.26l
+fate-h264-deblock-thread-cvpa1_toshiba_b:         CMD = framecrc -deblock_thread 1 -i $(TARGET_SAMPLES)/h264-conformance/CVPA1_TOSHIBA_B.264
+fate-h264-deblock-thread-frext-hpcv_brcm_a:       CMD = framecrc -deblock_thread 1 -i $(TARGET_SAMPLES)/h264-conformance/FRext/HPCV_BRCM_A.264
+
 fate-h264-bsf-mp4toannexb:                        CMD = md5 -i $(TARGET_SAMPLES)/h264/interlaced_crop.mp4 -c:v copy -f h264
 # First IDR is prefixed by SPS/PPS
 fate-h264-bsf-mp4toannexb-2:                      CMD = md5 -i $(TARGET_SAMPLES)/h264/ps_prefix_first_idr.mp4 -c:v copy -f h264
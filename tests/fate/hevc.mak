@@ -221,6 +221,13 @@ FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER) +=         \
 
 FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER SETPTS_FILTER) += $(HEVC_TESTS_MULTIVIEW)
 
+# decode the WPP rows of each frame on the decoder's own row threads, which
+# falls back to sequential decoding where threads are not available
+HEVC_TESTS_WPP_THREADS := $(addprefix fate-hevc-wpp-threads-, $(filter WPP_%_ericsson_MAIN_2, $(HEVC_SAMPLES_8BIT)))
+$(HEVC_TESTS_WPP_THREADS): CMD = framecrc -flags output_corrupt -wpp_threads 4 -i $(TARGET_SAMPLES)/hevc-conformance/$(subst fate-hevc-wpp-threads-,,$(@)).bit -pix_fmt yuv420p
+$(HEVC_TESTS_WPP_THREADS): REF = $(SRC_PATH)/tests/ref/fate/$(subst fate-hevc-wpp-threads-,hevc-conformance-,$(@))
+FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER) += $(HEVC_TESTS_WPP_THREADS)
+
 fate-hevc-paramchange-yuv420p-yuv420p10: CMD = framecrc -i $(TARGET_SAMPLES)/hevc/paramchange_yuv420p_yuv420p10.hevc -fps_mode passthrough -sws_flags area+accurate_rnd+bitexact
 FATE_HEVC-$(call FRAMECRC, HEVC, HEVC, HEVC_PARSER SCALE_FILTER LARGE_TESTS) += fate-hevc-paramchange-yuv420p-yuv420p10
 
@@ -97,6 +97,22 @@ FATE_HLSENC-$(call FILTERDEMDECENCMUX, AEVALSRC ARESAMPLE, HLS MPEGTS, MP2 PCM_F
 fate-hls-fmp4: tests/data/hls_fmp4.m3u8
 fate-hls-fmp4: CMD = framecrc -auto_conversion_filters -flags +bitexact -i $(TARGET_PATH)/tests/data/hls_fmp4.m3u8 -vf setpts=N*23
 
+# the same playlists with the segments downloaded by background threads
+FATE_HLSENC_PREFETCH = fate-hls-segment-size-prefetch   \
+                       fate-hls-segment-single-prefetch \
+                       fate-hls-init-time-prefetch      \
+                       fate-hls-list-size-prefetch      \
+                       fate-hls-fmp4-prefetch           \
+
+FATE_HLSENC-$(call FILTERDEMDECENCMUX, AEVALSRC ARESAMPLE, HLS MPEGTS, MP2 PCM_F64LE, MP2FIXED, HLS MPEGTS, LAVFI_INDEV) += $(FATE_HLSENC_PREFETCH)
+fate-hls-segment-size-prefetch: tests/data/hls_segment_size.m3u8
+fate-hls-segment-single-prefetch: tests/data/hls_segment_single.m3u8
+fate-hls-init-time-prefetch: tests/data/hls_init_time.m3u8
+fate-hls-list-size-prefetch: tests/data/hls_list_size.m3u8
+fate-hls-fmp4-prefetch: tests/data/hls_fmp4.m3u8
+$(FATE_HLSENC_PREFETCH): CMD = framecrc -auto_conversion_filters -flags +bitexact -prefetch_segments 4 -i $(TARGET_PATH)/tests/data/$(subst -,_,$(@:fate-%-prefetch=%)).m3u8 -vf setpts=N*23
+$(FATE_HLSENC_PREFETCH): REF = $(SRC_PATH)/tests/ref/fate/$(@:fate-%-prefetch=%)
+
 tests/data/hls_fmp4_ac3.m3u8: TAG = GEN
 tests/data/hls_fmp4_ac3.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
@@ -1089,6 +1089,46 @@ FATE_SWR_RESAMPLE-$(call FILTERDEMDECENCMUX, ARESAMPLE, WAV, PCM_S16LE, PCM_S16L
 fate-swr-resample: $(FATE_SWR_RESAMPLE-yes)
 FATE_SWR += $(FATE_SWR_RESAMPLE-yes)
 
+SWR_RESAMPLE_MULTI_OPTS = aresample=48000:internal_sample_fmt=$(1):exact_rational=0:linear_interp=0
+
+# The multichannel resampling kernel must match resampling each channel on its own.
+define SWR_RESAMPLE_MULTI
+FATE_SWR_RESAMPLE_MULTI += fate-swr-resample-multi-$(1) fate-swr-resample-multi-$(1)-split
+fate-swr-resample-multi-$(1) fate-swr-resample-multi-$(1)-split: tests/data/asynth-44100-8.wav
+fate-swr-resample-multi-$(1) fate-swr-resample-multi-$(1)-split: CMP = oneline
+fate-swr-resample-multi-$(1) fate-swr-resample-multi-$(1)-split: REF = $(3)
+fate-swr-resample-multi-$(1): CMD = md5 -auto_conversion_filters -i $(TARGET_PATH)/tests/data/asynth-44100-8.wav -af aformat=$(1):channel_layouts=7.1,$(SWR_RESAMPLE_MULTI_OPTS) -f $(2)
+fate-swr-resample-multi-$(1)-split: CMD = md5 -auto_conversion_filters -i $(TARGET_PATH)/tests/data/asynth-44100-8.wav -filter_complex "aformat=$(1):channel_layouts=7.1,channelsplit=channel_layout=7.1[FL][FR][FC][LFE][BL][BR][SL][SR];[FL]$(SWR_RESAMPLE_MULTI_OPTS)[rFL];[FR]$(SWR_RESAMPLE_MULTI_OPTS)[rFR];[FC]$(SWR_RESAMPLE_MULTI_OPTS)[rFC];[LFE]$(SWR_RESAMPLE_MULTI_OPTS)[rLFE];[BL]$(SWR_RESAMPLE_MULTI_OPTS)[rBL];[BR]$(SWR_RESAMPLE_MULTI_OPTS)[rBR];[SL]$(SWR_RESAMPLE_MULTI_OPTS)[rSL];[SR]$(SWR_RESAMPLE_MULTI_OPTS)[rSR];[rFL][rFR][rFC][rLFE][rBL][rBR][rSL][rSR]join=inputs=8:channel_layout=7.1" -f $(2)
+endef
+
+$(eval $(call SWR_RESAMPLE_MULTI,s16p,s16le,2fca05a432f062b6bb9eb9978900329d))
+$(eval $(call SWR_RESAMPLE_MULTI,s32p,s32le,341d5d4b9fc5c229e6eb70e496ff754d))
+$(eval $(call SWR_RESAMPLE_MULTI,fltp,f32le,54476b8b1b35a6de6a0dffc464c7efa3))
+$(eval $(call SWR_RESAMPLE_MULTI,dblp,f64le,3deab6acf4e6fae5cff0aaee976f25ed))
+
+FATE_SWR_RESAMPLE_MULTI-$(call FILTERDEMDECENCMUX, ARESAMPLE AFORMAT CHANNELSPLIT JOIN, WAV, PCM_S16LE, PCM_S16LE PCM_S32LE PCM_F32LE PCM_F64LE, PCM_S16LE PCM_S32LE PCM_F32LE PCM_F64LE) += $(FATE_SWR_RESAMPLE_MULTI)
+fate-swr-resample-multi: $(FATE_SWR_RESAMPLE_MULTI-yes)
+FATE_SWR += $(FATE_SWR_RESAMPLE_MULTI-yes)
+
+# Downmix 7.1 to mono, so that the output channel mixes more than two
+# input channels, in each internal sample format.
+define SWR_REMATRIX
+FATE_SWR_REMATRIX += fate-swr-rematrix-$(1)
+fate-swr-rematrix-$(1): tests/data/asynth-44100-8.wav
+fate-swr-rematrix-$(1): CMD = md5 -auto_conversion_filters -i $(TARGET_PATH)/tests/data/asynth-44100-8.wav -af aformat=$(1):channel_layouts=7.1,aresample=ochl=mono:internal_sample_fmt=$(1) -f $(2)
+fate-swr-rematrix-$(1): CMP = oneline
+fate-swr-rematrix-$(1): REF = $(3)
+endef
+
+$(eval $(call SWR_REMATRIX,s16p,s16le,a1d95d7f846f735413f1d49d6d0f4adf))
+$(eval $(call SWR_REMATRIX,s32p,s32le,c2891482e851331d194265547d6690c4))
+$(eval $(call SWR_REMATRIX,fltp,f32le,c44d28ce034d890cf9b908da0faf326a))
+$(eval $(call SWR_REMATRIX,dblp,f64le,84d213ef078529f088bc3935c386cf60))
+
+FATE_SWR_REMATRIX-$(call FILTERDEMDECENCMUX, ARESAMPLE AFORMAT, WAV, PCM_S16LE, PCM_S16LE PCM_S32LE PCM_F32LE PCM_F64LE, PCM_S16LE PCM_S32LE PCM_F32LE PCM_F64LE) += $(FATE_SWR_REMATRIX)
+fate-swr-rematrix: $(FATE_SWR_REMATRIX-yes)
+FATE_SWR += $(FATE_SWR_REMATRIX-yes)
+
 FATE_SWR_AUDIOCONVERT-$(call FILTERDEMDECENCMUX, ARESAMPLE AFORMAT AEVAL, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-swr-audioconvert
 fate-swr-audioconvert: tests/data/asynth-44100-1.wav
 fate-swr-audioconvert: REF = tests/data/asynth-44100-1.wav
@@ -40,6 +40,11 @@ FATE_LIBSWSCALE-$(CONFIG_UNSTABLE) += fate-sws-ops-list
 fate-sws-ops-list: libswscale/tests/sws_ops$(EXESUF)
 fate-sws-ops-list: CMD = run libswscale/tests/sws_ops$(EXESUF) | do_md5sum | cut -d" " -f1
 
+# Compare scaling with the filter operations against the legacy scaler
+FATE_LIBSWSCALE-$(CONFIG_UNSTABLE) += fate-sws-filters
+fate-sws-filters: libswscale/tests/filters$(EXESUF)
+fate-sws-filters: CMD = run libswscale/tests/filters$(EXESUF)
+
 FATE_LIBSWSCALE += $(FATE_LIBSWSCALE-yes)
 FATE_LIBSWSCALE_SAMPLES += $(FATE_LIBSWSCALE_SAMPLES-yes)
 FATE-$(CONFIG_SWSCALE) += $(FATE_LIBSWSCALE)
@@ -332,6 +332,10 @@ FATE_MOV_FFMPEG_SAMPLES-$(call REMUX, MP4 MOV, H264_PARSER) \
                           += fate-mov-mp4-multiple-stsd-muxing
 fate-mov-mp4-multiple-stsd-muxing: CMD = transcode mov $(TARGET_SAMPLES)/h264/extradata-reload-multi-stsd.mov mp4 "-c:v copy" "-c:v copy"
 
+FATE_MOV_FFMPEG-$(call TRANSCODE, MPEG4, MOV, RAWVIDEO_DEMUXER WAV_DEMUXER PCM_S16LE_DECODER) += fate-mov-index-cache
+fate-mov-index-cache: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav
+fate-mov-index-cache: CMD = mov_index_cache -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -c:v mpeg4 -qscale:v 10 -c:a pcm_s16le -shortest
+
 FATE_FFMPEG += $(FATE_MOV_FFMPEG-yes)
 FATE_FFMPEG_FFPROBE += $(FATE_MOV_FFMPEG_FFPROBE-yes)
 